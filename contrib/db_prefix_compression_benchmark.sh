@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# Compare size and read time of databases with and without
+# 'database_prefix_compression'
+#
+# usage: db_prefix_compression_benchmark.sh [path to aide] [memory file system parameters]
+#
+# For both encodings a database of the synthetic memory file system is
+# written with '--init' (plain and gzipped) and read with '--compare'. The
+# size with prefix compression is also printed relative to the size without
+# it. The results depend on the path lengths of the file system, so measure
+# with a file system similar to the one to be checked.
+
+AIDE=${1:-aide}
+FS=${2:-depth=4,dirs=8,files=100,size=16}
+
+TMPDIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMPDIR"' EXIT
+
+for compression in false true; do
+    for gzip in false true; do
+        db="$TMPDIR/aide-$compression-$gzip.db"
+        config="$TMPDIR/aide-$compression-$gzip.conf"
+        cat > "$config" <<EOC
+filesystem=memory:$FS
+database_out=file:$db
+database_in=file:$db
+database_new=file:$db
+database_gzip=$gzip
+database_prefix_compression=$compression
+/ p+i+n+u+g+s+m+c+sha256
+EOC
+        "$AIDE" --log-level=warning --init -c "$config" > /dev/null || exit 1
+
+        start=$(date +%s.%N)
+        "$AIDE" --log-level=warning --compare -c "$config" > /dev/null
+        end=$(date +%s.%N)
+
+        size=$(wc -c < "$db")
+        if [ "$compression" = false ]; then
+            eval "size_$gzip=$size"
+            relative=""
+        else
+            eval "base=\$size_$gzip"
+            relative=" ($(echo "scale=1; 100 * $size / $base" | bc)% of the size without prefix compression)"
+        fi
+
+        echo "prefix compression: $compression, gzip: $gzip: $size bytes$relative, read: $(echo "$end - $start" | bc) seconds"
+    done
+done
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Compare the hash calculation time of the crypto library and of the Linux
+# kernel crypto API ('kernel_crypto', needs aide built with AF_ALG support)
+#
+# usage: kernel_crypto_benchmark.sh [path to aide] [file size in MiB] [number of files] [hashsums]
+#
+# The generated files are read once before the measurement, so all runs
+# hash from the page cache. Each combination of 'kernel_crypto' and the
+# 'chunks' attribute is measured with '--init', for 'kernel_crypto=true'
+# the number of bytes spliced to the kernel is printed as well (no spliced
+# bytes means that the data has been copied to user space, e.g. because
+# an algorithm is not supported by the kernel).
+
+AIDE=${1:-aide}
+SIZE=${2:-256}
+FILES=${3:-8}
+HASHSUMS=${4:-sha256+sha512}
+
+TMPDIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMPDIR"' EXIT
+
+mkdir "$TMPDIR/data" || exit 1
+i=0
+while [ "$i" -lt "$FILES" ]; do
+    head -c $((SIZE * 1048576)) /dev/urandom > "$TMPDIR/data/file$i" || exit 1
+    i=$((i + 1))
+done
+cat "$TMPDIR"/data/* > /dev/null
+
+for attributes in "$HASHSUMS" "$HASHSUMS+chunks"; do
+    for kernel_crypto in false true; do
+        config="$TMPDIR/aide.conf"
+        cat > "$config" <<EOC
+database_out=file:$TMPDIR/aide.db
+kernel_crypto=$kernel_crypto
+$TMPDIR/data $attributes
+EOC
+        start=$(date +%s.%N)
+        "$AIDE" --log-level=info --init -c "$config" > /dev/null 2> "$TMPDIR/log" || exit 1
+        end=$(date +%s.%N)
+
+        spliced=$(sed -n 's/.*spliced \([0-9]*\) byte(s).*/\1/p' "$TMPDIR/log")
+        echo "attributes: $attributes, kernel_crypto: $kernel_crypto: $(echo "$end - $start" | bc) seconds${spliced:+, spliced: $spliced bytes}"
+    done
+done
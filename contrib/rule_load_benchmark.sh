@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Measure the time aide needs to load configurations with many rules
+#
+# usage: rule_load_benchmark.sh [path to aide] [number of rules ...]
+#
+# For each number of rules a configuration with literal per-file rules
+# (1000 per directory) and one regex rule per directory is generated and
+# loaded with '--config-check'.
+
+AIDE=${1:-aide}
+[ $# -gt 0 ] && shift
+COUNTS=${*:-10000 100000 1000000}
+
+TMPDIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMPDIR"' EXIT
+
+for n in $COUNTS; do
+    config="$TMPDIR/aide-$n.conf"
+    awk -v n="$n" 'BEGIN {
+        print "database_out=file:/dev/null"
+        for (i = 0; i < n; ++i) {
+            if (i % 1000 == 0) {
+                printf "/bench/d%d/tmp[0-9]+$ R\n", i / 1000
+            }
+            printf "/bench/d%d/file%d$ R\n", i / 1000, i
+        }
+    }' > "$config"
+
+    start=$(date +%s.%N)
+    "$AIDE" --log-level=warning --config-check -c "$config" || exit 1
+    end=$(date +%s.%N)
+    echo "$n rules: $(echo "$end - $start" | bc) seconds"
+done
@@ -51,8 +51,9 @@
 
 #define ARGUMENT_SIZE 65536
 
-/* This is a structure that has all configuration info */
-extern db_config* conf;
+/* This is a structure that has all configuration info
+ * (of the context bound to the calling thread, see libaide.h) */
+extern __thread db_config* conf;
 
 #endif
 
@@ -68,6 +68,10 @@ typedef enum {
    attr_capabilities,
    attr_stribog256,
    attr_stribog512,
+   attr_chunks,
+   attr_fsverity,
+   attr_verified,
+   attr_rule,
    attr_unknown
 } ATTRIBUTE;
 
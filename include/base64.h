@@ -45,6 +45,9 @@ char* encode_base64(byte* src,size_t ssize);
 
 byte* decode_base64(char* src,size_t ssize,size_t *);
 
+/* Returns src, which is overwritten with the decoded data */
+byte* decode_base64_in_place(char* src,size_t ssize,size_t *);
+
 /* Returns decoded length */
 size_t length_base64(char* src,size_t ssize);
 
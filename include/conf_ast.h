@@ -26,13 +26,27 @@
 
 typedef enum config_option {
     ACL_NO_SYMLINK_FOLLOW_OPTION,
+    CHUNK_SIZE_OPTION,
     DATABASE_ADD_METADATA_OPTION,
     DATABASE_ATTRIBUTES_OPTION,
+    DATABASE_DICTIONARY_OPTION,
     DATABASE_GZIP_OPTION,
     DATABASE_IN_OPTION,
+    DATABASE_IN_CHECKSUM_OPTION,
     DATABASE_OUT_OPTION,
     DATABASE_NEW_OPTION,
+    DATABASE_PARALLEL_READ_OPTION,
+    DATABASE_PREFIX_COMPRESSION_OPTION,
+    DATABASE_COLUMNAR_OPTION,
+    DATABASE_MMAP_OPTION,
+    FILESYSTEM_OPTION,
+    HASH_CACHE_OPTION,
+    HASH_CACHE_ENTRIES_OPTION,
+    HASH_CACHE_SAFE_MODE_OPTION,
+    INCREMENTAL_GROWING_FILES_OPTION,
+    KERNEL_CRYPTO_OPTION,
     LOG_LEVEL_OPTION,
+    PRIMARY_HASHSUM_OPTION,
     REPORT_BASE16_OPTION,
     REPORT_DETAILED_INIT_OPTION,
     REPORT_FORCE_ATTRS_OPTION,
@@ -46,7 +60,10 @@ typedef enum config_option {
     REPORT_APPEND_OPTION,
     REPORT_SUMMARIZE_CHANGES_OPTION,
     REPORT_URL_OPTION,
+    ROLLING_REHASH_OPTION,
     ROOT_PREFIX_OPTION,
+    RULE_CACHE_OPTION,
+    RULE_FINGERPRINTS_OPTION,
     WARN_DEAD_SYMLINKS_OPTION,
     VERBOSE_OPTION,
     CONFIG_VERSION,
@@ -147,6 +164,7 @@ typedef struct restriction_expression {
 
 typedef struct rule_statement {
     AIDE_RULE_TYPE type;
+    bool glob;
 
     string_expression *path;
     restriction_expression *restriction;
@@ -204,7 +222,7 @@ ast* new_x_include_setenv_statement(char*, string_expression*);
 
 ast* new_if_statement(struct if_condition*, struct ast*, struct ast*);
 
-ast* new_rule_statement(AIDE_RULE_TYPE, string_expression*, restriction_expression*, attribute_expression*);
+ast* new_rule_statement(AIDE_RULE_TYPE, bool, string_expression*, restriction_expression*, attribute_expression*);
 
 if_condition* new_if_condition(struct bool_expression*);
 
@@ -214,6 +232,9 @@ bool_expression* new_bool_expression(bool_operator, bool_expression*, bool_expre
 attribute_expression* new_attribute_expression(attribute_operator, attribute_expression*, char*);
 restriction_expression* new_restriction_expression(restriction_expression*, char*);
 
+/* the parser collects the statements in reverse order */
+ast* reverse_statements(ast*);
+
 void deep_free(ast*);
 
 #endif
@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <time.h>
+#include <sys/types.h>
 #include "db_config.h"
 #include "util.h"
 
@@ -41,12 +42,34 @@ int db_init(database*, bool, bool);
 
 db_line* db_readline(database*);
 
+/* values shared with the dictionary of the database are set to NULL
+ * instead of being freed */
+void release_dict_values(db_line*, DB_ATTR_TYPE);
+
+/* values pointing into the mapped database (database_mmap) are set to NULL
+ * instead of being freed */
+void release_view_values(db_line*, DB_ATTR_TYPE);
+
+/* copy the values pointing into the mapped database, required for entries
+ * used after db_close() */
+void copy_view_values(db_line*);
+
+/* copy the values shared with the dictionary of the database, required for
+ * entries used after db_close() */
+void copy_dict_values(db_line*);
+
+/* feed data read from or written to the database to its attributes */
+void update_db_attrs(database*, void*, ssize_t);
+
 int db_writespec(db_config*);
 
 int db_writeline(db_line*,db_config*);
 
 void db_close();
 
+/* close the database (if still open) and free its state, the URL included */
+void db_free(database*);
+
 void free_db_line(db_line* dl);
 
 #define DB_OLD            (1<<0)
@@ -64,5 +87,6 @@ void free_db_line(db_line* dl);
 #define NODE_MOVED_IN     (1<<12)
 #define NODE_ALLOW_NEW    (1<<13)
 #define NODE_ALLOW_RM	  (1<<14)
+#define NODE_CONFIG_CHANGED (1<<15)
 
 #endif
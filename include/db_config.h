@@ -64,6 +64,89 @@ typedef struct xattrs_type
 } xattrs_type;
 #endif
 
+/* hashsum used for the per-chunk digests of the chunks attribute */
+#define CHUNK_HASHSUM hash_sha256
+
+#define DEFAULT_CHUNK_SIZE 67108864
+
+typedef struct chunks_type
+{
+  long long chunk_size;
+  size_t num;
+  byte *digests; /* num digests of hashsums[CHUNK_HASHSUM].length bytes */
+} chunks_type;
+
+typedef struct fsverity_type
+{
+  int algorithm; /* FS_VERITY_HASH_ALG_* */
+  size_t length;
+  byte *digest;
+} fsverity_type;
+
+typedef struct hash_stats
+{
+  unsigned long files; /* files read for hash calculation */
+  long long bytes; /* bytes read for hash calculation */
+  unsigned long hardlinks; /* hard links with reused hashsums */
+  long long hardlink_bytes; /* bytes not read due to reused hashsums */
+  long long spliced_bytes; /* bytes hashed without copying them to user space */
+  unsigned long sparse_files; /* files hashed with hole detection */
+  long long hole_bytes; /* bytes of holes not read */
+  unsigned long incremental; /* growing files with reused chunk digests */
+  long long incremental_bytes; /* bytes not read due to reused chunk digests */
+  unsigned long parallel_chunk_files; /* files with chunk digests calculated in parallel */
+  unsigned long rolling_rehashed; /* unchanged files re-hashed by rolling re-hash */
+  unsigned long rolling_reused; /* unchanged files with hashsums of the old entry */
+  unsigned long fsverity; /* files with fs-verity digest instead of hashsums */
+  long long fsverity_bytes; /* bytes not read due to fs-verity digests */
+  unsigned long primary_verified; /* files with matching primary hashsum */
+  unsigned long primary_mismatch; /* files with secondary hashsums calculated after a mismatch */
+} hash_stats;
+
+typedef struct db_write_stats
+{
+  unsigned long lines; /* entries written */
+  unsigned long raw_lines; /* entries copied unchanged from database_in */
+  unsigned long dict_entries; /* dictionary definitions written */
+  unsigned long blocks; /* blocks written (columnar layout) */
+  unsigned long long path_bytes; /* bytes of the paths */
+  unsigned long long front_coded_path_bytes; /* bytes of the paths with prefix compression */
+} db_write_stats;
+
+typedef struct rule_stats
+{
+  unsigned long literal; /* rules matched by string comparison */
+  unsigned long glob; /* glob rules */
+  unsigned long compiled; /* rules compiled while loading the configuration */
+  unsigned long cached; /* rules read from the rule cache */
+  unsigned long jit; /* rules JIT-compiled on first evaluation */
+  double load_time; /* seconds needed to load the configuration */
+} rule_stats;
+
+/* state of one scan, owned by the configuration of the context */
+typedef struct scan_state
+{
+  void *old_entries; /* old database entries by filename, only set while reading from disk */
+  void *carried_entries; /* old entries carried forward into database_out by --update-config */
+  unsigned long num_carried;
+  unsigned long num_rule_changed;
+  unsigned long num_no_fingerprint;
+
+  void *hardlinks; /* hashsums of files with more than one link */
+  byte *zero_buffer; /* zeros to hash the holes of sparse files */
+  struct rehash_key *rehash_threshold; /* NULL if all hashsums are calculated */
+  struct prelink_helper *prelink_helper;
+
+  struct hash_cache *hash_cache; /* NULL if no hash cache is open */
+
+  bool added_entries_reported;
+  bool removed_entries_reported;
+  bool changed_entries_reported;
+#ifdef WITH_AUDIT
+  long nadd, nrem, nchg;
+#endif
+} scan_state;
+
 #define RETOK 0
 #define RETFAIL -1
 
@@ -71,6 +154,7 @@ typedef struct xattrs_type
 #define DO_COMPARE  (1<<1)
 #define DO_DIFF     (1<<2)
 #define DO_DRY_RUN  (1<<3)
+#define DO_CONFIG_UPDATE (1<<4)
 
 /* TIMEBUFSIZE should be exactly ceil(sizeof(time_t)*8*ln(2)/ln(10))
  * Now it is ceil(sizeof(time_t)*2.5)
@@ -131,6 +215,24 @@ typedef struct db_line {
 
   char* capabilities;
 
+  chunks_type* chunks;
+
+  fsverity_type* fsverity;
+
+  time_t verified; /* time the hashsums were last calculated */
+
+  long long rule; /* fingerprint of the effective rule (see get_rule_fingerprint()) */
+
+  char *raw; /* fields of the database line, written instead of the attributes if set */
+
+  /* attributes whose values are shared with the dictionary of the database
+   * (not freed with the line) */
+  DB_ATTR_TYPE dict_attrs;
+
+  /* attributes whose values point into the mapped database (see
+   * database_mmap, not freed with the line) */
+  DB_ATTR_TYPE view_attrs;
+
   /* Attributes .... */
   DB_ATTR_TYPE attr;
 
@@ -151,9 +253,32 @@ typedef struct database {
     long lineno;
     ATTRIBUTE* fields;
     int num_fields;
+    DB_ATTR_TYPE attr; /* attributes from @@dbspec */
+    void *scanner;
     void *buffer_state;
     struct md_container *mdc;
+    struct md_thread *mdt;
     struct db_line *db_line;
+    bool raw_lines; /* same fields as database_out, keep the raw lines */
+    struct db_dict *dict; /* definitions read from the database */
+    struct db_dict_out *dict_out; /* definitions written to the database */
+    char *path; /* path of the previous entry (front-coded paths) */
+    size_t path_len;
+    size_t path_size;
+    struct db_block *block; /* entries of the current block (columnar layout) */
+    DB_ATTR_TYPE read_attrs; /* columns read from the blocks (columnar layout) */
+    struct db_column *columns; /* columns of the block being written */
+    int num_columns;
+    long block_rows;
+    char *map; /* mapped database file (database_mmap) or loaded database */
+    size_t map_size;
+    bool map_loaded; /* map is a copy read by load_database() */
+    DB_ATTR_TYPE view_fields; /* fields of the last entry that point into map */
+    bool capturing; /* written fields are collected in capture_buf (see capture_field()) */
+    char *capture_buf;
+    size_t capture_len;
+    size_t capture_size;
+    db_write_stats write_stats;
 
 } database;
 
@@ -176,12 +301,36 @@ typedef struct db_config {
 
   char *check_path;
   RESTRICTION_TYPE check_file_type;
+  bool check_path_batch;
+  int check_path_delimiter;
   
   char* config_file;
   char* config_version;
   bool config_check_warn_unrestricted_rules;
 
   int database_add_metadata;
+  bool database_parallel_read;
+  bool database_dictionary;
+  bool database_prefix_compression;
+  bool database_columnar;
+  bool database_mmap;
+  long long chunk_size;
+  bool incremental_growing_files;
+  unsigned long rolling_rehash;
+  DB_ATTR_TYPE primary_hashsum;
+  /* expected digest of database_in, verified before parsing (NULL if unset) */
+  byte *database_in_checksum;
+  HASHSUM database_in_checksum_hash;
+  bool rule_fingerprints;
+
+  char *rule_cache;
+
+  char *hash_cache;
+  unsigned long hash_cache_entries;
+  bool hash_cache_safe_mode;
+#ifdef WITH_AF_ALG
+  bool kernel_crypto;
+#endif
   int report_detailed_init;
   int report_base16;
   int report_quiet;
@@ -210,11 +359,19 @@ typedef struct db_config {
   /* Should we catch errors from mmapping */
   int catch_mmap;
 
+  hash_stats hash_stats;
+  rule_stats rule_stats;
+  scan_state scan;
+
+  /* state of the rule tree while the configuration is loaded (see begin_bulk_build()) */
+  bool bulk_build;
+  list *uncompiled_rules; /* regex rules compiled by compile_rules() */
+  int32_t num_uncompiled_rules;
+
   time_t start_time;
   time_t end_time;
 
   int symlinks_found;
-  DB_ATTR_TYPE attr;
 
 #ifdef WITH_ACL  
   int no_acl_on_symlinks;
@@ -230,9 +387,10 @@ typedef struct db_config {
 
   char* limit;
   pcre2_code* limit_crx;
-  pcre2_match_data* limit_md;
 
   struct seltree* tree;
+  struct disk_walker* disk_walker;
+  const struct fs_ops* fs;
 
 } db_config;
 
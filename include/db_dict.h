@@ -0,0 +1,62 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _DB_DICT_H_INCLUDED
+#define _DB_DICT_H_INCLUDED
+
+#include <stdbool.h>
+#include "attributes.h"
+#include "db_config.h"
+
+/*
+ * Dictionary encoding of repeated attribute values (database_dictionary)
+ *
+ * The first occurrence of a value is written as definition line
+ * '@@dict <field> <id> <value>' before the entry, the entries refer to the
+ * value by '@<id>'. The ids are counted per field starting from 0, a
+ * definition must add the next id. The decoded value of a definition is
+ * shared by all entries read from the same database (see dict_attrs of
+ * db_line) until db_dict_free() is called.
+ */
+#define DB_DICT_ATTRS (ATTR(attr_acl)|ATTR(attr_xattrs)|ATTR(attr_selinux)|ATTR(attr_capabilities))
+#define DB_DICT_NUM_FIELDS 4
+
+typedef struct db_dict_entry {
+    char *text;
+    bool decoded;
+    void *value;
+} db_dict_entry;
+
+/* Return: true (definition added) / false (invalid field or id) */
+bool db_dict_define(database *, const char *, const char *, const char *);
+
+/* frees the definitions and the shared values of the database */
+void db_dict_free(database *);
+
+/* Return: entry of the reference (e.g. '@1') / NULL (undefined reference) */
+db_dict_entry *db_dict_get(database *, ATTRIBUTE, const char *);
+
+/* Return: id of the value, new is set if it was not yet written to the database */
+long db_dict_get_id(database *, ATTRIBUTE, const char *, bool *);
+
+/* frees the definitions written to the database */
+void db_dict_out_free(database *);
+
+#endif
@@ -25,7 +25,10 @@
 #include <stdbool.h>
 #include "db_config.h"
 
+typedef struct disk_walker disk_walker;
+
 db_line* db_readline_disk(bool);
 int db_disk_init(void);
+void db_disk_free(void);
 
 #endif
@@ -24,11 +24,14 @@
 
 #include "db_config.h"
 
-extern char* dbtext;
-
+/* the scanner is reentrant, each database has its own scanner state */
 void db_lex_buffer(database*);
 void db_lex_delete_buffer(database*);
-int db_scan(void);
+int db_scan(database*);
+char* db_text(database*);
+/* skips the rest of the current line without splitting it into tokens
+ * Return: TNEWLINE / TEOF */
+int db_skip_line(database*);
 
 typedef enum {
     TBEGIN_DB = 1,
@@ -38,6 +41,9 @@ typedef enum {
     TUNKNOWN,
     TNEWLINE,
     TEOF,
+    TDICT,
+    TBLOCK,
+    TCOLUMN,
 } DB_TOKEN;
 
 #define LOG_DB_FORMAT_LINE(log_level, format, ...) \
@@ -0,0 +1,51 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _DB_PATH_H_INCLUDED
+#define _DB_PATH_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "db_config.h"
+
+/*
+ * Front-coded paths (database_prefix_compression)
+ *
+ * A path sharing more than DB_PATH_MIN_PREFIX bytes with the path of the
+ * previous entry is written as '<n>:<suffix>', where n is the number of
+ * shared bytes. All other paths are written in full, which resets the
+ * previous path. The previous path is kept in path of the database.
+ */
+#define DB_PATH_MIN_PREFIX 3
+
+/* rebuilds a front-coded path from the previous path
+ * Return: path (text itself if it is not front-coded and copy is false) /
+ *         NULL (invalid path) */
+char *db_read_path(database *, char *, bool);
+
+/* sets the previous path (e.g. of a path written in full) */
+void db_set_prev_path(database *, const char *, size_t);
+
+/* sets the previous path to the given path
+ * Return: length of the prefix shared with the previous path / 0 (the path
+ *         is to be written in full) */
+size_t db_front_code_path(database *, const char *, size_t);
+
+#endif
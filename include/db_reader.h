@@ -0,0 +1,45 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _DB_READER_H_INCLUDED
+#define _DB_READER_H_INCLUDED
+
+#include <stdbool.h>
+#include "db_config.h"
+
+/*
+ * A reader returns the lines of a database in order. A threaded reader
+ * parses the database on a separate thread and queues the parsed lines,
+ * so reading (including decompression) overlaps with the work of the
+ * caller. The reading thread waits while DB_READER_MAX_QUEUED lines are
+ * queued.
+ */
+typedef struct db_reader db_reader;
+
+db_reader *db_reader_start(database *, bool);
+
+/* Return: next line / NULL (end of database, the reader is freed) */
+db_line *db_reader_next(db_reader *);
+
+/* does not wait for the reading thread and never frees the reader
+ * Return: next line / NULL (no line queued or not threaded) */
+db_line *db_reader_poll(db_reader *);
+
+#endif
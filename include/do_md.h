@@ -25,9 +25,22 @@
 #include "config.h"
 #include "list.h"
 #include "db_config.h"
+#include "log.h"
 
 list* do_md(list* file_lst,db_config* conf);
 
+void log_hash_stats(LOG_LEVEL);
+
+void init_rolling_rehash(list*);
+
+/* frees the hashsums remembered for hard links (called at the end of a scan) */
+void free_hardlink_hashsums(void);
+
+#ifdef WITH_PRELINK
+/* stops the prelink helper process (if started) */
+void close_prelink_helper(void);
+#endif
+
 #ifdef WITH_ACL
 void acl2line(db_line* line);
 #endif
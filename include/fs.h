@@ -0,0 +1,67 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FS_H_INCLUDED
+#define _FS_H_INCLUDED
+
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*
+ * File system access used by the disk scan and the hash calculation
+ *
+ * The functions follow the semantics of the corresponding system calls
+ * (return -1 and set errno on error). readdir() returns the name of the
+ * next entry ("." and ".." may be omitted) or NULL at the end of the
+ * directory.
+ *
+ * native is true if the file descriptors are real ones, only then mmap(2),
+ * splice(2), hole detection, fs-verity, prelink and the attributes read
+ * via libraries (acl, selinux, e2fsattrs, capabilities) are used.
+ */
+typedef struct fs_ops {
+    const char *name;
+    bool native;
+    int (*lstat)(const char *, struct stat *);
+    int (*stat)(const char *, struct stat *);
+    ssize_t (*readlink)(const char *, char *, size_t);
+    void *(*opendir)(const char *);
+    const char *(*readdir)(void *);
+    int (*closedir)(void *);
+    int (*open)(const char *, int);
+    int (*fstat)(int, struct stat *);
+    ssize_t (*read)(int, void *, size_t);
+    ssize_t (*pread)(int, void *, size_t, off_t);
+    int (*close)(int);
+    ssize_t (*listxattr)(const char *, char *, size_t);
+    ssize_t (*getxattr)(const char *, const char *, void *, size_t);
+} fs_ops;
+
+extern const fs_ops disk_fs_ops;
+extern const fs_ops memory_fs_ops;
+
+/* parameters: comma separated list of key=value pairs (see man aide.conf) */
+bool init_memory_fs(const char *);
+
+/* Return: true (backend selected) / false (invalid backend or parameters) */
+bool set_fs_backend(const char *);
+
+#endif
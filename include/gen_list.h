@@ -24,8 +24,10 @@
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
 #include <stdbool.h>
+#include <sys/types.h>
 #include "attributes.h"
 #include "rx_rule.h"
+#include "seltree.h"
 #include "seltree_struct.h"
 struct stat;
 
@@ -48,8 +50,19 @@ void write_tree(seltree*);
 #define SELECTIVE_MATCH 1
 #define EQUAL_MATCH 2
 
-int check_rxtree(char*,seltree*, rx_rule* *, RESTRICTION_TYPE, bool);
+/* adds the new nodes right away, so it must not be called concurrently with
+ * another evaluation on the same tree (see check_rxtree_r()) */
+int check_rxtree(char*,seltree*, rx_rule* *, RESTRICTION_TYPE, bool, seltree_match_ctx *);
+
+/* reentrant, new nodes are added by add_pending_seltree_nodes(ctx) */
+int check_rxtree_r(char*,seltree*, rx_rule* *, RESTRICTION_TYPE, bool, seltree_match_ctx *);
 
 struct db_line* get_file_attrs(char*,DB_ATTR_TYPE, struct stat *, bool);
 
+/* old database entry of filename, only available during the disk scan */
+struct db_line* get_old_entry(char*);
+
+/* --update-config: Return: true (old entry is written to database_out) / false (read entry from disk) */
+bool carry_forward_old_entry(char*, rx_rule*, mode_t);
+
 #endif /*_GEN_LIST_H_INCLUDED*/
@@ -0,0 +1,52 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _GLOB_RULE_H_INCLUDED
+#define _GLOB_RULE_H_INCLUDED
+
+#include <stddef.h>
+#include "rx_rule.h"
+
+/*
+ * Glob rules ('glob:' prefix in the configuration)
+ *
+ * '*' matches any characters except '/', '**' matches any characters (as a
+ * complete path component followed by '/' also zero directories), '?'
+ * matches one character except '/', '[...]' matches one character
+ * (except '/') of the set ('[!...]' or '[^...]' for the complement), '\'
+ * escapes the next character. A glob matches a path if it matches the
+ * whole path or one of its leading directories, a trailing '$' restricts
+ * it to the whole path.
+ */
+typedef struct glob_rule glob_rule;
+
+/* Return: compiled glob / NULL (invalid glob, error message and offset set) */
+glob_rule *compile_glob(const char *, const char **, size_t *);
+
+void free_glob(glob_rule *);
+
+/* Return: 0 (match), PCRE2_ERROR_PARTIAL (partial match) or PCRE2_ERROR_NOMATCH
+ * the same results as pcre2_match() with PCRE2_PARTIAL_SOFT */
+int match_glob(const glob_rule *, const char *);
+
+/* memory for the returned string is obtained with malloc(3), and should be freed with free(3). */
+char *get_glob_dir(const glob_rule *);
+
+#endif
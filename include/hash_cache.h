@@ -0,0 +1,45 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _HASH_CACHE_H_INCLUDED
+#define _HASH_CACHE_H_INCLUDED
+
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "db_config.h"
+
+#define DEFAULT_HASH_CACHE_ENTRIES 65536
+
+/* number of consecutive slots an entry may be stored in */
+#define HASH_CACHE_PROBES 8
+
+/* coarsest timestamp granularity of supported file systems (FAT) in seconds */
+#define HASH_CACHE_TIMESTAMP_GRANULARITY 2
+
+typedef struct hash_cache hash_cache;
+
+/* Return: open hash cache / NULL (continue without hash cache) */
+hash_cache *hash_cache_open(const char *, unsigned long, bool);
+/* the functions below do nothing for a NULL hash cache */
+bool hash_cache_lookup(hash_cache *, struct stat *, db_line *);
+void hash_cache_store(hash_cache *, struct stat *, db_line *);
+void hash_cache_close(hash_cache *);
+
+#endif
@@ -50,6 +50,10 @@ extern hashsum_t hashsums[];
 
 extern int algorithms[];
 
+#ifdef WITH_AF_ALG
+extern const char *af_alg_names[];
+#endif
+
 DB_ATTR_TYPE get_hashes(bool);
 
 #endif /* _HASHSUM_H_INCLUDED */
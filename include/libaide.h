@@ -0,0 +1,80 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LIBAIDE_H_INCLUDED
+#define _LIBAIDE_H_INCLUDED
+
+#include <stdbool.h>
+#include "attributes.h"
+#include "db_config.h"
+
+/*
+ * A context holds the configuration, the rule tree and the state of one
+ * scan. The API functions return RETOK or one of the error codes of
+ * errorcodes.h.
+ *
+ * Usage: aide_new_context() -> aide_parse_config() -> aide_scan() ->
+ * aide_foreach_result() and/or aide_report() -> aide_free_context()
+ *
+ * The configuration and the state of a scan are owned by the context.
+ * Every API function binds its context to the calling thread ('conf' is
+ * thread-local, the threads started by a scan bind the context of the
+ * scan), so different contexts can be used on different threads at the
+ * same time, e.g. to run several scans in parallel. A context must not be
+ * used by more than one thread at a time. Only the parsing of the
+ * configuration files is serialized, the parser is not reentrant. The log
+ * level, the log output and the synthetic file system of the 'filesystem'
+ * option are shared by all contexts. The callback of aide_foreach_result()
+ * must not call an API function.
+ */
+typedef struct aide_context {
+    db_config *conf;
+} aide_context;
+
+/* status is NODE_ADDED, NODE_REMOVED or NODE_CHANGED
+ * config_changed is true if the difference results from a changed rule */
+typedef struct aide_result {
+    int status;
+    db_line *old_data;
+    db_line *new_data;
+    DB_ATTR_TYPE changed_attrs;
+    bool config_changed;
+} aide_result;
+
+typedef void (*aide_result_callback)(const aide_result *, void *);
+
+/* Return: new context with the default configuration / NULL (crypto library too old) */
+aide_context *aide_new_context(void);
+
+int aide_parse_config(aide_context *, char *, char *, char *);
+
+int aide_scan(aide_context *);
+
+void aide_foreach_result(aide_context *, aide_result_callback, void *);
+
+/* Return: exit code of the report (see man aide) */
+int aide_report(aide_context *);
+
+/* free the context and everything it owns (configuration, rule tree,
+ * entries, databases and report outputs), the results of
+ * aide_foreach_result() must not be used afterwards */
+void aide_free_context(aide_context *);
+
+#endif
@@ -63,10 +63,19 @@ typedef struct md_container {
   gcry_md_hd_t mdh;
 #endif
 
+#ifdef WITH_AF_ALG
+  /* AF_ALG operation sockets, -1 if hashsum is not calculated by the kernel */
+  int alg_fd[num_hashes];
+  DB_ATTR_TYPE kernel_attr;
+#endif
+
 } md_container;
 
 int init_md(struct md_container*, const char*);
 int update_md(struct md_container*,void*,ssize_t);
+#ifdef WITH_AF_ALG
+int splice_md(struct md_container* [],int,int,off_t*,off_t,off_t*);
+#endif
 int close_md(struct md_container*);
 void md2line(struct md_container*,struct db_line*);
 
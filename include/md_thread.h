@@ -0,0 +1,47 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _MD_THREAD_H_INCLUDED
+#define _MD_THREAD_H_INCLUDED
+
+#include <stddef.h>
+#include "md.h"
+
+/* size of the blocks passed to the hashing thread */
+#define MD_THREAD_BLOCK_SIZE (64*1024)
+
+/* number of blocks of the ring buffer */
+#define MD_THREAD_NUM_BLOCKS 16
+
+/*
+ * An md thread updates an md_container on a separate thread. The data is
+ * copied into a ring buffer of blocks by md_thread_update(). After
+ * md_thread_finish() the md_container can be closed.
+ */
+typedef struct md_thread md_thread;
+
+/* Return: thread / NULL (thread could not be started) */
+md_thread *md_thread_start(struct md_container *);
+
+void md_thread_update(md_thread *, const void *, size_t);
+
+void md_thread_finish(md_thread *);
+
+#endif
@@ -41,6 +41,9 @@ bool init_report_urls();
 
 bool add_report_url(url_t* url, int, char*, char*);
 
+/* close the report outputs and free the report URLs of conf */
+void free_report_urls();
+
 REPORT_LEVEL get_report_level(char *);
 
 void log_report_urls(LOG_LEVEL);
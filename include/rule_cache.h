@@ -0,0 +1,39 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _RULE_CACHE_H_INCLUDED
+#define _RULE_CACHE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rx_rule.h"
+
+/*
+ * The rule cache file holds the serialized patterns (without JIT code) of
+ * all regex rules of a configuration, identified by a fingerprint of the
+ * rules.
+ */
+
+/* Return: true (all codes decoded) / false (missing, stale or invalid cache) */
+bool rule_cache_read(const char *, uint64_t, pcre2_code **, int32_t);
+
+void rule_cache_write(const char *, uint64_t, pcre2_code **, int32_t);
+
+#endif
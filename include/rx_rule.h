@@ -24,9 +24,11 @@
 
 #include "attributes.h"
 #include "seltree_struct.h"
+#include <stdbool.h>
 #include <sys/stat.h>
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
+#include <pthread.h>
 
 #define RESTRICTION_TYPE unsigned int
 #define FT_REG   (1U<<0) /* file */
@@ -40,10 +42,21 @@
 #define FT_PORT  (1U<<8) /* port */
 #define FT_NULL  0U
 
+/* JIT compilation state of a regex rule */
+#define RULE_JIT_PENDING 0
+#define RULE_JIT_DONE    1
+
+struct glob_rule;
+
 typedef struct rx_rule {
   char* rx; /* Regular expression in text form */
-  pcre2_code* crx; /* Compiled regexp */
-  pcre2_match_data *md;
+  pcre2_code* crx; /* Compiled regexp, NULL for literal and glob rules */
+  struct glob_rule* glob; /* Compiled glob, NULL for regex rules */
+  char* literal; /* unescaped path of a rule without regex syntax */
+  size_t literal_len;
+  bool literal_eol; /* literal rule ends with '$' */
+  int jit_state;
+  pthread_mutex_t jit_mutex; /* held while the regex is JIT-compiled */
   DB_ATTR_TYPE attr; /* Which attributes to save */
   seltree *node;
   char *config_filename;
@@ -66,6 +79,9 @@ typedef enum {
 char* get_rule_type_long_string(AIDE_RULE_TYPE);
 char* get_rule_type_char(AIDE_RULE_TYPE);
 
+/* Return: fingerprint of the attributes and the restriction of the rule (>= 0) */
+long long get_rule_fingerprint(rx_rule *);
+
 /* memory for the returned string is obtained with malloc(3), and should be freed with free(3). */
 char *get_restriction_string(RESTRICTION_TYPE);
 
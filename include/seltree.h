@@ -25,15 +25,58 @@
 #include "rx_rule.h"
 #include "seltree_struct.h"
 
+/* per-caller state of the rule evaluation
+ * md is the match data used for all regexes (only match/no match is needed)
+ * pending_nodes is the list of nodes to be added to the tree (see
+ * add_pending_seltree_nodes())
+ */
+typedef struct seltree_match_ctx {
+  pcre2_match_data *md;
+  list *pending_nodes;
+} seltree_match_ctx;
+
 seltree* init_tree();
 
+/* free the nodes and the rules of the tree, the entries of the nodes
+ * (old_data/new_data) have to be freed by the caller */
+void free_tree(seltree *);
+
 seltree* new_seltree_node(seltree*, char*, int, rx_rule*);
 
 seltree* get_seltree_node(seltree* ,char*);
 
-rx_rule * add_rx_to_tree(char *, RESTRICTION_TYPE, int, seltree *, int, char *, char *);
+void add_seltree_child(seltree *, seltree *);
+
+/* while building the tree in bulk (e.g. while parsing the configuration)
+ * new childs are appended and the child lists are sorted once by
+ * end_bulk_build()
+ */
+void begin_bulk_build(void);
+
+void end_bulk_build(seltree *);
+
+/* compile the regex rules added during the bulk build, cache is the path
+ * of the rule cache or NULL
+ * Return: true (success) / false (invalid regex)
+ */
+bool compile_rules(const char *);
+
+void log_rule_stats(LOG_LEVEL);
+
+rx_rule * add_rx_to_tree(char *, bool, RESTRICTION_TYPE, int, seltree *, int, char *, char *);
+
+seltree_match_ctx *new_seltree_match_ctx(void);
+
+void free_seltree_match_ctx(seltree_match_ctx *);
+
+/* reentrant, the tree is only read and new nodes are queued in the context
+ * (one context per thread) */
+int check_seltree(seltree *, char *, RESTRICTION_TYPE, rx_rule* *, seltree_match_ctx *);
+
+void add_pending_node(seltree_match_ctx *, seltree *, char *);
 
-int check_seltree(seltree *, char *, RESTRICTION_TYPE, rx_rule* *);
+/* must not be called concurrently with check_seltree() on the same tree */
+void add_pending_seltree_nodes(seltree_match_ctx *);
 
 int treedepth(seltree *);
 
@@ -31,6 +31,7 @@
  * path is the path of the node
  * parent is the parent, NULL if root
  * childs is list of seltree*:s
+ * child_index is a tsearch(3) tree of the childs (ordered by path)
  * new_data is this nodes new attributes (read from disk or db in --compare)
  * old_data is this nodes old attributes (read from db)
  * attr attributes to add for this node and possibly for its children
@@ -41,6 +42,7 @@ typedef struct seltree {
   list* neg_rx_lst;
   list* equ_rx_lst;
   list* childs;
+  void* child_index;
   struct seltree* parent;
 
   char* path;
@@ -45,6 +45,15 @@
 typedef uint8_t byte;
 #endif
 
+/* nanoseconds of the timestamps of a struct stat (0 if not available) */
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+#define get_mtime_nsec(fs) ((fs)->st_mtim.tv_nsec)
+#define get_ctime_nsec(fs) ((fs)->st_ctim.tv_nsec)
+#else
+#define get_mtime_nsec(fs) 0
+#define get_ctime_nsec(fs) 0
+#endif
+
 const char* btoa(bool);
 
 void* checked_malloc(size_t);
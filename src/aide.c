@@ -36,6 +36,7 @@
 #include <unistd.h>
 #endif
 
+#include "aide.h"
 #include "attributes.h"
 #include "hashsum.h"
 #include "rx_rule.h"
@@ -45,28 +46,20 @@
 #include "db_config.h"
 #include "db_disk.h"
 #include "db.h"
+#include "do_md.h"
 #include "log.h"
 #include "seltree.h"
 #include "errorcodes.h"
 #include "gen_list.h"
 #include "getopt.h"
+#include "libaide.h"
 #include "util.h"
 /*for locale support*/
 #include "locale-aide.h"
 /*for locale support*/
-db_config* conf;
 char* before = NULL;
 char* after = NULL;
 
-#ifndef MAXHOSTNAMELEN
-#define MAXHOSTNAMELEN 256
-#endif
-
-#ifdef WITH_GCRYPT
-#include <gcrypt.h>
-#define NEED_LIBGCRYPT_VERSION "1.8.0"
-#endif
-
 static void usage(int exitvalue)
 {
   fprintf(stdout,
@@ -77,6 +70,8 @@ static void usage(int exitvalue)
 	    "  -n, --dry-init\tTraverse the file system and match each file against rule tree\n"
 	    "  -C, --check\t\tCheck the database\n"
 	    "  -u, --update\t\tCheck and update the database non-interactively\n"
+	    "  -U, --update-config\tUpdate the database, read only entries with changed rules from disk\n"
+	    "\t\t\t(changes of the other files are NOT detected, but copied into the new database)\n"
 	    "  -E, --compare\t\tCompare two databases\n\n"
 	    "Miscellaneous:\n"
 	    "  -D,\t\t\t--config-check\t\t\tTest the configuration file\n"
@@ -107,23 +102,11 @@ static void init_sighandler()
   return;
 }
 
-static void init_crypto_lib() {
-/* libmhash does not need to be initialized */
-#ifdef WITH_GCRYPT
-  if(!gcry_check_version(NEED_LIBGCRYPT_VERSION)) {
-      log_msg(LOG_LEVEL_ERROR, "libgcrypt is too old (need %s, have %s)", NEED_LIBGCRYPT_VERSION, gcry_check_version (NULL));
-      exit(VERSION_MISMATCH_ERROR);
-  }
-  gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
-  gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
-#endif
-}
-
 static void sig_handler(int signum)
 {
   switch(signum){
   case SIGBUS  : {
-    if(conf->catch_mmap==1){
+    if(conf && conf->catch_mmap==1){
       log_msg(LOG_LEVEL_NOTICE, "Caught SIGBUS while mmapping. File was truncated while aide was running?");
       conf->catch_mmap=0;
     } else {
@@ -239,6 +222,7 @@ static void read_param(int argc,char**argv)
     { "dry-init", no_argument, NULL, 'n'},
     { "check", no_argument, NULL, 'C'},
     { "update", no_argument, NULL, 'u'},
+    { "update-config", no_argument, NULL, 'U'},
     { "config-check", no_argument, NULL, 'D'},
     { "path-check", required_argument, NULL, 'p'},
     { "limit", required_argument, NULL, 'l'},
@@ -248,7 +232,7 @@ static void read_param(int argc,char**argv)
   };
 
   while(1){
-    int option = getopt_long(argc, argv, "hL:V::vc:l:p:B:A:riCuDEn", options, &i);
+    int option = getopt_long(argc, argv, "hL:V::vc:l:p:B:A:riCuUDEn", options, &i);
     if(option==-1)
       break;
     switch(option)
@@ -291,12 +275,6 @@ static void read_param(int argc,char**argv)
                     INVALID_ARGUMENT("--limit", error in regular expression '%s' at %zu: %s, conf->limit, pcre2_erroffset, pcre2_error)
 
                 }
-                conf->limit_md = pcre2_match_data_create_from_pattern(conf->limit_crx, NULL);
-                if (conf->limit_md == NULL) {
-                    log_msg(LOG_LEVEL_ERROR, "pcre2_match_data_create_from_pattern: failed to allocate memory");
-                    exit(EXIT_FAILURE);
-                }
-
                 int pcre2_jit = pcre2_jit_compile(conf->limit_crx, PCRE2_JIT_PARTIAL_SOFT);
                 if (pcre2_jit < 0) {
                     PCRE2_UCHAR pcre2_error[128];
@@ -324,7 +302,11 @@ static void read_param(int argc,char**argv)
                 conf->action=DO_DRY_RUN;
                 log_msg(LOG_LEVEL_INFO,"(--path-check): path check command");
 
-                if (strlen(optarg) >= 3 && optarg[1] == ':') {
+                if (strcmp(optarg, "-") == 0 || strcmp(optarg, "-0") == 0) {
+                    conf->check_path_batch = true;
+                    conf->check_path_delimiter = optarg[1]?'\0':'\n';
+                    log_msg(LOG_LEVEL_INFO,"(--path-check): read %s separated paths from stdin", optarg[1]?"NUL":"newline");
+                } else if (strlen(optarg) >= 3 && optarg[1] == ':') {
                     RESTRICTION_TYPE file_type = get_restriction_from_char(*optarg);
                     if (file_type == FT_NULL) {
                         INVALID_ARGUMENT("--path-check", invalid file type '%c' (see man aide for details), *optarg)
@@ -353,6 +335,7 @@ static void read_param(int argc,char**argv)
       ACTION_CASE("--dry-init", 'n', DO_INIT|DO_DRY_RUN, "dry init")
       ACTION_CASE("--check", 'C', DO_COMPARE, "database check")
       ACTION_CASE("--update", 'u', DO_INIT|DO_COMPARE, "database update")
+      ACTION_CASE("--update-config", 'U', DO_INIT|DO_COMPARE|DO_CONFIG_UPDATE, "database update for config changes")
       ACTION_CASE("--compare", 'E', DO_DIFF, "database compare")
       ACTION_CASE("--config-check", 'D', DO_DRY_RUN, "config check")
       default: /* '?' */
@@ -364,209 +347,72 @@ static void read_param(int argc,char**argv)
     fprintf(stderr, "%s: extra parameter: '%s'\n", argv[0], argv[optind]);
     exit(INVALID_ARGUMENT_ERROR);
   }
-}
-
-static void setdefaults_before_config()
-{
-  DB_ATTR_TYPE X;
-
-  conf=(db_config*)checked_malloc(sizeof(db_config));
-  conf->defsyms=NULL;
-
-  /* Setting some defaults */
-
-  log_msg(LOG_LEVEL_INFO, "initialise rule tree");
-  conf->tree=init_tree();
-  conf->database_add_metadata=1;
-  conf->report_detailed_init=0;
-  conf->report_base16=0;
-  conf->report_quiet=0;
-  conf->report_append=false;
-  conf->report_ignore_added_attrs = 0;
-  conf->report_ignore_removed_attrs = 0;
-  conf->report_ignore_changed_attrs = 0;
-  conf->report_force_attrs = 0;
-#ifdef WITH_E2FSATTRS
-  conf->report_ignore_e2fsattrs = 0UL;
-#endif
-
-  conf->check_path=NULL;
-  conf->check_file_type = FT_REG;
-
-  conf->report_urls=NULL;
-  conf->report_level=REPORT_LEVEL_CHANGED_ATTRIBUTES;
-
-  conf->config_file=
-#ifdef CONFIG_FILE
-          CONFIG_FILE
-#else
-      NULL
-#endif
-      ;
-  conf->config_version=NULL;
-  conf->config_check_warn_unrestricted_rules = false;
-  
-#ifdef WITH_ACL
-  conf->no_acl_on_symlinks=0; /* zero means don't do ACLs on symlinks */
-#endif
-  conf->db_out_attrs = ATTR(attr_filename)|ATTR(attr_attr)|ATTR(attr_perm)|ATTR(attr_inode);
-
-  conf->symlinks_found=0;
-
-  conf->database_in.url = NULL;
-  conf->database_in.filename=NULL;
-  conf->database_in.linenumber=0;
-  conf->database_in.linebuf=NULL;
-  conf->database_in.fp=NULL;
-#ifdef WITH_ZLIB
-  conf->database_in.gzp = NULL;
-#endif
-  conf->database_in.lineno = 0;
-  conf->database_in.fields = NULL;
-  conf->database_in.num_fields = 0;
-  conf->database_in.buffer_state = NULL;
-  conf->database_in.mdc = NULL;
-  conf->database_in.db_line = NULL;
-
-  conf->database_out.url = NULL;
-  conf->database_out.filename=NULL;
-  conf->database_out.linenumber=0;
-  conf->database_out.linebuf=NULL;
-  conf->database_out.fp=NULL;
-#ifdef WITH_ZLIB
-  conf->database_out.gzp = NULL;
-#endif
-  conf->database_out.lineno = 0;
-  conf->database_out.fields = NULL;
-  conf->database_out.num_fields = 0;
-  conf->database_out.buffer_state = NULL;
-  conf->database_out.mdc = NULL;
-  conf->database_out.db_line = NULL;
-
-  conf->database_new.url = NULL;
-  conf->database_new.filename=NULL;
-  conf->database_new.linenumber=0;
-  conf->database_new.linebuf=NULL;
-  conf->database_new.fp=NULL;
-#ifdef WITH_ZLIB
-  conf->database_new.gzp = NULL;
-#endif
-  conf->database_new.lineno = 0;
-  conf->database_new.fields = NULL;
-  conf->database_new.num_fields = 0;
-  conf->database_new.buffer_state = NULL;
-  conf->database_new.mdc = NULL;
-  conf->database_new.db_line = NULL;
-
-  conf->db_attrs = get_hashes(false);
-  
-#ifdef WITH_ZLIB
-  conf->gzip_dbout=0;
-#endif
-
-  conf->action=0;
-  conf->catch_mmap=0;
-
-  conf->warn_dead_symlinks=0;
-
-  conf->report_grouped=1;
-
-  conf->report_summarize_changes=1;
 
-  conf->root_prefix=NULL;
-  conf->root_prefix_length=0;
-
-  conf->limit=NULL;
-  conf->limit_crx=NULL;
-
-  conf->groupsyms=NULL;
-
-  conf->start_time=time(NULL);
-
-  log_msg(LOG_LEVEL_INFO, "define default group definitions");
-
-  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
-      if (attributes[i].config_name) {
-          do_groupdef(attributes[i].config_name, attributes[i].attr);
-      }
+  if (conf->check_path_batch && conf->config_file && strcmp(conf->config_file, "-") == 0) {
+    INVALID_ARGUMENT("--path-check", %s, "cannot read paths and configuration from stdin")
   }
-
-  X=0LLU;
-#ifdef WITH_ACL
-  X|=ATTR(attr_acl);
-#endif
-#ifdef WITH_SELINUX
-  X|=ATTR(attr_selinux);
-#endif
-#ifdef WITH_XATTR
-  X|=ATTR(attr_xattrs);
-#endif
-#ifdef WITH_E2FSATTRS
-  X|=ATTR(attr_e2fsattrs);
-#endif
-#ifdef WITH_CAPABILITIES
-  X|=ATTR(attr_capabilities);
-#endif
-
-  DB_ATTR_TYPE common_attrs = ATTR(attr_perm)|ATTR(attr_ftype)|ATTR(attr_inode)|ATTR(attr_linkcount)|ATTR(attr_uid)|ATTR(attr_gid);
-
-  DB_ATTR_TYPE GROUP_R_HASHES=0LLU;
-#ifdef WITH_MHASH
-  GROUP_R_HASHES=ATTR(attr_md5);
-#endif
-#ifdef WITH_GCRYPT
-  if (gcry_fips_mode_active()) {
-    char* str;
-    log_msg(LOG_LEVEL_NOTICE, "libgcrypt is running in FIPS mode, the following hash(es) are not available: %s", str = diff_attributes(0, ATTR(attr_md5)));
-    free(str);
-  } else {
-    GROUP_R_HASHES = ATTR(attr_md5);
-  }
-#endif
-
-  do_groupdef("R",common_attrs|ATTR(attr_size)|ATTR(attr_linkname)|ATTR(attr_mtime)|ATTR(attr_ctime)|GROUP_R_HASHES|X);
-  do_groupdef("L",common_attrs|ATTR(attr_linkname)|X);
-  do_groupdef(">",common_attrs|ATTR(attr_sizeg)|ATTR(attr_linkname)|X);
-  do_groupdef("H",get_hashes(false));
-  do_groupdef("X",X);
-  do_groupdef("E",0);
-
 }
 
-static void setdefaults_after_config()
-{
-  int linenumber=1;
-
-#ifdef DEFAULT_DB
-  if(conf->database_in.url==NULL){
-    do_dbdef(DB_TYPE_IN, DEFAULT_DB, linenumber++, "(default)",  NULL);
-  }
-#endif
-#ifdef DEFAULT_DB_OUT
-  if(conf->database_out.url==NULL){
-    do_dbdef(DB_TYPE_OUT, DEFAULT_DB_OUT, linenumber++, "(default)",  NULL);
-  }
-#endif
-
-  if(conf->root_prefix==NULL){
-    do_rootprefix("" , linenumber++, "(default)",  NULL);
-  }
-
-  if(conf->report_urls==NULL){
-    do_repurldef("stdout" , linenumber++, "(default)",  NULL);
-  }
-
-  if(conf->action==0){
-    conf->action=DO_COMPARE;
-  }
-
-  if (is_log_level_unset()) {
-          set_log_level(LOG_LEVEL_WARNING);
-  };
+/*
+ * check_paths()
+ * match the records '<file_type>:<path>' read from in against the rule tree
+ * and write one result per record to stdout (terminated by delim):
+ * <result>\t<file_type>\t<rule_type>\t<config_file>\t<config_linenumber>\t<path>
+ * result is 'match', 'no_match', 'outside_limit' or 'invalid' (invalid record)
+ * rule_type is 'selective', 'equal', 'negative' or '-' (no matching rule)
+ * config_file and path are URL-encoded like the paths in the database, so
+ * they never contain the field separator or delim
+ */
+static int check_paths(FILE *in, int delim) {
+    char *record = NULL;
+    size_t size = 0;
+    ssize_t len;
+    unsigned long n = 0;
+    seltree_match_ctx *ctx = new_seltree_match_ctx();
+
+    while ((len = getdelim(&record, &size, delim, in)) != -1) {
+        if (len > 0 && record[len-1] == delim) {
+            record[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        const char *result = "invalid";
+        const char *rule_type = "-";
+        rx_rule *rule = NULL;
+        RESTRICTION_TYPE file_type = (len >= 3 && record[1] == ':' && record[2] == '/')?get_restriction_from_char(*record):FT_NULL;
+        if (file_type != FT_NULL) {
+            int match = check_rxtree(record+2, conf->tree, &rule, file_type, false, ctx);
+            if (match < 0) {
+                result = "outside_limit";
+                rule = NULL;
+            } else {
+                result = match?"match":"no_match";
+                if (rule) {
+                    rule_type = match == EQUAL_MATCH?"equal":match == SELECTIVE_MATCH?"selective":"negative";
+                }
+            }
+        }
+        char *path = encode_string(file_type != FT_NULL?record+2:record);
+        char *config_file = rule?encode_string(rule->config_filename):NULL;
+        fprintf(stdout, "%s\t%c\t%s\t%s\t%d\t%s", result, file_type != FT_NULL?*record:'-', rule_type,
+                config_file?config_file:"-", rule?rule->config_linenumber:0, path);
+        fputc(delim, stdout);
+        free(config_file);
+        free(path);
+        fflush(stdout);
+        n++;
+    }
+    free(record);
+    free_seltree_match_ctx(ctx);
+    if (ferror(in)) {
+        log_msg(LOG_LEVEL_ERROR, "(--path-check): failed to read paths from stdin: %s", strerror(errno));
+        return IO_ERROR;
+    }
+    log_msg(LOG_LEVEL_INFO, "(--path-check): checked %lu path(s)", n);
+    return RETOK;
 }
 
-
-
 int main(int argc,char**argv)
 {
   int errorno=0;
@@ -579,153 +425,49 @@ int main(int argc,char**argv)
   umask(0177);
   init_sighandler();
 
-  init_crypto_lib();
-
-  setdefaults_before_config();
+  aide_context *ctx = aide_new_context();
+  if (ctx == NULL) {
+    exit(VERSION_MISMATCH_ERROR);
+  }
 
   log_msg(LOG_LEVEL_INFO, "read command line parameters");
   read_param(argc,argv);
 
-  /* get hostname */
-  conf->hostname = checked_malloc(sizeof(char) * MAXHOSTNAMELEN + 1);
-  if (gethostname(conf->hostname,MAXHOSTNAMELEN) == -1) {
-      log_msg(LOG_LEVEL_WARNING,"gethostname failed: %s", strerror(errno));
-      free(conf->hostname);
-      conf->hostname = NULL;
-  } else {
-      log_msg(LOG_LEVEL_DEBUG, "hostname: '%s'", conf->hostname);
-  }
-
-  log_msg(LOG_LEVEL_INFO, "parse configuration");
-  errorno=parse_config(before, conf->config_file, after);
-  if (errorno==RETFAIL){
-    exit(INVALID_CONFIGURELINE_ERROR);
-  }
+  errorno=aide_parse_config(ctx, before, conf->config_file, after);
   free (before);
   free (after);
+  if (errorno!=RETOK){
+    aide_free_context(ctx);
+    exit(errorno);
+  }
 
-  setdefaults_after_config();
-
-  log_msg(LOG_LEVEL_CONFIG, "report_urls:");
-  log_report_urls(LOG_LEVEL_CONFIG);
-
-  log_msg(LOG_LEVEL_RULE, "rule tree:");
-  log_tree(LOG_LEVEL_RULE, conf->tree, 0);
-
-  if (conf->check_path) {
+  if (conf->check_path_batch) {
+      errorno = check_paths(stdin, conf->check_path_delimiter);
+      log_rule_stats(LOG_LEVEL_INFO);
+  } else if (conf->check_path) {
       rx_rule* rule = NULL;
-      int match = check_rxtree(conf->check_path, conf->tree, &rule, conf->check_file_type, true);
+      seltree_match_ctx *match_ctx = new_seltree_match_ctx();
+      int match = check_rxtree(conf->check_path, conf->tree, &rule, conf->check_file_type, true, match_ctx);
+      free_seltree_match_ctx(match_ctx);
+      log_rule_stats(LOG_LEVEL_INFO);
       if (match < 0) {
         fprintf(stdout, "[ ] %c '%s': outside of limit '%s'\n", get_restriction_char(conf->check_file_type), conf->check_path, conf->limit);
-        exit(2);
+        errorno = 2;
       } else {
-        exit(match?0:1);
-      }
-  }
-
-  /* Let's do some sanity checks for the config */
-  if (conf->action&(DO_DIFF|DO_COMPARE) && !(conf->database_in.url)) {
-    log_msg(LOG_LEVEL_ERROR,_("missing 'database_in', config option is required"));
-    exit(INVALID_ARGUMENT_ERROR);
-  }
-  if (conf->action&DO_INIT && !(conf->database_out.url)) {
-    log_msg(LOG_LEVEL_ERROR,_("missing 'database_out', config option is required"));
-    exit(INVALID_ARGUMENT_ERROR);
-  }
-  if(conf->database_in.url && conf->database_out.url && cmpurl(conf->database_in.url,conf->database_out.url)==RETOK){
-      log_msg(LOG_LEVEL_NOTICE, "input and output database URLs are the same: '%s'", (conf->database_in.url)->value);
-    if((conf->action&DO_INIT)&&(conf->action&DO_COMPARE)){
-      log_msg(LOG_LEVEL_ERROR,_("input and output database urls cannot be the same "
-	    "when doing database update"));
-      exit(INVALID_ARGUMENT_ERROR);
-    }
-    if(conf->action&DO_DIFF){
-      log_msg(LOG_LEVEL_ERROR,_("both input databases cannot be the same "
-		"when doing database compare"));
-      exit(INVALID_ARGUMENT_ERROR);
-    }
-  };
-  if((conf->action&DO_DIFF)&&(!(conf->database_new.url)||!(conf->database_in.url))){
-    log_msg(LOG_LEVEL_ERROR,_("must have both input databases defined for "
-	      "database compare"));
-    exit(INVALID_ARGUMENT_ERROR);
-  }
-
-  /* ensure size attribute is added to db_out_attrs if sizeg attribute is set */
-  if (conf->db_out_attrs & ATTR(attr_sizeg)) {
-        conf->db_out_attrs |=ATTR(attr_size);
-  }
-
-  if (conf->action&DO_INIT && conf->action&DO_DRY_RUN) {
-      if(db_disk_init()==RETFAIL) {
-          exit(IO_ERROR);
+        errorno = match?0:1;
       }
-      log_msg(LOG_LEVEL_INFO, "populate tree (dry-run)");
-      populate_tree(conf->tree, true);
-      exit (0);
-  }
-
-  if (!(conf->action&DO_DRY_RUN)) {
+  } else {
+      errorno=aide_scan(ctx);
+      if (errorno==RETOK && !(conf->action&DO_DRY_RUN)) {
+        log_msg(LOG_LEVEL_INFO, "generate reports");
 
-  if (!init_report_urls()) {
-      exit(INVALID_CONFIGURELINE_ERROR);
-  }
+        errorno = aide_report(ctx);
 
-  if (conf->action&(DO_INIT|DO_COMPARE) && conf->root_prefix_length > 0) {
-      DIR *dir;
-      if((dir = opendir(conf->root_prefix)) != NULL) {
-          closedir(dir);
-      } else {
-          log_msg(LOG_LEVEL_ERROR,"opendir() for root_prefix %s failed: %s", conf->root_prefix, strerror(errno));
-          exit(INVALID_CONFIGURELINE_ERROR);
+        log_msg(LOG_LEVEL_INFO, "exit AIDE with exit code '%d'", errorno);
       }
   }
-    if(conf->action&DO_INIT){
-      if(db_init(&(conf->database_out), false,
-#ifdef WITH_ZLIB
-        conf->gzip_dbout
-#else
-        false
-#endif
-       ) == RETFAIL) {
-	exit(IO_ERROR);
-      }
-      if(db_writespec(conf)==RETFAIL){
-	log_msg(LOG_LEVEL_ERROR,_("Error while writing database. Exiting.."));
-	exit(IO_ERROR);
-      }
-    }
-    if((conf->action&DO_INIT)||(conf->action&DO_COMPARE)){
-      if(db_disk_init()==RETFAIL)
-	exit(IO_ERROR);
-    }
-    if((conf->action&DO_COMPARE)||(conf->action&DO_DIFF)){
-      if(db_init(&(conf->database_in), true, false)==RETFAIL)
-	exit(IO_ERROR);
-    }
-    if(conf->action&DO_DIFF){
-      if(db_init(&(conf->database_new), true, false)==RETFAIL)
-	exit(IO_ERROR);
-    }
-      
-    log_msg(LOG_LEVEL_INFO, "populate tree");
-    populate_tree(conf->tree, false);
 
-    if(conf->action&DO_INIT) {
-        log_msg(LOG_LEVEL_INFO, "write new entries to database: %s:%s", get_url_type_string((conf->database_out.url)->type), (conf->database_out.url)->value);
-        write_tree(conf->tree);
-    }
-
-    db_close();
-
-    log_msg(LOG_LEVEL_INFO, "generate reports");
-
-    int exitcode = gen_report(conf->tree);
-
-    log_msg(LOG_LEVEL_INFO, "exit AIDE with exit code '%d'", exitcode);
-
-    exit(exitcode);
-  }
-  return RETOK;
+  aide_free_context(ctx);
+  exit(errorno);
 }
 // vi: ts=8 sw=8
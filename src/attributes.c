@@ -66,6 +66,10 @@ attributes_t attributes[] = {
     { ATTR(attr_capabilities),   "caps",         "Caps",        "capabilities", 'C'   },
     { ATTR(attr_stribog256),     "stribog256",   "STRIBOG256" ,  "stribog256",  '\0'  },
     { ATTR(attr_stribog512),     "stribog512",   "STRIBOG512" ,  "stribog512",  '\0'  },
+    { ATTR(attr_chunks),         "chunks",       "Chunks",      "chunks",       '\0'  },
+    { ATTR(attr_fsverity),       "fsverity",     "FSVerity",    "fsverity",     '\0'  },
+    { ATTR(attr_verified),       NULL,           NULL,          "verified",     '\0'  },
+    { ATTR(attr_rule),           NULL,           NULL,          "rule",         '\0'  },
 };
 
 DB_ATTR_TYPE num_attrs = sizeof(attributes)/sizeof(attributes_t);
@@ -33,6 +33,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <assert.h>
 #include "base64.h"
 #include "util.h"
@@ -165,9 +166,11 @@ char* encode_base64(byte* src,size_t ssize)
   return outbuf;
 }
 
-byte* decode_base64(char* src,size_t ssize, size_t *ret_len)
+/* the decoded data is written to outbuf (if not NULL) or to a new buffer,
+ * as the output never gets ahead of the input, outbuf may be src */
+static byte* decode_base64_to(char* src,size_t ssize, size_t *ret_len, byte* outbuf)
 {
-  byte* outbuf;
+  bool allocated = outbuf == NULL;
   char* inb;
   int i;
   int l;
@@ -192,7 +195,9 @@ byte* decode_base64(char* src,size_t ssize, size_t *ret_len)
 
   /* Initialize working pointers */
   inb = src;
-  outbuf = (byte *)checked_malloc(length + 1);
+  if (allocated) {
+    outbuf = (byte *)checked_malloc(length + 1);
+  }
 
   l = 0;
   triple = 0;
@@ -208,8 +213,10 @@ byte* decode_base64(char* src,size_t ssize, size_t *ret_len)
       switch(i)
 	{
 	case FAIL:
-	  log_msg(LOG_LEVEL_WARNING, "decode_base64: illegal character: '%c' in '%s'", *inb, src);
-	  free(outbuf);
+	  log_msg(LOG_LEVEL_WARNING, "decode_base64: illegal character: '%c' in '%s'", *inb, allocated?src:inb);
+	  if (allocated) {
+	    free(outbuf);
+	  }
 	  return NULL;
 	  break;
 	case SKIP:
@@ -250,6 +257,16 @@ byte* decode_base64(char* src,size_t ssize, size_t *ret_len)
   return outbuf;
 }
 
+byte* decode_base64(char* src,size_t ssize, size_t *ret_len)
+{
+  return decode_base64_to(src, ssize, ret_len, NULL);
+}
+
+byte* decode_base64_in_place(char* src,size_t ssize, size_t *ret_len)
+{
+  return decode_base64_to(src, ssize, ret_len, (byte *)src);
+}
+
 size_t length_base64(char* src,size_t ssize)
 {
   char* inb;
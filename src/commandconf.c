@@ -153,44 +153,42 @@ url_t* parse_url(char* val, int linenumber, char* filename, char* linebuf)
   return u;
 }
 
+static int parse_config_ast(void) {
+    ast* config_ast = NULL;
+    if(confparse(&config_ast)){
+      return RETFAIL;
+    }
+    conf_lex_delete_buffer();
+    eval_config(config_ast, 0);
+    deep_free(config_ast);
+    return RETOK;
+}
+
 int parse_config(char *before, char *config, char* after) {
     if(before==NULL && after==NULL && (config==NULL||strcmp(config,"")==0)){
       log_msg(LOG_LEVEL_ERROR,_("missing configuration (use '--config' '--before' or '--after' command line parameter)"));
       return RETFAIL;
     }
 
-    ast* config_ast = NULL;
+    int retval = RETOK;
+    begin_bulk_build();
     if (before) {
         conf_lex_string("(--before)", before);
-        if(confparse(&config_ast)){
-          return RETFAIL;
-        }
-        conf_lex_delete_buffer();
-        eval_config(config_ast, 0);
-        deep_free(config_ast);
-        config_ast = NULL;
+        retval = parse_config_ast();
     }
-    if (config) {
+    if (config && retval == RETOK) {
         conf_lex_file(config);
-        if(confparse(&config_ast)){
-          return RETFAIL;
-        }
-        conf_lex_delete_buffer();
-        eval_config(config_ast, 0);
-        deep_free(config_ast);
-        config_ast = NULL;
+        retval = parse_config_ast();
     }
-    if (after) {
+    if (after && retval == RETOK) {
         conf_lex_string("(--after)", after);
-        if(confparse(&config_ast)){
-          return RETFAIL;
-        }
-        conf_lex_delete_buffer();
-        eval_config(config_ast, 0);
-        deep_free(config_ast);
-        config_ast = NULL;
+        retval = parse_config_ast();
     }
-  return RETOK;
+    end_bulk_build(conf->tree);
+    if (!compile_rules(retval == RETOK?conf->rule_cache:NULL)) {
+        retval = RETFAIL;
+    }
+  return retval;
 }
 
 int conf_input_wrapper(char* buf, int max_size, FILE* in)
@@ -217,9 +215,7 @@ int db_input_wrapper(char* buf, int max_size, database* db)
   case url_https:
   case url_ftp: {
     retval=url_fread(buf,1,max_size,(URL_FILE *)db->fp);
-    if (db->mdc) {
-        update_md(db->mdc, buf, retval);
-    }
+    update_db_attrs(db, buf, retval);
     break;
   } 
   default:
@@ -227,8 +223,12 @@ int db_input_wrapper(char* buf, int max_size, database* db)
 
 #ifdef WITH_ZLIB
   if (db->gzp!=NULL) {
-    c=gzgetc(db->gzp);
-    retval= (c==EOF) ? 0 : (buf[0] = c,1);
+    retval=gzread(db->gzp, buf, max_size);
+    if (retval<0) {
+      int xx;
+      log_msg(LOG_LEVEL_ERROR,"reading gzipped file failed: %s", gzerror(db->gzp,&xx));
+      exit(EXIT_FAILURE);
+    }
   }
   if (db->gzp==NULL) {
     c=fgetc(db->fp);
@@ -257,9 +257,7 @@ int db_input_wrapper(char* buf, int max_size, database* db)
   retval=fread(buf,1,max_size,db->fp);
 #endif /* WITH_ZLIB */
 
-  if (db->mdc) {
-      update_md(db->mdc, buf, retval);
-  }
+  update_db_attrs(db, buf, retval);
 
 
 #ifdef WITH_CURL
@@ -305,7 +303,7 @@ void do_undefine(char* name, int linenumber, char* filename, char* linebuf)
   }
 }
 
-bool add_rx_rule_to_tree(char* rx, RESTRICTION_TYPE restriction, DB_ATTR_TYPE attr, int type, seltree *tree, int linenumber, char* filename, char* linebuf) {
+bool add_rx_rule_to_tree(char* rx, bool glob, RESTRICTION_TYPE restriction, DB_ATTR_TYPE attr, int type, seltree *tree, int linenumber, char* filename, char* linebuf) {
 
     rx_rule* r=NULL;
 
@@ -314,7 +312,7 @@ bool add_rx_rule_to_tree(char* rx, RESTRICTION_TYPE restriction, DB_ATTR_TYPE at
     char *attr_str = NULL;
     char *rs_str = NULL;
 
-    if ((r = add_rx_to_tree(rx, restriction, type, tree, linenumber, filename, linebuf)) == NULL) {
+    if ((r = add_rx_to_tree(rx, glob, restriction, type, tree, linenumber, filename, linebuf)) == NULL) {
         retval = false;
     }else {
         r->config_linenumber = linenumber;
@@ -332,7 +330,7 @@ bool add_rx_rule_to_tree(char* rx, RESTRICTION_TYPE restriction, DB_ATTR_TYPE at
         r->attr=attr;
         conf->db_out_attrs |= attr;
 
-        LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "add %s '%s%s %s %s' to node '%s'", get_rule_type_long_string(type), get_rule_type_char(type), r->rx, rs_str = get_restriction_string(r->restriction), attr_str = diff_attributes(0, r->attr),  (r->node)->path)
+        LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "add %s '%s%s%s %s %s' to node '%s'", get_rule_type_long_string(type), get_rule_type_char(type), glob?"glob:":"", r->rx, rs_str = get_restriction_string(r->restriction), attr_str = diff_attributes(0, r->attr),  (r->node)->path)
         free(rs_str);
         free(attr_str);
 
@@ -174,15 +174,16 @@ ast* new_if_statement(struct if_condition* condition, struct ast* if_branch, str
       return e;
 }
 
-ast* new_rule_statement(AIDE_RULE_TYPE rule_type, string_expression* path, restriction_expression* restriction, attribute_expression* attrs) {
+ast* new_rule_statement(AIDE_RULE_TYPE rule_type, bool glob, string_expression* path, restriction_expression* restriction, attribute_expression* attrs) {
       ast* e = new_ast_node();
 
       e->type = rule_statement_type;
       e->statement._rule.type = rule_type;
+      e->statement._rule.glob = glob;
       e->statement._rule.path = path;
       e->statement._rule.restriction = restriction;
       e->statement._rule.attributes = attrs;
-      log_msg(ast_log_level, "ast: new rule statement (%p): type: %s, path: %p, restriction: %p, attributes: %p", e, get_rule_type_long_string(rule_type), path, restriction, attrs);
+      log_msg(ast_log_level, "ast: new rule statement (%p): type: %s, glob: %s, path: %p, restriction: %p, attributes: %p", e, get_rule_type_long_string(rule_type), btoa(glob), path, restriction, attrs);
       return e;
 }
 
@@ -273,6 +274,17 @@ void free_restriction_expression(restriction_expression *r) {
     free(r);
 }
 
+ast* reverse_statements(ast* statements) {
+    ast* reversed = NULL;
+    while (statements) {
+        ast* next = statements->next;
+        statements->next = reversed;
+        reversed = statements;
+        statements = next;
+    }
+    return reversed;
+}
+
 void deep_free(ast* config_ast) {
     if (config_ast == NULL) {
         return;
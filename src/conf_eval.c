@@ -42,6 +42,8 @@
 #include "util.h"
 
 #include "commandconf.h"
+#include "fs.h"
+#include "hash_cache.h"
 
 #include "symboltable.h"
 
@@ -183,6 +185,24 @@ static void set_database_attr_option(DB_ATTR_TYPE attr, int linenumber, char *fi
         conf->db_attrs = attr;
 }
 
+static void set_primary_hashsum_option(DB_ATTR_TYPE attr, int linenumber, char *filename, char* linebuf) {
+        char *str;
+
+        if (attr&(~get_hashes(true)) || (attr&(attr-1))) {
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "invalid primary hashsum: %s (expecting a single hashsum)", str = diff_attributes(0, attr));
+            free(str);
+            exit(INVALID_CONFIGURELINE_ERROR);
+        }
+        if (attr&~get_hashes(false)) {
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_WARNING, "ignoring unsupported primary hashsum: %s", str = diff_attributes(0, attr));
+            free(str);
+            attr = 0LLU;
+        }
+        LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'primary_hashsum' option to: %s", str = diff_attributes(0, attr));
+        free(str);
+        conf->primary_hashsum = attr;
+}
+
 static void eval_config_statement(config_option_statement statement, int linenumber, char *filename, char* linebuf) {
     char *str;
     bool b;
@@ -209,11 +229,27 @@ static void eval_config_statement(config_option_statement statement, int linenum
         DATABASE_CONFIG_OPTION_CASE(DATABASE_IN_OPTION, DB_TYPE_IN)
         DATABASE_CONFIG_OPTION_CASE(DATABASE_OUT_OPTION, DB_TYPE_OUT)
         DATABASE_CONFIG_OPTION_CASE(DATABASE_NEW_OPTION, DB_TYPE_NEW)
+        BOOL_CONFIG_OPTION_CASE(DATABASE_PARALLEL_READ_OPTION, database_parallel_read)
+        BOOL_CONFIG_OPTION_CASE(DATABASE_DICTIONARY_OPTION, database_dictionary)
+        BOOL_CONFIG_OPTION_CASE(DATABASE_PREFIX_COMPRESSION_OPTION, database_prefix_compression)
+        BOOL_CONFIG_OPTION_CASE(DATABASE_COLUMNAR_OPTION, database_columnar)
+#ifdef HAVE_MMAP
+        BOOL_CONFIG_OPTION_CASE(DATABASE_MMAP_OPTION, database_mmap)
+#else
+        case DATABASE_MMAP_OPTION:
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "%s", "mmap support not compiled in, recompile AIDE with '--with-mmap'")
+            exit(INVALID_CONFIGURELINE_ERROR);
+#endif
         case DATABASE_ATTRIBUTES_OPTION:
             set_database_attr_option(
                     eval_attribute_expression(statement.a, linenumber, filename, linebuf),
                     linenumber, filename, linebuf);
             break;
+        case PRIMARY_HASHSUM_OPTION:
+            set_primary_hashsum_option(
+                    eval_attribute_expression(statement.a, linenumber, filename, linebuf),
+                    linenumber, filename, linebuf);
+            break;
         case DATABASE_GZIP_OPTION:
 #ifdef WITH_ZLIB
             b = string_expression_to_bool(statement.e, linenumber, filename, linebuf);
@@ -224,6 +260,55 @@ static void eval_config_statement(config_option_statement statement, int linenum
 #endif
             break;
         BOOL_CONFIG_OPTION_CASE(DATABASE_ADD_METADATA_OPTION, database_add_metadata)
+        case RULE_CACHE_OPTION:
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            free(conf->rule_cache);
+            conf->rule_cache = str;
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'rule_cache' option to '%s'", str)
+            break;
+        case HASH_CACHE_OPTION:
+#ifdef HAVE_MMAP
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            free(conf->hash_cache);
+            conf->hash_cache = str;
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'hash_cache' option to '%s'", str)
+#else
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "%s", "mmap support not compiled in, recompile AIDE with '--with-mmap'")
+            exit(INVALID_CONFIGURELINE_ERROR);
+#endif
+            break;
+        case FILESYSTEM_OPTION:
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            if (!set_fs_backend(str)) {
+                LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "invalid file system backend: '%s'", str);
+                exit(INVALID_CONFIGURELINE_ERROR);
+            }
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'filesystem' option to '%s'", str)
+            free(str);
+            break;
+        case HASH_CACHE_ENTRIES_OPTION:
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            char *entries_endp;
+            long long entries = strtoll(str, &entries_endp, 10);
+            if (*str == '\0' || *entries_endp != '\0' || entries < HASH_CACHE_PROBES) {
+                LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "invalid number of hash cache entries: '%s' (expecting a number >= %d)", str, HASH_CACHE_PROBES);
+                exit(INVALID_CONFIGURELINE_ERROR);
+            }
+            conf->hash_cache_entries = entries;
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'hash_cache_entries' option to %lu", conf->hash_cache_entries)
+            free(str);
+            break;
+        BOOL_CONFIG_OPTION_CASE(HASH_CACHE_SAFE_MODE_OPTION, hash_cache_safe_mode)
+        BOOL_CONFIG_OPTION_CASE(INCREMENTAL_GROWING_FILES_OPTION, incremental_growing_files)
+        BOOL_CONFIG_OPTION_CASE(RULE_FINGERPRINTS_OPTION, rule_fingerprints)
+#ifdef WITH_AF_ALG
+        BOOL_CONFIG_OPTION_CASE(KERNEL_CRYPTO_OPTION, kernel_crypto)
+#else
+        case KERNEL_CRYPTO_OPTION:
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "%s", "AF_ALG support not compiled in, recompile AIDE with '--with-af-alg'")
+            exit(INVALID_CONFIGURELINE_ERROR);
+            break;
+#endif
         case ACL_NO_SYMLINK_FOLLOW_OPTION:
 #ifdef WITH_ACL
             b = string_expression_to_bool(statement.e, linenumber, filename, linebuf);
@@ -278,6 +363,59 @@ static void eval_config_statement(config_option_statement statement, int linenum
             }
             free(str);
             break;
+        case DATABASE_IN_CHECKSUM_OPTION:
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            char *digest = strchr(str, ':');
+            HASHSUM checksum_hash = num_hashes;
+            byte *checksum = NULL;
+            size_t checksum_len = 0;
+            if (digest) {
+                for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
+                    const char *name = attributes[hashsums[i].attribute].config_name;
+                    if (strlen(name) == (size_t) (digest - str) && strncmp(str, name, digest - str) == 0) {
+                        checksum_hash = i;
+                        break;
+                    }
+                }
+                digest++;
+            }
+            if (checksum_hash < num_hashes) {
+                checksum = base64tobyte(digest, strlen(digest), &checksum_len);
+            }
+            if (checksum == NULL || checksum_len != (size_t) hashsums[checksum_hash].length) {
+                LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "invalid database_in checksum: '%s' (expecting <hashsum>:<base64 encoded digest>)", str);
+                exit(INVALID_CONFIGURELINE_ERROR);
+            }
+            free(conf->database_in_checksum);
+            conf->database_in_checksum = checksum;
+            conf->database_in_checksum_hash = checksum_hash;
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'database_in_checksum' option to '%s'", str)
+            free(str);
+            break;
+        case CHUNK_SIZE_OPTION:
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            char *endp;
+            long long chunk_size = strtoll(str, &endp, 10);
+            if (*str == '\0' || *endp != '\0' || chunk_size <= 0) {
+                LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "invalid chunk size: '%s' (expecting a positive number of bytes)", str);
+                exit(INVALID_CONFIGURELINE_ERROR);
+            }
+            conf->chunk_size = chunk_size;
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'chunk_size' option to %lld", conf->chunk_size)
+            free(str);
+            break;
+        case ROLLING_REHASH_OPTION:
+            str = eval_string_expression(statement.e, linenumber, filename, linebuf);
+            char *runs_endp;
+            long long runs = strtoll(str, &runs_endp, 10);
+            if (*str == '\0' || *runs_endp != '\0' || runs < 0) {
+                LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_ERROR, "invalid number of runs for rolling re-hash: '%s' (expecting a number >= 0)", str);
+                exit(INVALID_CONFIGURELINE_ERROR);
+            }
+            conf->rolling_rehash = runs;
+            LOG_CONFIG_FORMAT_LINE(LOG_LEVEL_CONFIG, "set 'rolling_rehash' option to %lu", conf->rolling_rehash)
+            free(str);
+            break;
         case CONFIG_VERSION:
             str = eval_string_expression(statement.e, linenumber, filename, linebuf);
             conf->config_version = str;
@@ -649,6 +787,7 @@ static void eval_rule_statement(rule_statement statement, int linenumber, char *
      }
     if(!add_rx_rule_to_tree(
             rx,
+            statement.glob,
             eval_restriction_expression(statement.restriction, linenumber, filename, linebuf),
             eval_attribute_expression(statement.attributes, linenumber, filename, linebuf),
             statement.type,
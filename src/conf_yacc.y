@@ -46,6 +46,8 @@ void conferror(ast**, const char *);
 
   bool_operator operator;
 
+  bool glob;
+
   ast* ast;
 
   if_condition* if_cond;
@@ -79,13 +81,14 @@ void conferror(ast**, const char *);
 
 /* File rule */
 
-%token <s> TSELRXRULE "regular rule"
-%token <s> TEQURXRULE "equals rule"
-%token <s> TNEGRXRULE "negative rule"
+/* value: glob rule */
+%token <glob> TSELRXRULE "regular rule"
+%token <glob> TEQURXRULE "equals rule"
+%token <glob> TNEGRXRULE "negative rule"
 
 %token <option> CONFIGOPTION "configuration option"
 
-%type <ast> statements statement config_statement include_statement x_include_setenv_statement if_statement define_statement undefine_statement group_statement rule_statement
+%type <ast> statements statement_list statement config_statement include_statement x_include_setenv_statement if_statement define_statement undefine_statement group_statement rule_statement
 
 %type <if_cond> if_condition
 %type <bool_expr> bool_expression
@@ -103,11 +106,14 @@ void conferror(ast**, const char *);
 config : %empty  /* empty input */
        | statements { *config_ast = $1; }
 
-statements : statement TNEWLINE statements {
-               ast *temp = $1;
-               temp->next = $3;
-               $$ = $1; }
-               | statement TNEWLINE { $$ = $1; }
+/* left recursive to keep the parser stack small for large configurations */
+statements : statement_list { $$ = reverse_statements($1); }
+
+statement_list : statement_list TNEWLINE statement {
+                   ast *temp = $3;
+                   temp->next = $1;
+                   $$ = $3; }
+               | statement_list TNEWLINE { $$ = $1; }
                | statement { $$ = $1; }
 
 statement: config_statement
@@ -159,12 +165,12 @@ if_condition: TIFDEF string_expression { $$=new_if_condition(new_string_bool_exp
 bool_expression: TBOOLNOT bool_expression { $$ = new_bool_expression(BOOL_OP_NOT, $2, NULL); }
                | TBOOLFUNC string_expression { $$ = new_string_bool_expression($1, $2); }
 
-rule_statement: TSELRXRULE string_expression attribute_expression { $$ = new_rule_statement(AIDE_SELECTIVE_RULE, $2, NULL, $3); }
-              | TEQURXRULE string_expression attribute_expression { $$ = new_rule_statement(AIDE_EQUAL_RULE, $2, NULL, $3); }
-              | TNEGRXRULE string_expression { $$ = new_rule_statement(AIDE_NEGATIVE_RULE, $2, NULL, NULL); }
-              | TSELRXRULE string_expression restriction_expression attribute_expression { $$ = new_rule_statement(AIDE_SELECTIVE_RULE, $2, $3, $4); }
-              | TEQURXRULE string_expression restriction_expression attribute_expression { $$ = new_rule_statement(AIDE_EQUAL_RULE, $2, $3, $4); }
-              | TNEGRXRULE string_expression restriction_expression { $$ = new_rule_statement(AIDE_NEGATIVE_RULE, $2, $3, NULL); }
+rule_statement: TSELRXRULE string_expression attribute_expression { $$ = new_rule_statement(AIDE_SELECTIVE_RULE, $1, $2, NULL, $3); }
+              | TEQURXRULE string_expression attribute_expression { $$ = new_rule_statement(AIDE_EQUAL_RULE, $1, $2, NULL, $3); }
+              | TNEGRXRULE string_expression { $$ = new_rule_statement(AIDE_NEGATIVE_RULE, $1, $2, NULL, NULL); }
+              | TSELRXRULE string_expression restriction_expression attribute_expression { $$ = new_rule_statement(AIDE_SELECTIVE_RULE, $1, $2, $3, $4); }
+              | TEQURXRULE string_expression restriction_expression attribute_expression { $$ = new_rule_statement(AIDE_EQUAL_RULE, $1, $2, $3, $4); }
+              | TNEGRXRULE string_expression restriction_expression { $$ = new_rule_statement(AIDE_NEGATIVE_RULE, $1, $2, $3, NULL); }
               | TNEGRXRULE string_expression restriction_expression attribute_expression {
                 log_msg(LOG_LEVEL_ERROR, "%s:%d: negative rule must not have an attribute expression (line: '%s')", conf_filename, conf_linenumber, conf_linebuf);
                 YYABORT;
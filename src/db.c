@@ -24,15 +24,25 @@
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#include <unistd.h>
 #include "attributes.h"
 #include "config.h"
 #include "hashsum.h"
 #include "url.h"
 #include <stdlib.h>
+#include "commandconf.h"
 #include "db.h"
 #include "db_lex.h"
 #include "db_file.h"
 #include "md.h"
+#include "md_thread.h"
+#include "db_dict.h"
 
 #ifdef WITH_CURL
 #include "fopen.h"
@@ -77,9 +87,9 @@ static long long readlonglong(char* s, database* db, char* field_name){
   return i;
 }
 
-static struct md_container *init_db_attrs(url_t *u) {
+static struct md_container *init_db_attrs(url_t *u, DB_ATTR_TYPE attrs) {
     struct md_container *mdc = NULL;
-    if (conf->db_attrs) {
+    if (attrs) {
         switch (u->type) {
             case url_stdin:
             case url_stdout:
@@ -89,8 +99,8 @@ static struct md_container *init_db_attrs(url_t *u) {
             case url_http:
             case url_https:
             case url_ftp: {
-                mdc = checked_malloc(sizeof(struct md_container)); /* freed in close_db_attrs */
-                mdc->todo_attr = conf->db_attrs;
+                mdc = checked_malloc(sizeof(struct md_container)); /* freed in finish_db_attrs */
+                mdc->todo_attr = attrs;
 
                 int length = snprintf(NULL, 0, "%s:%s", get_url_type_string(u->type), u->value) + 1;
                 char *str = checked_malloc(length * sizeof(char));
@@ -110,18 +120,159 @@ static struct md_container *init_db_attrs(url_t *u) {
     return mdc;
 }
 
-static db_line *close_db_attrs (database *db) {
-    db_line *line = NULL;
+/* the database attributes are calculated on a separate thread from the data
+ * read by the parser (or mapped), which is passed through a ring buffer */
+static void start_db_attrs_thread(database *db) {
+    if (db->mdc == NULL) {
+        return;
+    }
+    db->mdt = md_thread_start(db->mdc);
+    if (db->mdt) {
+        log_msg(LOG_LEVEL_DEBUG, "calculate database attributes of %s:%s on separate thread", get_url_type_string((db->url)->type), (db->url)->value);
+    }
+}
+
+void update_db_attrs(database *db, void *buf, ssize_t len) {
+    if (db->mdt) {
+        md_thread_update(db->mdt, buf, len);
+    } else if (db->mdc) {
+        update_md(db->mdc, buf, len);
+    }
+}
+
+/* waits for the md thread and sets db->db_line (the attributes are only
+ * calculated once, see verify_database_checksum()) */
+static void finish_db_attrs(database *db) {
+    if (db->mdt != NULL) {
+        md_thread_finish(db->mdt);
+        db->mdt = NULL;
+    }
     if (db->mdc != NULL) {
         close_md(db->mdc);
-        line = checked_malloc(sizeof(struct db_line));
+        db_line *line = checked_malloc(sizeof(struct db_line));
         line->filename = (db->url)->value;
         line->perm = 0;
-        line->attr = conf->db_attrs;
+        line->attr = db->mdc->todo_attr;
         md2line(db->mdc, line);
         free(db->mdc);
+        db->mdc = NULL;
+        db->db_line = line;
     }
-    return line;
+}
+
+#ifdef HAVE_MMAP
+/*
+ * map_database()
+ * maps an uncompressed database file into memory (database_mmap), it is
+ * scanned in place and the fields of its entries point into the mapping
+ */
+static void map_database(database *db) {
+    struct stat fs;
+    unsigned char magic[2];
+    int fd = fileno(db->fp);
+
+    if (fstat(fd, &fs) == -1 || !S_ISREG(fs.st_mode) || fs.st_size == 0) {
+        log_msg(LOG_LEVEL_DEBUG, "%s:%s: database is not mapped into memory (no regular file or empty)", get_url_type_string((db->url)->type), (db->url)->value);
+        return;
+    }
+    if (pread(fd, magic, sizeof(magic), 0) == sizeof(magic) && magic[0] == 0x1f && magic[1] == 0x8b) {
+        log_msg(LOG_LEVEL_INFO, "%s:%s: gzipped database is not mapped into memory", get_url_type_string((db->url)->type), (db->url)->value);
+        return;
+    }
+    size_t size = fs.st_size;
+    /* the scanner requires two NUL bytes after the data, they are provided
+     * by the anonymous mapping the file is mapped over; the file mapping is
+     * private, the pages written by the scanner (TERMINATE_MAPPED_STRING)
+     * and by decode_base64_in_place() are copied and stay in memory until
+     * unmap_database(), a truncation of the file causes SIGBUS (both are
+     * documented for database_mmap) */
+    char *map = mmap(NULL, size + 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        log_msg(LOG_LEVEL_WARNING, "%s:%s: mmap() failed: %s (continue without mapping the database)", get_url_type_string((db->url)->type), (db->url)->value, strerror(errno));
+        return;
+    }
+    if (mmap(map, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED) {
+        log_msg(LOG_LEVEL_WARNING, "%s:%s: mmap() failed: %s (continue without mapping the database)", get_url_type_string((db->url)->type), (db->url)->value, strerror(errno));
+        munmap(map, size + 2);
+        return;
+    }
+    db->map = map;
+    db->map_size = size;
+    /* the scanner modifies the mapping, so the attributes are calculated first */
+    update_db_attrs(db, map, size);
+    log_msg(LOG_LEVEL_DEBUG, "%s:%s: mapped %lu bytes into memory", get_url_type_string((db->url)->type), (db->url)->value, (unsigned long) size);
+}
+
+#endif
+
+/* size of the blocks load_database() reads */
+#define LOAD_DATABASE_BLOCK_SIZE (1024*1024)
+
+/*
+ * load_database()
+ * reads the whole (uncompressed) database into memory, it is then scanned
+ * in place like a mapped database
+ */
+static void load_database(database *db) {
+    size_t size = 0;
+    size_t alloc = LOAD_DATABASE_BLOCK_SIZE + 2;
+    char *buf = checked_malloc(alloc);
+    int n;
+
+    /* the attributes are calculated from the read data (see db_input_wrapper()) */
+    while ((n = db_input_wrapper(buf + size, LOAD_DATABASE_BLOCK_SIZE, db)) > 0) {
+        size += n;
+        if (alloc - size < LOAD_DATABASE_BLOCK_SIZE + 2) {
+            alloc *= 2;
+            buf = checked_realloc(buf, alloc);
+        }
+    }
+    /* the scanner requires two NUL bytes after the data */
+    buf[size] = '\0';
+    buf[size + 1] = '\0';
+    db->map = buf;
+    db->map_size = size;
+    db->map_loaded = true;
+    log_msg(LOG_LEVEL_DEBUG, "%s:%s: loaded %lu bytes into memory", get_url_type_string((db->url)->type), (db->url)->value, (unsigned long) size);
+}
+
+static void unmap_database(database *db) {
+    if (db->map) {
+        if (db->map_loaded) {
+            free(db->map);
+        } else {
+#ifdef HAVE_MMAP
+            munmap(db->map, db->map_size + 2);
+#endif
+        }
+        db->map = NULL;
+        db->map_size = 0;
+        db->map_loaded = false;
+    }
+}
+
+/*
+ * verify_database_checksum()
+ * compares the digest of the complete database_in with database_in_checksum
+ * before the parsing starts, the parser then scans the verified data (which
+ * is mapped or loaded into memory)
+ * Return: RETOK (match) / RETFAIL
+ */
+static int verify_database_checksum(database *db) {
+    HASHSUM h = conf->database_in_checksum_hash;
+    DB_ATTR_TYPE attr = ATTR(hashsums[h].attribute);
+
+    if (db->map == NULL) {
+        load_database(db);
+    }
+    finish_db_attrs(db);
+    if (db->db_line == NULL || !(db->db_line->attr&attr)
+            || memcmp(db->db_line->hashsums[h], conf->database_in_checksum, hashsums[h].length) != 0) {
+        log_msg(LOG_LEVEL_ERROR, "%s:%s: %s checksum of the database does not match 'database_in_checksum'", get_url_type_string((db->url)->type), (db->url)->value, attributes[hashsums[h].attribute].config_name);
+        return RETFAIL;
+    }
+    log_msg(LOG_LEVEL_INFO, "%s:%s: verified %s checksum of the database", get_url_type_string((db->url)->type), (db->url)->value, attributes[hashsums[h].attribute].config_name);
+    return RETOK;
 }
 
 int db_init(database* db, bool readonly, bool gzip) {
@@ -129,7 +280,12 @@ int db_init(database* db, bool readonly, bool gzip) {
   
   log_msg(LOG_LEVEL_TRACE,"db_init(): arguments: db=%p, gzip=%s", db, btoa(gzip));
   
-    db->mdc = init_db_attrs(db->url);
+    DB_ATTR_TYPE attrs = conf->db_attrs;
+    bool verify = readonly && db == &(conf->database_in) && conf->database_in_checksum;
+    if (verify) {
+        attrs |= ATTR(hashsums[conf->database_in_checksum_hash].attribute);
+    }
+    db->mdc = init_db_attrs(db->url, attrs);
     fp=be_init(readonly, db->url, gzip, false, db->linenumber, db->filename, db->linebuf);
     if(fp==NULL) {
       return RETFAIL;
@@ -143,20 +299,66 @@ int db_init(database* db, bool readonly, bool gzip) {
 #ifdef WITH_ZLIB
         }
 #endif
+    start_db_attrs_thread(db);
+#ifdef HAVE_MMAP
+    if (conf->database_mmap && readonly && db == &(conf->database_in) && (db->url)->type == url_file && db->fp) {
+        map_database(db);
+    }
+#endif
+    if (verify) {
+        return verify_database_checksum(db);
+    }
     return RETOK;
     }
 }
 
+static const char *get_raw_field(char** ss, int i, database* db) {
+    char *field = ss[db->fields[i]];
+    if (field[0] == '@' && ATTR(db->fields[i])&DB_DICT_ATTRS) {
+        db_dict_entry *entry = db_dict_get(db, db->fields[i], field);
+        if (entry) {
+            return entry->text;
+        }
+    }
+    return field;
+}
+
 db_line* db_readline(database* db){
   db_line* s=NULL;
 
   if (db->fp != NULL) {
       char** ss=db_readline_file(db);
       if (ss!=NULL){
+          char *raw = NULL;
+
+          /* db_char2line() modifies the fields, dictionary references are
+           * replaced by their values (database_out has its own dictionary) */
+          if (db->raw_lines) {
+              size_t len = 0;
+              for(int i=0;i<db->num_fields;i++){
+                  len += strlen(get_raw_field(ss, i, db))+1;
+              }
+              char *p = raw = checked_malloc(len);
+              for(int i=0;i<db->num_fields;i++){
+                  const char *field = get_raw_field(ss, i, db);
+                  size_t n = strlen(field);
+                  memcpy(p, field, n);
+                  p += n;
+                  *p++ = ' ';
+              }
+              p[-1] = '\0';
+          }
+
           s=db_char2line(ss,db);
+          if (s) {
+              s->raw = raw;
+          } else {
+              free(raw);
+          }
 
           for(int i=0;i<db->num_fields;i++){
               if(db->fields[i]!=attr_unknown &&
+                      !(ATTR(db->fields[i])&db->view_fields) &&
                       ss[db->fields[i]]!=NULL){
                   free(ss[db->fields[i]]);
                   ss[db->fields[i]]=NULL;
@@ -178,7 +380,8 @@ byte* base64tobyte(char* src,int len,size_t *ret_len)
   return NULL;
 }
 
-static char *db_readchar(char *s)
+/* Return: s (decoded in place) if copy is false */
+static char *db_readchar(char *s, bool copy)
 {
   if (s == NULL)
     return (NULL);
@@ -202,14 +405,135 @@ static char *db_readchar(char *s)
 
   decode_string(s);
 
-  return checked_strdup(s);
+  return copy ? checked_strdup(s) : s;
+}
+
+
+static void *get_dict_value(db_line* line, ATTRIBUTE attr) {
+  switch (attr) {
+#ifdef WITH_POSIX_ACL
+    case attr_acl: return line->acl;
+#endif
+#ifdef WITH_XATTR
+    case attr_xattrs: return line->xattrs;
+#endif
+    case attr_selinux: return line->cntx;
+    case attr_capabilities: return line->capabilities;
+    default: return NULL;
+  }
+}
+
+static void set_dict_value(db_line* line, ATTRIBUTE attr, void *value) {
+  switch (attr) {
+#ifdef WITH_POSIX_ACL
+    case attr_acl: line->acl = value; break;
+#endif
+#ifdef WITH_XATTR
+    case attr_xattrs: line->xattrs = value; break;
+#endif
+    case attr_selinux: line->cntx = value; break;
+    case attr_capabilities: line->capabilities = value; break;
+    default: break;
+  }
+}
+
+void release_dict_values(db_line* line, DB_ATTR_TYPE attrs) {
+  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
+    if (ATTR(i)&attrs&line->dict_attrs) {
+      set_dict_value(line, i, NULL);
+    }
+  }
+  line->dict_attrs&=~attrs;
 }
 
+void copy_dict_values(db_line* line) {
+#ifdef WITH_POSIX_ACL
+  if (line->dict_attrs&ATTR(attr_acl) && line->acl) {
+    acl_type *acl = checked_malloc(sizeof(acl_type));
+    acl->acl_a = line->acl->acl_a?checked_strdup(line->acl->acl_a):NULL;
+    acl->acl_d = line->acl->acl_d?checked_strdup(line->acl->acl_d):NULL;
+    line->acl = acl;
+  }
+#endif
+#ifdef WITH_XATTR
+  if (line->dict_attrs&ATTR(attr_xattrs) && line->xattrs) {
+    xattrs_type *xattrs = checked_malloc(sizeof(xattrs_type));
+    xattrs->num = line->xattrs->num;
+    xattrs->sz = line->xattrs->num;
+    xattrs->ents = checked_malloc(xattrs->sz * sizeof(xattr_node));
+    for (size_t i = 0 ; i < xattrs->num ; ++i) {
+      xattrs->ents[i].key = checked_strdup(line->xattrs->ents[i].key);
+      xattrs->ents[i].vsz = line->xattrs->ents[i].vsz;
+      xattrs->ents[i].val = checked_malloc(xattrs->ents[i].vsz + 1);
+      memcpy(xattrs->ents[i].val, line->xattrs->ents[i].val, xattrs->ents[i].vsz);
+      xattrs->ents[i].val[xattrs->ents[i].vsz] = '\0';
+    }
+    line->xattrs = xattrs;
+  }
+#endif
+  if (line->dict_attrs&ATTR(attr_selinux) && line->cntx) {
+    line->cntx = checked_strdup(line->cntx);
+  }
+  if (line->dict_attrs&ATTR(attr_capabilities) && line->capabilities) {
+    line->capabilities = checked_strdup(line->capabilities);
+  }
+  line->dict_attrs=0;
+}
+
+void release_view_values(db_line* line, DB_ATTR_TYPE attrs) {
+  attrs&=line->view_attrs;
+  if (attrs&ATTR(attr_filename)) {
+    line->fullpath=NULL;
+    line->filename=NULL;
+  }
+  if (attrs&ATTR(attr_linkname)) {
+    line->linkname=NULL;
+  }
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    if (attrs&ATTR(hashsums[i].attribute)) {
+      line->hashsums[i]=NULL;
+    }
+  }
+  line->view_attrs&=~attrs;
+}
+
+void copy_view_values(db_line* line) {
+  if (line->view_attrs&ATTR(attr_filename)) {
+    char *fullpath = checked_strdup(line->fullpath);
+    line->filename=fullpath+(line->filename-line->fullpath);
+    line->fullpath=fullpath;
+  }
+  if (line->view_attrs&ATTR(attr_linkname)) {
+    line->linkname=checked_strdup(line->linkname);
+  }
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    if (line->view_attrs&ATTR(hashsums[i].attribute)) {
+      byte *digest = checked_malloc(hashsums[i].length);
+      memcpy(digest, line->hashsums[i], hashsums[i].length);
+      line->hashsums[i]=digest;
+    }
+  }
+  line->view_attrs=0;
+}
+
+/* the hashsums of a mapped database are decoded in place */
+static byte* readhashsum(db_line* line, database* db, char* s, ATTRIBUTE attr) {
+  if (!(ATTR(attr)&db->view_fields)) {
+    return base64tobyte(s, strlen(s), NULL);
+  }
+  if (strcmp(s, "0") == 0) {
+    return NULL;
+  }
+  byte *digest = decode_base64_in_place(s, strlen(s), NULL);
+  if (digest) {
+    line->view_attrs|=ATTR(attr);
+  }
+  return digest;
+}
 
 #define CHAR2HASH(hash) \
 case attr_ ##hash : { \
-    line->hashsums[hash_ ##hash]=base64tobyte(ss[db->fields[i]], \
-        strlen(ss[db->fields[i]]), NULL); \
+    line->hashsums[hash_ ##hash]=readhashsum(line, db, ss[db->fields[i]], attr_ ##hash); \
   break; \
 }
 
@@ -239,23 +563,62 @@ db_line* db_char2line(char** ss, database* db){
   line->e2fsattrs=0;
   line->cntx=NULL;
   line->capabilities=NULL;
+  line->chunks=NULL;
+  line->fsverity=NULL;
+  line->verified=0;
+  line->rule=0;
+  line->raw=NULL;
+  line->dict_attrs=0;
+  line->view_attrs=0;
 
   for (int i = 0 ; i < num_hashes ; ++i) {
       line->hashsums[i]=NULL;
   }
 
   
-  line->attr=conf->attr; /* attributes from @@dbspec */
+  line->attr=db->attr; /* attributes from @@dbspec */
+  DB_ATTR_TYPE skipped_attrs = 0;
 
   for(int i=0;i<db->num_fields;i++){
 
     log_msg(LOG_LEVEL_TRACE, "db_char2line(): %d[%d]: '%s' (%p)", db->lineno, i, ss[i], ss[i]);
 
+    /* the column was not read from the block (see read_attrs) */
+    if (db->fields[i] != attr_unknown && db->fields[i] != attr_filename && ss[db->fields[i]] == NULL) {
+      skipped_attrs|=ATTR(db->fields[i]);
+      continue;
+    }
+
+    db_dict_entry *dict_entry = NULL;
+    if (ss[db->fields[i]] && ss[db->fields[i]][0] == '@' && ATTR(db->fields[i])&DB_DICT_ATTRS) {
+      dict_entry = db_dict_get(db, db->fields[i], ss[db->fields[i]]);
+      if (dict_entry == NULL) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "undefined dictionary reference '%s' for field '%s' of '%s' (ignore value)", ss[db->fields[i]], attributes[db->fields[i]].db_name, line->filename);
+        continue;
+      }
+      if (dict_entry->decoded) {
+        set_dict_value(line, db->fields[i], dict_entry->value);
+        line->dict_attrs|=ATTR(db->fields[i]);
+        continue;
+      }
+      /* the value is decoded once and then shared */
+      if (!(ATTR(db->fields[i])&db->view_fields)) {
+        free(ss[db->fields[i]]);
+      }
+      db->view_fields&=~ATTR(db->fields[i]);
+      ss[db->fields[i]] = checked_strdup(dict_entry->text);
+    }
+
     switch (db->fields[i]) {
     case attr_filename : {
       if(ss[db->fields[i]]!=NULL){
 	decode_string(ss[db->fields[i]]);
-	line->fullpath=checked_strdup(ss[db->fields[i]]);
+	if (ATTR(attr_filename)&db->view_fields) {
+	  line->fullpath=ss[db->fields[i]];
+	  line->view_attrs|=ATTR(attr_filename);
+	} else {
+	  line->fullpath=checked_strdup(ss[db->fields[i]]);
+	}
 	line->filename=line->fullpath;
       } else {
         log_msg(LOG_LEVEL_ERROR, "db_char2line(): error while reading database");
@@ -264,13 +627,24 @@ db_line* db_char2line(char** ss, database* db){
       break;
     }
     case attr_linkname : {
-      line->linkname = db_readchar(ss[db->fields[i]]);
+      line->linkname = db_readchar(ss[db->fields[i]], !(ATTR(attr_linkname)&db->view_fields));
+      if (line->linkname && line->linkname == ss[db->fields[i]]) {
+        line->view_attrs|=ATTR(attr_linkname);
+      }
       break;
     }
     case attr_mtime : {
       line->mtime=base64totime_t(ss[db->fields[i]], db, "mtime");
       break;
     }
+    case attr_verified : {
+      line->verified=base64totime_t(ss[db->fields[i]], db, "verified");
+      break;
+    }
+    case attr_rule : {
+      line->rule=readlonglong(ss[db->fields[i]], db, "rule");
+      break;
+    }
     case attr_bcount : {
       line->bcount=readlonglong(ss[db->fields[i]], db, "bcount");
       break;
@@ -315,9 +689,9 @@ db_line* db_char2line(char** ss, database* db){
     CHAR2HASH(stribog512)
     case attr_acl : {
 #ifdef WITH_POSIX_ACL
-      char *tval = NULL;
+      char *tval = NULL, *saveptr = NULL;
       
-      tval = strtok(ss[db->fields[i]], ",");
+      tval = strtok_r(ss[db->fields[i]], ",", &saveptr);
 
       line->acl = NULL;
 
@@ -329,9 +703,9 @@ db_line* db_char2line(char** ss, database* db){
         line->acl->acl_a = NULL;
         line->acl->acl_d = NULL;
         
-        tval = strtok(NULL, ",");
+        tval = strtok_r(NULL, ",", &saveptr);
         line->acl->acl_a = (char *)base64tobyte(tval, strlen(tval), NULL);
-        tval = strtok(NULL, ",");
+        tval = strtok_r(NULL, ",", &saveptr);
         line->acl->acl_d = (char *)base64tobyte(tval, strlen(tval), NULL);
       }
       /* else, it's broken... */
@@ -341,9 +715,9 @@ db_line* db_char2line(char** ss, database* db){
       case attr_xattrs : {
 #ifdef WITH_XATTR
         size_t num = 0;
-        char *tval = NULL;
+        char *tval = NULL, *saveptr = NULL;
         
-        tval = strtok(ss[db->fields[i]], ",");
+        tval = strtok_r(ss[db->fields[i]], ",", &saveptr);
         num = readlong(tval,  db, "xattrs");
         if (num)
         {
@@ -357,9 +731,9 @@ db_line* db_char2line(char** ss, database* db){
             byte  *val = NULL;
             size_t vsz = 0;
             
-            tval = strtok(NULL, ",");
-            line->xattrs->ents[num].key = db_readchar(checked_strdup(tval));
-            tval = strtok(NULL, ",");
+            tval = strtok_r(NULL, ",", &saveptr);
+            line->xattrs->ents[num].key = db_readchar(checked_strdup(tval), true);
+            tval = strtok_r(NULL, ",", &saveptr);
             val = base64tobyte(tval, strlen(tval), &vsz);
             line->xattrs->ents[num].val = val;
             line->xattrs->ents[num].vsz = vsz;
@@ -406,6 +780,43 @@ db_line* db_char2line(char** ss, database* db){
       line->capabilities = (char *)val;
       break;
     }
+    case attr_chunks : {
+      char *tval = NULL, *saveptr = NULL;
+
+      tval = strtok_r(ss[db->fields[i]], ",", &saveptr);
+      long long chunk_size = readlonglong(tval, db, "chunks");
+      if (chunk_size > 0) {
+        size_t len = 0;
+
+        line->chunks = checked_malloc(sizeof(chunks_type));
+        line->chunks->chunk_size = chunk_size;
+        tval = strtok_r(NULL, ",", &saveptr);
+        line->chunks->num = tval?readlong(tval, db, "chunks"):0;
+        tval = strtok_r(NULL, ",", &saveptr);
+        line->chunks->digests = tval?base64tobyte(tval, strlen(tval), &len):NULL;
+        if (len != line->chunks->num*hashsums[CHUNK_HASHSUM].length) {
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "could not read '%s' from database: expected %zu chunk digest(s), got %zu byte(s)", "chunks", line->chunks->num, len)
+          free(line->chunks->digests);
+          line->chunks->digests = NULL;
+          line->chunks->num = 0;
+        }
+      }
+      break;
+    }
+    case attr_fsverity : {
+      char *tval = NULL, *saveptr = NULL;
+
+      tval = strtok_r(ss[db->fields[i]], ",", &saveptr);
+      long algorithm = readlong(tval, db, "fsverity");
+      if (algorithm > 0) {
+        line->fsverity = checked_malloc(sizeof(fsverity_type));
+        line->fsverity->algorithm = algorithm;
+        line->fsverity->length = 0;
+        tval = strtok_r(NULL, ",", &saveptr);
+        line->fsverity->digest = tval?base64tobyte(tval, strlen(tval), &line->fsverity->length):NULL;
+      }
+      break;
+    }
     case attr_bsize :
     case attr_sizeg :
     case attr_rdev :
@@ -424,8 +835,15 @@ db_line* db_char2line(char** ss, database* db){
     }
     
     }
+
+    if (dict_entry) {
+      dict_entry->value = get_dict_value(line, db->fields[i]);
+      dict_entry->decoded = true;
+      line->dict_attrs|=ATTR(db->fields[i]);
+    }
     
   }
+  line->attr&=~skipped_attrs;
 
   return line;
 }
@@ -514,6 +932,7 @@ void db_close() {
 #ifdef WITH_CURL
         if (conf->database_out.fp!=NULL) {
             url_fclose(conf->database_out.fp);
+            conf->database_out.fp = NULL;
         }
 #endif /* WITH CURL */
       break;
@@ -525,9 +944,62 @@ void db_close() {
   }
   }
   }
-  conf->database_in.db_line = close_db_attrs(&conf->database_in);
-  conf->database_out.db_line = close_db_attrs(&conf->database_out);
-  conf->database_new.db_line = close_db_attrs(&conf->database_new);
+  finish_db_attrs(&conf->database_in);
+  db_dict_free(&conf->database_in);
+  db_dict_free(&conf->database_new);
+  db_dict_out_free(&conf->database_out);
+  /* entries kept for the report have their own copies (see add_file_to_tree()) */
+  unmap_database(&conf->database_in);
+  finish_db_attrs(&conf->database_out);
+  finish_db_attrs(&conf->database_new);
+}
+
+void db_free(database *db) {
+  if (db->fp != NULL && db->fp != stdin && db->fp != stdout && db->fp != stderr) {
+    switch (db->url->type) {
+    case url_http:
+    case url_https:
+    case url_ftp: {
+#ifdef WITH_CURL
+      url_fclose(db->fp);
+#endif /* WITH CURL */
+      break;
+    }
+    default: {
+      fclose(db->fp);
+      break;
+    }
+    }
+  }
+  db->fp = NULL;
+  finish_db_attrs(db);
+  if (db->db_line) {
+    for (int i = 0 ; i < num_hashes ; ++i) {
+      if (db->db_line->attr&ATTR(hashsums[i].attribute)) {
+        free(db->db_line->hashsums[i]);
+      }
+    }
+    free(db->db_line);
+    db->db_line = NULL;
+  }
+  db_dict_free(db);
+  db_dict_out_free(db);
+  unmap_database(db);
+  free(db->fields);
+  db->fields = NULL;
+  db->num_fields = 0;
+  free(db->path);
+  db->path = NULL;
+  db->path_size = 0;
+  free(db->capture_buf);
+  db->capture_buf = NULL;
+  free(db->linebuf);
+  db->linebuf = NULL;
+  if (db->url) {
+    free(db->url->value);
+    free(db->url);
+    db->url = NULL;
+  }
 }
 
 void free_db_line(db_line* dl)
@@ -535,6 +1007,9 @@ void free_db_line(db_line* dl)
   if (dl==NULL) {
     return;
   }
+
+  release_dict_values(dl, DB_ATTR_UNDEF);
+  release_view_values(dl, DB_ATTR_UNDEF);
   
 #define checked_free(x) do { free(x); x=NULL; } while (0)
 
@@ -544,6 +1019,7 @@ void free_db_line(db_line* dl)
 
   dl->filename=NULL;
   checked_free(dl->fullpath);
+  checked_free(dl->raw);
   checked_free(dl->linkname);
   
 #ifdef WITH_ACL
@@ -561,4 +1037,12 @@ void free_db_line(db_line* dl)
   checked_free(dl->xattrs);
   checked_free(dl->cntx);
 #endif
+
+  if (dl->chunks)
+    free(dl->chunks->digests);
+  checked_free(dl->chunks);
+
+  if (dl->fsverity)
+    free(dl->fsverity->digest);
+  checked_free(dl->fsverity);
 }
@@ -0,0 +1,202 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <search.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attributes.h"
+#include "db_config.h"
+#include "db_dict.h"
+#include "db_lex.h"
+#include "log.h"
+#include "url.h"
+#include "util.h"
+
+static const ATTRIBUTE dict_attributes[DB_DICT_NUM_FIELDS] = {
+    attr_acl, attr_xattrs, attr_selinux, attr_capabilities,
+};
+
+typedef struct db_dict {
+    db_dict_entry *entries[DB_DICT_NUM_FIELDS];
+    long num_entries[DB_DICT_NUM_FIELDS];
+    long size[DB_DICT_NUM_FIELDS];
+} db_dict;
+
+typedef struct out_entry {
+    char *text;
+    long id;
+} out_entry;
+
+/* values written to the database */
+typedef struct db_dict_out {
+    void *entries[DB_DICT_NUM_FIELDS];
+    long num_entries[DB_DICT_NUM_FIELDS];
+} db_dict_out;
+
+static int get_field_index(ATTRIBUTE attr) {
+    for (int i = 0 ; i < DB_DICT_NUM_FIELDS ; ++i) {
+        if (dict_attributes[i] == attr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static long read_id(const char *s) {
+    char *endp;
+    long id = strtol(s, &endp, 10);
+    if (*s == '\0' || *endp != '\0' || id < 0) {
+        return -1;
+    }
+    return id;
+}
+
+bool db_dict_define(database *db, const char *field, const char *id_str, const char *text) {
+    int f = -1;
+    for (int i = 0 ; i < DB_DICT_NUM_FIELDS ; ++i) {
+        if (strcmp(attributes[dict_attributes[i]].db_name, field) == 0) {
+            f = i;
+        }
+    }
+    long id = read_id(id_str);
+    if (f == -1 || id == -1) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "invalid dictionary definition '%s %s' (skip line)", field, id_str);
+        return false;
+    }
+
+    if (db->dict == NULL) {
+        db->dict = checked_calloc(1, sizeof(db_dict));
+    }
+    db_dict *dict = db->dict;
+    /* the ids are written in sequence, so a definition always adds the next id */
+    if (id != dict->num_entries[f]) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "unexpected dictionary id in '%s %s', expected %ld (skip line)", field, id_str, dict->num_entries[f]);
+        return false;
+    }
+    if (id >= dict->size[f]) {
+        dict->size[f] = dict->size[f] ? 2 * dict->size[f] : 64;
+        dict->entries[f] = checked_realloc(dict->entries[f], dict->size[f] * sizeof(db_dict_entry));
+    }
+    dict->num_entries[f]++;
+    dict->entries[f][id].decoded = false;
+    dict->entries[f][id].value = NULL;
+    dict->entries[f][id].text = checked_strdup(text);
+    LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "define dictionary entry '%s %s': '%s'", field, id_str, text);
+    return true;
+}
+
+db_dict_entry *db_dict_get(database *db, ATTRIBUTE attr, const char *ref) {
+    int f = get_field_index(attr);
+    long id = read_id(ref + 1);
+    db_dict *dict = db->dict;
+    if (f == -1 || id == -1 || dict == NULL || id >= dict->num_entries[f] || dict->entries[f][id].text == NULL) {
+        return NULL;
+    }
+    return &dict->entries[f][id];
+}
+
+static void free_value(ATTRIBUTE attr, void *value) {
+    switch (attr) {
+#ifdef WITH_POSIX_ACL
+        case attr_acl: {
+            acl_type *acl = value;
+            free(acl->acl_a);
+            free(acl->acl_d);
+            break;
+        }
+#endif
+#ifdef WITH_XATTR
+        case attr_xattrs: {
+            xattrs_type *xattrs = value;
+            for (size_t i = 0 ; i < xattrs->num ; ++i) {
+                free(xattrs->ents[i].key);
+                free(xattrs->ents[i].val);
+            }
+            free(xattrs->ents);
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+    free(value);
+}
+
+void db_dict_free(database *db) {
+    db_dict *dict = db->dict;
+    if (dict == NULL) {
+        return;
+    }
+    for (int f = 0 ; f < DB_DICT_NUM_FIELDS ; ++f) {
+        for (long id = 0 ; id < dict->num_entries[f] ; ++id) {
+            if (dict->entries[f][id].value) {
+                free_value(dict_attributes[f], dict->entries[f][id].value);
+            }
+            free(dict->entries[f][id].text);
+        }
+        free(dict->entries[f]);
+    }
+    free(dict);
+    db->dict = NULL;
+}
+
+static int compare_out_entry(const void *e1, const void *e2) {
+    return strcmp(((const out_entry *) e1)->text, ((const out_entry *) e2)->text);
+}
+
+long db_dict_get_id(database *db, ATTRIBUTE attr, const char *text, bool *new) {
+    int f = get_field_index(attr);
+    out_entry key = { .text = (char *) text };
+
+    if (db->dict_out == NULL) {
+        db->dict_out = checked_calloc(1, sizeof(db_dict_out));
+    }
+    db_dict_out *dict_out = db->dict_out;
+    out_entry **entry = tfind(&key, &dict_out->entries[f], compare_out_entry);
+    if (entry) {
+        *new = false;
+        return (*entry)->id;
+    }
+    out_entry *e = checked_malloc(sizeof(out_entry));
+    e->text = checked_strdup(text);
+    e->id = dict_out->num_entries[f]++;
+    tsearch(e, &dict_out->entries[f], compare_out_entry);
+    *new = true;
+    return e->id;
+}
+
+static void free_out_entry(void *e) {
+    free(((out_entry *) e)->text);
+    free(e);
+}
+
+void db_dict_out_free(database *db) {
+    db_dict_out *dict_out = db->dict_out;
+    if (dict_out == NULL) {
+        return;
+    }
+    for (int f = 0 ; f < DB_DICT_NUM_FIELDS ; ++f) {
+        tdestroy(dict_out->entries[f], free_out_entry);
+    }
+    free(dict_out);
+    db->dict_out = NULL;
+}
@@ -25,7 +25,6 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <stdlib.h>
-#include <dirent.h>
 #include <errno.h>
 #include <stdbool.h>
 #include "db_config.h"
@@ -37,66 +36,66 @@
 #include "gen_list.h"
 #include "db.h"
 #include "db_disk.h"
+#include "fs.h"
 #include "util.h"
 
-
-static DIR *dirh = NULL;
-static struct dirent *entp = NULL;
-
-static struct seltree *r = NULL;
-
-
-static long td = -1;
-
-static int root_handled = 0;
-
-static DIR *open_dir(char* path) {
-   if (dirh != NULL) {
-       if (closedir(dirh) != 0) {
+/* state of the disk walker, one per scan (see db_disk_init()) */
+struct disk_walker {
+	void *dirh;
+	const char *entry; /* name of the current directory entry */
+	seltree *node; /* node of the current directory */
+	int root_handled;
+	seltree_match_ctx *match_ctx; /* rule evaluation state of the scan */
+};
+
+static void *open_dir(char* path) {
+   disk_walker *w = conf->disk_walker;
+   if (w->dirh != NULL) {
+       if (conf->fs->closedir(w->dirh) != 0) {
            /* Closedir did not success? */
        }
    }
-   return opendir(path);
+   return conf->fs->opendir(path);
 }
 
 static void next_in_dir (void)
 {
-	if (dirh != NULL) {
-		entp = readdir (dirh);
-		if(entp!=NULL)
-			td = telldir(dirh);
-		else
-			td=-1;
+	disk_walker *w = conf->disk_walker;
+	if (w->dirh != NULL) {
+		w->entry = conf->fs->readdir (w->dirh);
 	}
 
 }
 
 static int in_this (void)
 {
-	return (dirh != NULL && entp != NULL && td >= 0);
+	disk_walker *w = conf->disk_walker;
+	return (w->dirh != NULL && w->entry != NULL);
 }
 
 static char *name_construct (const char *s)
 {
+	disk_walker *w = conf->disk_walker;
 	char *ret;
-	int len2 = strlen (r->path);
+	int len2 = strlen (w->node->path);
 	int len = len2 + strlen (s) + 2 + conf->root_prefix_length;
 
-	if (r->path[len2 - 1] != '/') {
+	if (w->node->path[len2 - 1] != '/') {
 		len++;
 	}
 
 	ret = (char *) checked_malloc (len);
-	snprintf(ret, len, "%s%s%s%s", conf->root_prefix, r->path, (r->path[len2 - 1] != '/')?"/":"", s);
+	snprintf(ret, len, "%s%s%s%s", conf->root_prefix, w->node->path, (w->node->path[len2 - 1] != '/')?"/":"", s);
 	return ret;
 }
 
 void add_child (db_line * fil)
 {
+	disk_walker *w = conf->disk_walker;
 	int i;
 	struct seltree *new_r;
 
-	new_r = get_seltree_node (r, fil->filename);
+	new_r = get_seltree_node (w->node, fil->filename);
 	if (new_r != NULL) {
 		if (S_ISDIR (fil->perm_o)) {
 			;
@@ -107,7 +106,7 @@ void add_child (db_line * fil)
 		return;
 	}
 
-	log_msg(LOG_LEVEL_DEBUG, "add child '%s' to %s", fil->filename, r->path);
+	log_msg(LOG_LEVEL_DEBUG, "add child '%s' to %s", fil->filename, w->node->path);
 
 	new_r = checked_malloc (sizeof (seltree));
 
@@ -116,10 +115,11 @@ void add_child (db_line * fil)
 	new_r->path = checked_malloc (i + 1);
 	strncpy(new_r->path, fil->filename, i+1);
 	new_r->childs = NULL;
+	new_r->child_index = NULL;
 	new_r->sel_rx_lst = NULL;
 	new_r->neg_rx_lst = NULL;
 	new_r->equ_rx_lst = NULL;
-	new_r->parent = r;
+	new_r->parent = w->node;
 	new_r->checked = 0;
 	new_r->changed_attrs=0;
 	new_r->new_data = NULL;
@@ -130,12 +130,12 @@ void add_child (db_line * fil)
 		new_r->checked |= NODE_CHECKED;
 		new_r->checked |= NODE_TRAVERSE;
 	}
-	r->childs = list_sorted_insert (r->childs, new_r, compare_node_by_path);
+	add_seltree_child (w->node, new_r);
 }
 
 static int get_file_status(char *filename, struct stat *fs) {
     int sres = 0;
-    sres = lstat(filename,fs);
+    sres = conf->fs->lstat(filename,fs);
     if(sres == -1){
         char* er = strerror(errno);
         if (er == NULL) {
@@ -147,6 +147,28 @@ static int get_file_status(char *filename, struct stat *fs) {
     return sres;
 }
 
+/*
+ * get_disk_entry()
+ * returns the entry of fullname with the attributes of rule or NULL if the
+ * old entry is carried forward by --update-config
+ */
+static db_line *get_disk_entry(char *fullname, rx_rule *rule, struct stat *fs, bool dry_run, bool *carried)
+{
+	db_line *fil = NULL;
+
+	*carried = conf->action&DO_CONFIG_UPDATE && carry_forward_old_entry(&fullname[conf->root_prefix_length], rule, fs->st_mode);
+	if (*carried) {
+		return NULL;
+	}
+	log_msg(LOG_LEVEL_DEBUG, "get file attributes '%s'", &fullname[conf->root_prefix_length]);
+	fil = get_file_attrs (fullname, rule->attr, fs, dry_run);
+	if (fil != NULL && conf->db_out_attrs&ATTR(attr_rule)) {
+		fil->rule = get_rule_fingerprint(rule);
+		fil->attr |= ATTR(attr_rule);
+	}
+	return fil;
+}
+
 /*
   It might be a good idea to make this non recursive.
   Now implemented with goto-statement. Yeah, it's ugly and easy.
@@ -154,24 +176,25 @@ static int get_file_status(char *filename, struct stat *fs) {
 
 db_line *db_readline_disk (bool dry_run)
 {
+	disk_walker *w = conf->disk_walker;
 	db_line *fil = NULL;
 	rx_rule *rule = NULL;
 	char *fullname;
 	int add = 0;
+	bool carried = false;
 	struct stat fs;
 
 	/* root needs special handling */
-	if (!root_handled) {
-		root_handled = 1;
+	if (!w->root_handled) {
+		w->root_handled = 1;
 		int len = (conf->root_prefix_length+2)*sizeof(char);
 		fullname=checked_malloc(len);
 		snprintf(fullname, len, "%s/",  conf->root_prefix);
 		if (!get_file_status(fullname, &fs)) {
-		add = check_rxtree (&fullname[conf->root_prefix_length], conf->tree, &rule, get_restriction_from_perm(fs.st_mode), dry_run);
+		add = check_rxtree (&fullname[conf->root_prefix_length], conf->tree, &rule, get_restriction_from_perm(fs.st_mode), dry_run, w->match_ctx);
 
 		if (add > 0) {
-            log_msg(LOG_LEVEL_DEBUG, "get file attributes '%s'", &fullname[conf->root_prefix_length]);
-			fil = get_file_attrs (fullname, rule->attr, &fs, dry_run);
+			fil = get_disk_entry (fullname, rule, &fs, dry_run, &carried);
 
 			if (fil != NULL) {
 				return fil;
@@ -190,7 +213,7 @@ recursion:
 		   If have, just skipit.
 		   If don't do the 'normal' thing.
 		 */
-		if (strcmp (entp->d_name, ".") == 0 || strcmp (entp->d_name, "..") == 0) {
+		if (strcmp (w->entry, ".") == 0 || strcmp (w->entry, "..") == 0) {
 			goto recursion;						// return db_readline_disk(db);
 		}
 
@@ -198,7 +221,7 @@ recursion:
 		   Now we know that we actually can do something.
 		 */
 
-		fullname = name_construct (entp->d_name);
+		fullname = name_construct (w->entry);
 
 		/*
 		   Now we have a filename, which we must remember to free if it is
@@ -212,11 +235,26 @@ recursion:
 		    free (fullname);
 		    goto recursion;
 		}
-		add = check_rxtree (&fullname[conf->root_prefix_length], conf->tree, &rule, get_restriction_from_perm(fs.st_mode), dry_run);
+		add = check_rxtree (&fullname[conf->root_prefix_length], conf->tree, &rule, get_restriction_from_perm(fs.st_mode), dry_run, w->match_ctx);
 
 		if (add > 0) {
-            log_msg(LOG_LEVEL_DEBUG, "get file attributes '%s'", &fullname[conf->root_prefix_length]);
-			fil = get_file_attrs (fullname, rule->attr, &fs, dry_run);
+			fil = get_disk_entry (fullname, rule, &fs, dry_run, &carried);
+
+			if (carried) {
+				/*
+				   The old entry is written to database_out,
+				   only the children still need to be traversed.
+				 */
+				if (add == SELECTIVE_MATCH) {
+					db_line dir;
+					memset (&dir, 0, sizeof (db_line));
+					dir.filename = &fullname[conf->root_prefix_length];
+					dir.perm_o = fs.st_mode;
+					add_child (&dir);
+				}
+				free (fullname);
+				goto recursion;
+			}
 
 			if (fil == NULL) {
 				/*
@@ -263,17 +301,17 @@ recursion:
 		 */
 	} else {
 
-		if (r == NULL) {
+		if (w->node == NULL) {
 			return NULL;
 		}
 
-		log_msg(LOG_LEVEL_TRACE, "r->childs %p, r->parent %p, r->checked %i", r->childs,
-					 r->parent, r->checked);
+		log_msg(LOG_LEVEL_TRACE, "r->childs %p, r->parent %p, r->checked %i", w->node->childs,
+					 w->node->parent, w->node->checked);
 
-		if ((0 == (r->checked & NODE_CHECKED)) && r->childs != NULL) {
+		if ((0 == (w->node->checked & NODE_CHECKED)) && w->node->childs != NULL) {
 			seltree *rr;
 			list *l;
-			l = r->childs->header->head;
+			l = w->node->childs->header->head;
 
 			while (l != NULL
 						 && (((seltree *) (l->data))->checked & NODE_TRAVERSE) != 0) {
@@ -281,7 +319,7 @@ recursion:
 			}
 			if (l != NULL) {
 				if (l == l->header->tail) {
-					r->checked |= NODE_CHECKED;
+					w->node->checked |= NODE_CHECKED;
 				}
 
 				rr = (seltree *) l->data;
@@ -289,23 +327,23 @@ recursion:
 				log_msg(LOG_LEVEL_TRACE, "rr->checked %i", rr->checked);
 				rr->checked |= NODE_TRAVERSE;
 
-				r = rr;
+				w->node = rr;
 
 				log_msg (LOG_LEVEL_TRACE, "r->childs %p, r->parent %p,r->checked %i",
-							 r->childs, r->parent, r->checked);
-				int len = (conf->root_prefix_length+strlen(r->path)+1)*sizeof(char);
+							 w->node->childs, w->node->parent, w->node->checked);
+				int len = (conf->root_prefix_length+strlen(w->node->path)+1)*sizeof(char);
 				fullname=checked_malloc(len);
-				snprintf(fullname, len, "%s%s",  conf->root_prefix, r->path);
-				dirh=open_dir(fullname);
-				if (! dirh) {
+				snprintf(fullname, len, "%s%s",  conf->root_prefix, w->node->path);
+				w->dirh=open_dir(fullname);
+				if (! w->dirh) {
 
 					/* open_dir failed so we need to know why and print 
 					   an errormessage if needed.
 					   errno should still be the one from opendir() since it's global
 					 */
-					if (errno == ENOENT && r->old_data != NULL &&
-							r->sel_rx_lst == NULL && r->neg_rx_lst == NULL &&
-							r->equ_rx_lst == NULL) {
+					if (errno == ENOENT && w->node->old_data != NULL &&
+							w->node->sel_rx_lst == NULL && w->node->neg_rx_lst == NULL &&
+							w->node->equ_rx_lst == NULL) {
 						/* The path did not exist and there is old data for this node
 						   and there are no regexps for this node
 						   There is no new data for this node otherwise it would not
@@ -313,8 +351,8 @@ recursion:
 						   So we don't print any error message.
 						 */
 					} else if (errno == ENOENT &&
-										 ((r->sel_rx_lst != NULL || r->neg_rx_lst != NULL ||
-											r->equ_rx_lst != NULL) || r->childs != NULL)) {
+										 ((w->node->sel_rx_lst != NULL || w->node->neg_rx_lst != NULL ||
+											w->node->equ_rx_lst != NULL) || w->node->childs != NULL)) {
 						/* The dir did not exist and there are regexps referring to
 						   this node or there are children to this node. 
 						   The only way a nonexistent dirnode can have children is by 
@@ -331,16 +369,16 @@ recursion:
 							log_msg(LOG_LEVEL_WARNING, "open_dir(): failed for %s: %i", fullname, errno);
 						}
 					}
-					r->checked |= NODE_TRAVERSE | NODE_CHECKED;
-					r = r->parent;
+					w->node->checked |= NODE_TRAVERSE | NODE_CHECKED;
+					w->node = w->node->parent;
 					log_msg(LOG_LEVEL_TRACE, "dropping back to parent");
 				}
 				free(fullname);
 			} else {
-				r->checked |= NODE_TRAVERSE | NODE_CHECKED;
-				r = r->parent;
+				w->node->checked |= NODE_TRAVERSE | NODE_CHECKED;
+				w->node = w->node->parent;
 				/* We have gone out of the tree. This happens in some instances */
-				if (r == NULL) {
+				if (w->node == NULL) {
 					return NULL;
 				}
 				log_msg(LOG_LEVEL_TRACE, "dropping back to parent");
@@ -348,13 +386,13 @@ recursion:
 			goto recursion;
 		}
 
-		if (r->parent != NULL) {
+		if (w->node->parent != NULL) {
 			/*
 			   Go back in time:)
 			 */
-			r->checked |= NODE_CHECKED;
+			w->node->checked |= NODE_CHECKED;
 
-			r = r->parent;
+			w->node = w->node->parent;
 
 			goto recursion;
 		}
@@ -368,18 +406,42 @@ recursion:
 
 int db_disk_init ()
 {
+	disk_walker *w = conf->disk_walker;
 
-	r = conf->tree;
+	if (w == NULL) {
+		w = conf->disk_walker = checked_malloc(sizeof(disk_walker));
+		w->match_ctx = new_seltree_match_ctx();
+	} else if (w->dirh != NULL) {
+		conf->fs->closedir(w->dirh);
+	}
+	w->dirh = NULL;
+	w->entry = NULL;
+	w->root_handled = 0;
+	w->node = conf->tree;
 
 	int len = (conf->root_prefix_length+2)*sizeof(char);
 	char* fullname=checked_malloc(len);
 	snprintf(fullname, len, "%s/",  conf->root_prefix);
-	dirh=open_dir(fullname);
+	w->dirh=open_dir(fullname);
 	free(fullname);
 
 	return RETOK;
 }
 
+void db_disk_free(void)
+{
+	disk_walker *w = conf->disk_walker;
+
+	if (w != NULL) {
+		if (w->dirh != NULL) {
+			conf->fs->closedir(w->dirh);
+		}
+		free_seltree_match_ctx(w->match_ctx);
+		free(w);
+		conf->disk_walker = NULL;
+	}
+}
+
 /*
   We don't support writing to the pseudo-database disk, since we are'n a
   backup/restore software. Hence the functions db_writespec_disk,
@@ -22,6 +22,8 @@
 
 #include "config.h"
 #include "aide.h"
+#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -38,8 +40,11 @@
 #include <errno.h>
 
 #include "base64.h"
+#include "db.h"
+#include "db_dict.h"
 #include "db_lex.h"
 #include "db_file.h"
+#include "db_path.h"
 #include "util.h"
 
 #ifdef WITH_ZLIB
@@ -47,6 +52,7 @@
 #endif
 
 #define BUFSIZE 16384
+#define DB_BLOCK_ROWS 1024
 
 #include "md.h"
 
@@ -69,6 +75,38 @@ int dofflush(void)
   return retval;
 }
 
+static int dofwrite(const char* buf, size_t len)
+{
+  database *db = &(conf->database_out);
+  int retval;
+
+  /* output is collected in capture_buf instead (see get_dict_id()) */
+  if (db->capturing) {
+      if (db->capture_len + len >= db->capture_size) {
+          db->capture_size = 2 * (db->capture_len + len) + 1;
+          db->capture_buf = checked_realloc(db->capture_buf, db->capture_size);
+      }
+      memcpy(db->capture_buf + db->capture_len, buf, len);
+      db->capture_len += len;
+      return len;
+  }
+
+  update_db_attrs(&(conf->database_out), (void*) buf, len);
+
+#ifdef WITH_ZLIB
+  if(conf->gzip_dbout){
+    retval=gzwrite((conf->database_out).gzp,buf,len);
+  }else{
+#endif
+    /* writing is ok with fwrite with curl.. */
+    retval=fwrite(buf,1,len,conf->database_out.fp);
+#ifdef WITH_ZLIB
+  }
+#endif
+
+  return retval;
+}
+
 int dofprintf(const char*, ...)
 #ifdef __GNUC__
         __attribute__ ((format (printf, 1, 2)))
@@ -91,20 +129,7 @@ int dofprintf( const char* s,...)
   retval=vsnprintf(temp,retval+1,s,ap);
   va_end(ap);
   
-  if ((conf->database_out).mdc) {
-      update_md((conf->database_out).mdc,temp ,retval);
-  }
-
-#ifdef WITH_ZLIB
-  if(conf->gzip_dbout){
-    retval=gzwrite((conf->database_out).gzp,temp,retval);
-  }else{
-#endif
-    /* writing is ok with fwrite with curl.. */
-    retval=fwrite(temp,1,retval,conf->database_out.fp);
-#ifdef WITH_ZLIB
-  }
-#endif
+  retval=dofwrite(temp,retval);
   free(temp);
 
   return retval;
@@ -119,8 +144,8 @@ static int db_file_read_spec(database* db){
 
   db->fields = checked_malloc(1*sizeof(ATTRIBUTE));
   
-  while ((i=db_scan())!=TNEWLINE){
-    LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_file_read_spec(): db_scan() returned token=%d", i);
+  while ((i=db_scan(db))!=TNEWLINE){
+    LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_file_read_spec(): db_scan(db) returned token=%d", i);
 
     switch (i) {
       
@@ -129,14 +154,14 @@ static int db_file_read_spec(database* db){
       db->fields = checked_realloc(db->fields, (db->num_fields+1)*sizeof(ATTRIBUTE));
       db->fields[db->num_fields]=attr_unknown;
       for (l=0;l<num_attrs;l++){
-          if (attributes[l].db_name && strcmp(attributes[l].db_name,dbtext)==0) {
+          if (attributes[l].db_name && strcmp(attributes[l].db_name,db_text(db))==0) {
               if (ATTR(l)&seen_attrs) {
-                  LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "@@dbspec: skip redefined field '%s' at position %i", dbtext, db->num_fields)
+                  LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "@@dbspec: skip redefined field '%s' at position %i", db_text(db), db->num_fields)
                   db->fields[db->num_fields]=attr_unknown;
               } else {
                   db->fields[db->num_fields]=l;
                   seen_attrs |= ATTR(l);
-                  LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "@@dpspec: define field '%s' at position %i", dbtext, db->num_fields)
+                  LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "@@dpspec: define field '%s' at position %i", db_text(db), db->num_fields)
               }
               db->num_fields++;
               break;
@@ -144,7 +169,7 @@ static int db_file_read_spec(database* db){
       }
 
       if(l==attr_unknown){
-          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "@@dbspec: skip unknown field '%s' at position %i", dbtext, db->num_fields);
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "@@dbspec: skip unknown field '%s' at position %i", db_text(db), db->num_fields);
           db->fields[db->num_fields]=attr_unknown;
           db->num_fields++;
       }
@@ -152,45 +177,254 @@ static int db_file_read_spec(database* db){
     }
 
     default : {
-      LOG_DB_FORMAT_LINE(LOG_LEVEL_ERROR, "unexpected token while reading dbspec: '%s'", dbtext);
+      LOG_DB_FORMAT_LINE(LOG_LEVEL_ERROR, "unexpected token while reading dbspec: '%s'", db_text(db));
       return RETFAIL;
     }
     }
   }
 
   /* Lets generate attr from db_order if database does not have attr */
-  conf->attr=DB_ATTR_UNDEF;
+  db->attr=DB_ATTR_UNDEF;
 
   for (i=0;i<db->num_fields;i++) {
     if (db->fields[i] == attr_attr) {
-      conf->attr=1;
+      db->attr=1;
     }
   }
-  if (conf->attr==DB_ATTR_UNDEF) {
-    conf->attr=0;
+  if (db->attr==DB_ATTR_UNDEF) {
+    db->attr=0;
     for(i=0;i<db->num_fields;i++) {
-      conf->attr|=1LL<<db->fields[i];
+      db->attr|=1LL<<db->fields[i];
     }
     char *str;
-    LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "missing attr field, generated attr field from dbspec: %s (comparison may be incorrect)", str = diff_database_attributes(0, conf->attr))
+    LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "missing attr field, generated attr field from dbspec: %s (comparison may be incorrect)", str = diff_database_attributes(0, db->attr))
     free(str);
   }
+
+  /* unchanged entries of database_in are written verbatim to database_out
+   * if both have the same fields in the same order */
+  db->raw_lines = false;
+  if (db == &(conf->database_in) && conf->action&DO_INIT) {
+    bool same_fields = true;
+    i = 0;
+    for (ATTRIBUTE l = 0 ; l < num_attrs && same_fields ; ++l) {
+      if (attributes[l].db_name && attributes[l].attr&conf->db_out_attrs) {
+        same_fields = i < db->num_fields && db->fields[i] == l;
+        i++;
+      }
+    }
+    db->raw_lines = same_fields && i == db->num_fields;
+    LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "%s unchanged entries to database_out (@@db_spec %s that of database_out)", db->raw_lines?"copy":"re-encode", db->raw_lines?"matches":"differs from")
+  }
+
+  /* only the columns of the attributes of the rules (and of the forced
+   * report attributes) are read from the blocks of database_in, with
+   * --compare both databases are read completely */
+  db->read_attrs = ~(DB_ATTR_TYPE) 0;
+  if (db == &(conf->database_in) && !(conf->action&DO_DIFF) && !db->raw_lines) {
+    db->read_attrs = conf->db_out_attrs|conf->report_force_attrs|ATTR(attr_filename)|ATTR(attr_attr);
+  }
   return RETOK;
 }
 
 DB_TOKEN skip_line(database* db) {
     DB_TOKEN token;
     do {
-        token = db_scan();
-        LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan() returned a=%d", token);
-        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "skip_line(): skip '%s'", token==TNEWLINE?"\n":dbtext)
+        token = db_scan(db);
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan(db) returned a=%d", token);
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "skip_line(): skip '%s'", token==TNEWLINE?"\n":db_text(db))
     } while(token != TNEWLINE && token != TEOF);
     return token;
 }
 
+
+typedef enum { SUMMARY_NONE, SUMMARY_RANGE, SUMMARY_BITMAP } SUMMARY_TYPE;
+
+static SUMMARY_TYPE get_summary_type(ATTRIBUTE attr) {
+  switch (attr) {
+    case attr_perm:
+    case attr_attr:
+      return SUMMARY_BITMAP;
+    case attr_uid:
+    case attr_gid:
+    case attr_size:
+    case attr_bcount:
+    case attr_inode:
+    case attr_linkcount:
+    case attr_rule:
+      return SUMMARY_RANGE;
+    default:
+      return SUMMARY_NONE;
+  }
+}
+
+/* entries of the current block of the columnar layout (database_columnar) */
+typedef struct db_block {
+    char ***rows;
+    long num_rows;
+    long next;
+} db_block;
+
+/* Return: next entry of the current block / NULL (block is exhausted) */
+static char** next_block_row(database* db) {
+    db_block *block = db->block;
+    if (block->next < block->num_rows) {
+        return block->rows[block->next++];
+    }
+    free(block->rows);
+    free(block);
+    db->block = NULL;
+    return NULL;
+}
+
+static ATTRIBUTE get_column_attribute(database* db, const char* name) {
+    for (int i = 0 ; i < db->num_fields ; ++i) {
+        if (db->fields[i] != attr_unknown && strcmp(attributes[db->fields[i]].db_name, name) == 0) {
+            return db->fields[i];
+        }
+    }
+    return attr_unknown;
+}
+
+static DB_TOKEN read_column(database* db, char*** rows, long num_rows) {
+    DB_TOKEN token;
+    if ((token = db_scan(db)) != TCOLUMN) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "unexpected token '%s', expected '@@column' (skip line)", token==TNEWLINE?"\\n":db_text(db))
+        return token == TNEWLINE || token == TEOF ? token : skip_line(db);
+    }
+    if ((token = db_scan(db)) != TSTRING) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "%s", "missing field name after '@@column' (skip line)")
+        return token == TNEWLINE || token == TEOF ? token : skip_line(db);
+    }
+    ATTRIBUTE attr = get_column_attribute(db, db_text(db));
+    if (attr == attr_unknown) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "skip column of unknown field '%s'", db_text(db))
+        return skip_line(db);
+    }
+    if (!(ATTR(attr)&db->read_attrs)) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "skip column '%s' (not in the attributes of any rule)", attributes[attr].db_name)
+        return db_skip_line(db);
+    }
+    if ((token = db_scan(db)) != TSTRING) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "missing summary of column '%s' (skip line)", attributes[attr].db_name)
+        return token == TNEWLINE || token == TEOF ? token : skip_line(db);
+    }
+    /* a column whose range summary has min == max holds the same value for
+     * all entries, the values themselves are not scanned */
+    if (get_summary_type(attr) == SUMMARY_RANGE) {
+        char *endp;
+        long long min = strtoll(db_text(db), &endp, 10);
+        if (*endp == ',' && endp != db_text(db)) {
+            char *start = endp + 1;
+            long long max = strtoll(start, &endp, 10);
+            if (*endp == '\0' && endp != start && min == max) {
+                char value[32];
+                snprintf(value, sizeof(value), "%lli", min);
+                for (long r = 0 ; r < num_rows ; ++r) {
+                    free(rows[r][attr]);
+                    rows[r][attr] = checked_strdup(value);
+                }
+                LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "set column '%s' to '%s' (from summary)", attributes[attr].db_name, value)
+                return db_skip_line(db);
+            }
+        }
+    }
+    long r;
+    for (r = 0 ; r < num_rows && (token = db_scan(db)) == TSTRING ; ++r) {
+        free(rows[r][attr]);
+        if (attr == attr_filename) {
+            rows[r][attr] = db_read_path(db, db_text(db), true);
+            if (rows[r][attr] == NULL) {
+                LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "invalid path found: '%s' (skip entry)", db_text(db));
+            }
+        } else {
+            rows[r][attr] = checked_strdup(db_text(db));
+        }
+    }
+    if (r < num_rows) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "column '%s' has %li of %li values (missing values are set to '0')", attributes[attr].db_name, r, num_rows)
+        return token == TNEWLINE || token == TEOF ? token : skip_line(db);
+    }
+    token = db_scan(db);
+    if (token != TNEWLINE && token != TEOF) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "column '%s' has more than %li values (skip remaining values)", attributes[attr].db_name, num_rows)
+        token = skip_line(db);
+    }
+    return token;
+}
+
+/*
+ * read_block()
+ * reads '@@block <entries> <columns>' and the following column lines,
+ * the entries are returned by next_block_row()
+ * Return: last token read
+ */
+static DB_TOKEN read_block(database* db) {
+    DB_TOKEN token;
+    long num_rows = 0;
+    long num_columns = -1;
+    char *endp = "";
+
+    if ((token = db_scan(db)) == TSTRING) {
+        num_rows = strtol(db_text(db), &endp, 10);
+        if (*endp == '\0' && (token = db_scan(db)) == TSTRING) {
+            num_columns = strtol(db_text(db), &endp, 10);
+            if (*endp == '\0') {
+                token = db_scan(db);
+            }
+        }
+    }
+    if (num_rows <= 0 || num_rows > DB_BLOCK_ROWS || num_columns < 0 || *endp != '\0' || token != TNEWLINE) {
+        LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "%s", "invalid '@@block' header found (skip line)")
+        return token == TNEWLINE || token == TEOF ? token : skip_line(db);
+    }
+
+    char ***rows = checked_malloc(num_rows * sizeof(char**));
+    for (long r = 0 ; r < num_rows ; ++r) {
+        rows[r] = checked_malloc(num_attrs * sizeof(char*));
+        for (ATTRIBUTE j = 0 ; j < num_attrs ; ++j) {
+            rows[r][j] = NULL;
+        }
+    }
+    for (long c = 0 ; c < num_columns && token != TEOF ; ++c) {
+        token = read_column(db, rows, num_rows);
+    }
+
+    db_block *block = checked_malloc(sizeof(db_block));
+    block->rows = rows;
+    block->num_rows = 0;
+    block->next = 0;
+    for (long r = 0 ; r < num_rows ; ++r) {
+        if (rows[r][attr_filename] == NULL) {
+            LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "entry %li of block has no path (skip entry)", r + 1)
+            for (ATTRIBUTE j = 0 ; j < num_attrs ; ++j) {
+                free(rows[r][j]);
+            }
+            free(rows[r]);
+            continue;
+        }
+        /* columns with only '0' values are not written, skipped columns
+         * are left unset (see db_char2line()) */
+        for (int i = 0 ; i < db->num_fields ; ++i) {
+            if (db->fields[i] != attr_unknown && ATTR(db->fields[i])&db->read_attrs && rows[r][db->fields[i]] == NULL) {
+                rows[r][db->fields[i]] = checked_strdup("0");
+            }
+        }
+        rows[block->num_rows++] = rows[r];
+    }
+    LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "read block with %li entries", block->num_rows)
+    db->block = block;
+    return token;
+}
+
 char** db_readline_file(database* db) {
   log_msg(LOG_LEVEL_TRACE, "db_readline_file(): arguments db=%p", db);
   char** s=NULL;
+
+  if (db->block && (s = next_block_row(db)) != NULL) {
+      db->view_fields = 0;
+      return s;
+  }
   
   int i=0;
   int a=0;
@@ -198,18 +432,58 @@ char** db_readline_file(database* db) {
   bool found_enddb = false;;
 
   do {
-  token = db_scan();
-  LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan() returned token=%d", token);
+  token = db_scan(db);
+  LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan(db) returned token=%d", token);
   if (db->fields) {
     switch (token) {
         case TUNKNOWN: {
-          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "unknown token '%s' found inside database (skip line)", dbtext)
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "unknown token '%s' found inside database (skip line)", db_text(db))
           skip_line(db);
           break;
         }
         case TDBSPEC:
         case TBEGIN_DB: {
-          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "additional '%s' found inside database (skip line)", dbtext)
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "additional '%s' found inside database (skip line)", db_text(db))
+          skip_line(db);
+          break;
+        }
+        case TDICT: {
+          char *def[3];
+          int n = 0;
+          while (n < 3 && (token = db_scan(db)) == TSTRING) {
+              def[n++] = checked_strdup(db_text(db));
+          }
+          if (n < 3) {
+              LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "%s", "incomplete dictionary definition found (skip line)")
+              if (token != TNEWLINE && token != TEOF) {
+                  token = skip_line(db);
+              }
+          } else if (!db_dict_define(db, def[0], def[1], def[2])) {
+              token = skip_line(db);
+          }
+          for (int j = 0 ; j < n ; ++j) {
+              free(def[j]);
+          }
+          if (token == TEOF) {
+              LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "%s", "missing '@@end_db' in database")
+              return s;
+          }
+          break;
+        }
+        case TBLOCK: {
+          token = read_block(db);
+          if (db->block && (s = next_block_row(db)) != NULL) {
+              db->view_fields = 0;
+              return s;
+          }
+          if (token == TEOF) {
+              LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "%s", "missing '@@end_db' in database")
+              return s;
+          }
+          break;
+        }
+        case TCOLUMN: {
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "%s", "'@@column' found outside of block (skip line)")
           skip_line(db);
           break;
         }
@@ -224,7 +498,9 @@ char** db_readline_file(database* db) {
                 if (i<db->num_fields-1) {
                     LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "cutoff database line '%s' found (field '%s' (position: %d) is missing) (skip line)", s[0], attributes[db->fields[i+1]].db_name, i+1);
                     for(a=0;a<i;a++){
-                        free(s[db->fields[a]]);
+                        if (!(ATTR(db->fields[a])&db->view_fields)) {
+                            free(s[db->fields[a]]);
+                        }
                         s[db->fields[a]] = NULL;
                     }
                     free(s);
@@ -247,17 +523,24 @@ char** db_readline_file(database* db) {
             if (s) {
                 if (++i<db->num_fields) {
                     if (db->fields[i] != attr_unknown) {
-                        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "'%s' set field '%s' (position %d): '%s'", s[0], attributes[db->fields[i]].db_name, i, dbtext);
-                        s[db->fields[i]] = checked_strdup(dbtext);
+                        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "'%s' set field '%s' (position %d): '%s'", s[0], attributes[db->fields[i]].db_name, i, db_text(db));
+                        if (db->map) {
+                            /* the field of a mapped database is used in place */
+                            s[db->fields[i]] = db_text(db);
+                            db->view_fields |= ATTR(db->fields[i]);
+                        } else {
+                            s[db->fields[i]] = checked_strdup(db_text(db));
+                        }
                     } else {
-                        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "skip unknown/redefined field at position: %d: '%s'", i, dbtext);
+                        LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "skip unknown/redefined field at position: %d: '%s'", i, db_text(db));
                     }
                 } else {
-                    LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "expected newline or end of file (skip found string '%s')", dbtext);
+                    LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "expected newline or end of file (skip found string '%s')", db_text(db));
                 }
             } else {
-                if (*dbtext != '/') {
-                    LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "invalid path found: '%s' (skip line)", dbtext);
+                char *path = db_read_path(db, db_text(db), db->map == NULL);
+                if (path == NULL) {
+                    LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "invalid path found: '%s' (skip line)", db_text(db));
                     skip_line(db);
                 } else {
                     i = 0;
@@ -265,12 +548,13 @@ char** db_readline_file(database* db) {
                     for(ATTRIBUTE j=0; j<num_attrs; j++){
                         s[j]=NULL;
                     }
-                    s[i] = checked_strdup(dbtext);
-                    LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "'%s' set field '%s' (position %d): '%s'", s[0], attributes[db->fields[i]].db_name, i, dbtext);
+                    s[i] = path;
+                    db->view_fields = path == db_text(db) ? ATTR(attr_filename) : 0;
+                    LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "'%s' set field '%s' (position %d): '%s'", s[0], attributes[db->fields[i]].db_name, i, db_text(db));
                 }
             }
             } else {
-                LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "expected newline or end of file (skip found string '%s')", dbtext)
+                LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "expected newline or end of file (skip found string '%s')", db_text(db))
             }
             break;
         }
@@ -286,22 +570,22 @@ char** db_readline_file(database* db) {
               LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "db_readline_file(): '@@begin_db' NOT found (stop reading database)", NULL);
               return s;
           }
-          LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "db_readline_file(): skip '%s'", dbtext);
-          token = db_scan();
-          LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan() returned token=%d", token);
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "db_readline_file(): skip '%s'", db_text(db));
+          token = db_scan(db);
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan(db) returned token=%d", token);
       }
       LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "'@@begin_db' found", NULL)
-      token = db_scan();
-      LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan() returned token=%d", token);
+      token = db_scan(db);
+      LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan(db) returned token=%d", token);
       if (token != TNEWLINE) {
               LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "db_readline_file(): missing newline after '@@begin_db' (stop reading database)", NULL);
               return s;
 
       } else {
-          token = db_scan();
-          LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan() returned token=%d", token);
+          token = db_scan(db);
+          LOG_DB_FORMAT_LINE(LOG_LEVEL_TRACE, "db_readline_file(): db_scan(db) returned token=%d", token);
           if (token != TDBSPEC) {
-              LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "db_readline_file(): unexpected token '%s'%c expected '@@db_spec' (stop reading database)", dbtext, 'c');
+              LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "db_readline_file(): unexpected token '%s'%c expected '@@db_spec' (stop reading database)", db_text(db), 'c');
               return s;
           } else {
               LOG_DB_FORMAT_LINE(LOG_LEVEL_DEBUG, "'@@dbspec' found", NULL)
@@ -422,7 +706,7 @@ int db_write_byte_base64(byte*data,size_t len,FILE* file,int i,
 
 int db_write_time_base64(time_t i,FILE* file,int a)
 {
-  static char* ptr=NULL;
+  char* ptr=NULL;
   char* tmpstr=NULL;
   int retval=0;
 
@@ -470,9 +754,9 @@ int db_writeoct(long i, FILE* file,int a)
 int db_writespec_file(db_config* dbconf)
 {
   int retval=1;
-  struct tm* st;
+  struct tm tm, *st;
   time_t tim=time(&tim);
-  st=localtime(&tim);
+  st=localtime_r(&tim, &tm);
 
   retval=dofprintf("@@begin_db\n");
   if(retval==0){
@@ -552,142 +836,450 @@ int db_writeacl(acl_type* acl,FILE* file,int a)
 case attr_ ##x : { \
     db_write_byte_base64(line->hashsums[hash_ ##x], \
         hashsums[hash_ ##x].length, \
-        dbconf->database_out.fp, i, \
+        dbconf->database_out.fp, a, \
         ATTR(attr_ ##x), line->attr); \
     break; \
 }
 
-int db_writeline_file(db_line* line,db_config* dbconf, url_t* url){
-
-  (void)url;
+static int db_writefield(db_line* line,db_config* dbconf, ATTRIBUTE i, int a){
+  switch (i) {
+  case attr_filename : {
+    db_writechar(line->filename,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_linkname : {
+    db_writechar(line->linkname,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_bcount : {
+    db_writelonglong(line->bcount,dbconf->database_out.fp,a);
+    break;
+  }
 
-  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
-    if (attributes[i].db_name && ATTR(i)&conf->db_out_attrs) {
-    switch (i) {
-    case attr_filename : {
-      db_writechar(line->filename,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_linkname : {
-      db_writechar(line->linkname,dbconf->database_out.fp,i);
+  case attr_mtime : {
+    db_write_time_base64(line->mtime,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_atime : {
+    db_write_time_base64(line->atime,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_ctime : {
+    db_write_time_base64(line->ctime,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_verified : {
+    db_write_time_base64(line->verified,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_rule : {
+    db_writelonglong(line->rule,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_inode : {
+    db_writelong(line->inode,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_linkcount : {
+    db_writelong(line->nlink,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_uid : {
+    db_writelong(line->uid,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_gid : {
+    db_writelong(line->gid,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_size : {
+    db_writelonglong(line->size,dbconf->database_out.fp,a);
+    break;
+  }
+  case attr_perm : {
+    db_writeoct(line->perm,dbconf->database_out.fp,a);
+    break;
+  }
+  WRITE_HASHSUM(md5)
+  WRITE_HASHSUM(sha1)
+  WRITE_HASHSUM(rmd160)
+  WRITE_HASHSUM(tiger)
+  WRITE_HASHSUM(crc32)
+  WRITE_HASHSUM(crc32b)
+  WRITE_HASHSUM(haval)
+  WRITE_HASHSUM(gostr3411_94)
+  WRITE_HASHSUM(stribog256)
+  WRITE_HASHSUM(stribog512)
+  WRITE_HASHSUM(sha256)
+  WRITE_HASHSUM(sha512)
+  WRITE_HASHSUM(whirlpool)
+  case attr_attr : {
+    db_write_attr(line->attr, dbconf->database_out.fp,a);
+    break;
+  }
+#ifdef WITH_ACL
+  case attr_acl : {
+    db_writeacl(line->acl,dbconf->database_out.fp,a);
+    break;
+  }
+#endif
+#ifdef WITH_XATTR
+  case attr_xattrs : {
+      xattr_node *xattr = NULL;
+      size_t num = 0;
+      
+      if (!line->xattrs)
+      {
+        db_writelong(0, dbconf->database_out.fp, a);
+        break;
+      }
+      
+      db_writelong(line->xattrs->num, dbconf->database_out.fp, a);
+      
+      xattr = line->xattrs->ents;
+      while (num < line->xattrs->num)
+      {
+        dofprintf(",");
+        db_writechar(xattr->key, dbconf->database_out.fp, 0);
+        dofprintf(",");
+        db_write_byte_base64(xattr->val, xattr->vsz, dbconf->database_out.fp, 0, 1, 1);
+        
+        ++xattr;
+        ++num;
+      }
+    break;
+  }
+#endif
+  case attr_selinux : {
+	db_write_byte_base64((byte*)line->cntx, 0, dbconf->database_out.fp, a, 1, 1);
+    break;
+  }
+#ifdef WITH_E2FSATTRS
+  case attr_e2fsattrs : {
+    db_writelong(line->e2fsattrs,dbconf->database_out.fp,a);
+    break;
+  }
+#endif
+#ifdef WITH_CAPABILITIES
+  case attr_capabilities : {
+    db_write_byte_base64((byte*)line->capabilities, 0, dbconf->database_out.fp, a, 1, 1);
+    break;
+  }
+#endif
+  case attr_chunks : {
+    if (!line->chunks) {
+      db_writelong(0, dbconf->database_out.fp, a);
       break;
     }
-    case attr_bcount : {
-      db_writelonglong(line->bcount,dbconf->database_out.fp,i);
+    db_writelonglong(line->chunks->chunk_size, dbconf->database_out.fp, a);
+    dofprintf(",");
+    db_writelong(line->chunks->num, dbconf->database_out.fp, 0);
+    dofprintf(",");
+    db_write_byte_base64(line->chunks->digests,
+            line->chunks->num*hashsums[CHUNK_HASHSUM].length,
+            dbconf->database_out.fp, 0, 1, 1);
+    break;
+  }
+  case attr_fsverity : {
+    if (!line->fsverity) {
+      db_writelong(0, dbconf->database_out.fp, a);
       break;
     }
+    db_writelong(line->fsverity->algorithm, dbconf->database_out.fp, a);
+    dofprintf(",");
+    db_write_byte_base64(line->fsverity->digest, line->fsverity->length,
+            dbconf->database_out.fp, 0, 1, 1);
+    break;
+  }
+  default : {
+    log_msg(LOG_LEVEL_ERROR,"not implemented in db_writeline_file %i", i);
+    return RETFAIL;
+  }
+  
+  }
+  return RETOK;
+}
 
-    case attr_mtime : {
-      db_write_time_base64(line->mtime,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_atime : {
-      db_write_time_base64(line->atime,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_ctime : {
-      db_write_time_base64(line->ctime,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_inode : {
-      db_writelong(line->inode,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_linkcount : {
-      db_writelong(line->nlink,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_uid : {
-      db_writelong(line->uid,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_gid : {
-      db_writelong(line->gid,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_size : {
-      db_writelonglong(line->size,dbconf->database_out.fp,i);
-      break;
-    }
-    case attr_perm : {
-      db_writeoct(line->perm,dbconf->database_out.fp,i);
-      break;
+static void capture_field(db_line* line,db_config* dbconf, ATTRIBUTE i){
+  database *db = &(dbconf->database_out);
+
+  db->capture_len = 0;
+  db->capturing = true;
+  db_writefield(line, dbconf, i, 0);
+  db->capturing = false;
+}
+
+/* Return: id of the dictionary entry of the field / -1 (value is written inline) */
+static long get_dict_id(db_line* line,db_config* dbconf, ATTRIBUTE i){
+  database *db = &(dbconf->database_out);
+
+  capture_field(line, dbconf, i);
+  if (db->capture_len == 0) {
+    return -1;
+  }
+  db->capture_buf[db->capture_len] = '\0';
+
+  if (strcmp(db->capture_buf, "0") == 0) {
+    return -1;
+  }
+  bool new;
+  long id = db_dict_get_id(db, i, db->capture_buf, &new);
+  if (new) {
+    db->write_stats.dict_entries++;
+    dofprintf("@@dict %s %li %s\n", attributes[i].db_name, id, db->capture_buf);
+  }
+  return id;
+}
+
+/* writes the filename front-coded (see db_path.h) */
+static void db_write_front_coded_filename(db_line* line,db_config* dbconf){
+  database *db = &(dbconf->database_out);
+
+  capture_field(line, dbconf, attr_filename);
+  size_t n = db_front_code_path(db, db->capture_buf, db->capture_len);
+  db->write_stats.path_bytes += db->capture_len;
+  db->write_stats.front_coded_path_bytes += db->capture_len - n;
+  if (n) {
+    db->write_stats.front_coded_path_bytes += dofprintf("%lu:", (unsigned long) n);
+    dofwrite(db->capture_buf + n, db->capture_len - n);
+  } else {
+    dofwrite(db->capture_buf, db->capture_len);
+  }
+}
+
+/*
+ * columnar layout (database_columnar)
+ *
+ * The entries are written in blocks of up to DB_BLOCK_ROWS entries:
+ *   @@block <entries> <columns>
+ *   @@column <field> <summary> <value of entry 1> ... <value of entry n>
+ * Columns whose values are all '0' (e.g. hashsums not in the attr mask of
+ * any rule of the block's entries) are not written. The summary is
+ * '<min>,<max>' for numeric fields, the bitwise or of all values for
+ * 'perm' (octal) and 'attr' and '-' for all other fields. The reader skips
+ * the columns not in read_attrs and the values of constant ranges (see
+ * read_column()).
+ */
+
+typedef struct db_column {
+    ATTRIBUTE attr;
+    SUMMARY_TYPE summary;
+    char *values;
+    size_t len;
+    size_t size;
+    bool zero; /* all values are '0' */
+    long long min;
+    long long max;
+    unsigned long long bitmap;
+} db_column;
+
+static void reset_column(db_column *column) {
+  column->len = 0;
+  column->zero = true;
+  column->min = LLONG_MAX;
+  column->max = LLONG_MIN;
+  column->bitmap = 0;
+}
+
+static void init_columns(database* db) {
+  db->columns = checked_malloc(num_attrs * sizeof(db_column));
+  db->num_columns = 0;
+  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
+    if (attributes[i].db_name && ATTR(i)&conf->db_out_attrs) {
+      db_column *column = &db->columns[db->num_columns++];
+      column->attr = i;
+      column->summary = get_summary_type(i);
+      column->values = NULL;
+      column->size = 0;
+      reset_column(column);
     }
-    WRITE_HASHSUM(md5)
-    WRITE_HASHSUM(sha1)
-    WRITE_HASHSUM(rmd160)
-    WRITE_HASHSUM(tiger)
-    WRITE_HASHSUM(crc32)
-    WRITE_HASHSUM(crc32b)
-    WRITE_HASHSUM(haval)
-    WRITE_HASHSUM(gostr3411_94)
-    WRITE_HASHSUM(stribog256)
-    WRITE_HASHSUM(stribog512)
-    WRITE_HASHSUM(sha256)
-    WRITE_HASHSUM(sha512)
-    WRITE_HASHSUM(whirlpool)
-    case attr_attr : {
-      db_write_attr(line->attr, dbconf->database_out.fp,i);
-      break;
+  }
+}
+
+static void add_column_value(db_column *column, const char *prefix, const char *s, size_t len) {
+  size_t prefix_len = strlen(prefix);
+  if (column->len + prefix_len + len + 2 > column->size) {
+    column->size = 2 * (column->len + prefix_len + len + 2);
+    column->values = checked_realloc(column->values, column->size);
+  }
+  column->values[column->len++] = ' ';
+  memcpy(column->values + column->len, prefix, prefix_len);
+  column->len += prefix_len;
+  memcpy(column->values + column->len, s, len);
+  column->len += len;
+  column->values[column->len] = '\0';
+
+  if (prefix_len || len != 1 || s[0] != '0') {
+    column->zero = false;
+  }
+  if (column->summary != SUMMARY_NONE) {
+    char *value = column->values + column->len - len;
+    if (column->summary == SUMMARY_BITMAP) {
+      column->bitmap |= strtoull(value, NULL, column->attr == attr_perm ? 8 : 10);
+    } else {
+      long long l = strtoll(value, NULL, 10);
+      column->min = l < column->min ? l : column->min;
+      column->max = l > column->max ? l : column->max;
     }
-#ifdef WITH_ACL
-    case attr_acl : {
-      db_writeacl(line->acl,dbconf->database_out.fp,i);
-      break;
+  }
+}
+
+static void add_filename_value(db_column *column, db_config* dbconf, const char *s, size_t len) {
+  database *db = &(dbconf->database_out);
+  size_t n = 0;
+  if (conf->database_prefix_compression) {
+    n = db_front_code_path(db, s, len);
+    db->write_stats.path_bytes += len;
+    db->write_stats.front_coded_path_bytes += len - n;
+  }
+  if (n) {
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "%lu:", (unsigned long) n);
+    db->write_stats.front_coded_path_bytes += strlen(prefix);
+    add_column_value(column, prefix, s + n, len - n);
+  } else {
+    add_column_value(column, "", s, len);
+  }
+}
+
+static void db_write_block(database* db) {
+  int n = 0;
+  for (int i = 0 ; i < db->num_columns ; ++i) {
+    if (!db->columns[i].zero) {
+      n++;
     }
-#endif
-#ifdef WITH_XATTR
-    case attr_xattrs : {
-        xattr_node *xattr = NULL;
-        size_t num = 0;
-        
-        if (!line->xattrs)
-        {
-          db_writelong(0, dbconf->database_out.fp, i);
+  }
+  dofprintf("@@block %li %i\n", db->block_rows, n);
+  for (int i = 0 ; i < db->num_columns ; ++i) {
+    db_column *column = &db->columns[i];
+    if (!column->zero) {
+      dofprintf("@@column %s ", attributes[column->attr].db_name);
+      switch (column->summary) {
+        case SUMMARY_RANGE:
+          dofprintf("%lli,%lli", column->min, column->max);
           break;
-        }
-        
-        db_writelong(line->xattrs->num, dbconf->database_out.fp, i);
-        
-        xattr = line->xattrs->ents;
-        while (num < line->xattrs->num)
-        {
-          dofprintf(",");
-          db_writechar(xattr->key, dbconf->database_out.fp, 0);
-          dofprintf(",");
-          db_write_byte_base64(xattr->val, xattr->vsz, dbconf->database_out.fp, 0, 1, 1);
-          
-          ++xattr;
-          ++num;
-        }
-      break;
+        case SUMMARY_BITMAP:
+          dofprintf(column->attr == attr_perm ? "%llo" : "%llu", column->bitmap);
+          break;
+        case SUMMARY_NONE:
+          dofprintf("-");
+          break;
+      }
+      dofwrite(column->values, column->len);
+      dofprintf("\n");
     }
-#endif
-    case attr_selinux : {
-	db_write_byte_base64((byte*)line->cntx, 0, dbconf->database_out.fp, i, 1, 1);
-      break;
+    reset_column(column);
+  }
+  dofflush();
+  db->write_stats.blocks++;
+  db->block_rows = 0;
+}
+
+static void free_columns(database* db) {
+  for (int i = 0 ; i < db->num_columns ; ++i) {
+    free(db->columns[i].values);
+  }
+  free(db->columns);
+  db->columns = NULL;
+  db->num_columns = 0;
+}
+
+static int db_writeline_columnar(db_line* line,db_config* dbconf){
+  database *db = &(dbconf->database_out);
+  if (db->columns == NULL) {
+    init_columns(db);
+  }
+  db_column *columns = db->columns;
+
+  if (line->raw) {
+    /* the fields of a raw line are in the order of the columns */
+    const char *p = line->raw;
+    for (int i = 0 ; i < db->num_columns ; ++i) {
+      size_t len = strcspn(p, " ");
+      if (columns[i].attr == attr_filename) {
+        add_filename_value(&columns[i], dbconf, p, len);
+      } else {
+        add_column_value(&columns[i], "", p, len);
+      }
+      p += len;
+      if (*p) {
+        p++;
+      }
     }
-#ifdef WITH_E2FSATTRS
-    case attr_e2fsattrs : {
-      db_writelong(line->e2fsattrs,dbconf->database_out.fp,i);
-      break;
+  } else {
+    for (int i = 0 ; i < db->num_columns ; ++i) {
+      ATTRIBUTE attr = columns[i].attr;
+      long id = ATTR(attr)&DB_DICT_ATTRS && conf->database_dictionary ? get_dict_id(line, dbconf, attr) : -1;
+      if (id >= 0) {
+        char ref[32];
+        snprintf(ref, sizeof(ref), "@%li", id);
+        add_column_value(&columns[i], "", ref, strlen(ref));
+      } else {
+        capture_field(line, dbconf, attr);
+        const char *value = db->capture_len ? db->capture_buf : "0";
+        size_t len = db->capture_len ? db->capture_len : 1;
+        if (attr == attr_filename) {
+          add_filename_value(&columns[i], dbconf, value, len);
+        } else {
+          add_column_value(&columns[i], "", value, len);
+        }
+      }
     }
-#endif
-#ifdef WITH_CAPABILITIES
-    case attr_capabilities : {
-      db_write_byte_base64((byte*)line->capabilities, 0, dbconf->database_out.fp, i, 1, 1);
-      break;
+  }
+
+  if (++db->block_rows == DB_BLOCK_ROWS) {
+    db_write_block(db);
+  }
+  return RETOK;
+}
+
+int db_writeline_file(db_line* line,db_config* dbconf, url_t* url){
+  database *db = &(dbconf->database_out);
+
+  (void)url;
+
+  db->write_stats.lines++;
+  if (conf->database_columnar) {
+    if (line->raw) {
+      db->write_stats.raw_lines++;
     }
-#endif
-    default : {
-      log_msg(LOG_LEVEL_ERROR,"not implemented in db_writeline_file %i", i);
-      return RETFAIL;
+    return db_writeline_columnar(line, dbconf);
+  }
+  if (line->raw) {
+    /* unchanged entry of database_in with the same fields */
+    db->write_stats.raw_lines++;
+    if (conf->database_prefix_compression) {
+      size_t len = strcspn(line->raw, " ");
+      db->write_stats.path_bytes += len;
+      db->write_stats.front_coded_path_bytes += len;
+      db_set_prev_path(&(dbconf->database_out), line->raw, len);
     }
-    
+    dofwrite(line->raw, strlen(line->raw));
+    dofwrite("\n", 1);
+    dofflush();
+    return RETOK;
+  }
+
+  /* values of the dictionary fields are defined before the entry */
+  long dict_ids[DB_DICT_NUM_FIELDS];
+  int n = 0;
+  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
+    if (attributes[i].db_name && ATTR(i)&conf->db_out_attrs&DB_DICT_ATTRS) {
+      dict_ids[n++] = conf->database_dictionary?get_dict_id(line, dbconf, i):-1;
     }
-    
   }
 
+  n = 0;
+  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
+    if (attributes[i].db_name && ATTR(i)&conf->db_out_attrs) {
+      if (ATTR(i)&DB_DICT_ATTRS && dict_ids[n++] >= 0) {
+        dofprintf(" @%li", dict_ids[n-1]);
+      } else if (i == attr_filename && conf->database_prefix_compression) {
+        db_write_front_coded_filename(line, dbconf);
+      } else if (db_writefield(line, dbconf, i, i) != RETOK) {
+        return RETFAIL;
+      }
+    }
   }
 
   dofprintf("\n");
@@ -698,24 +1290,46 @@ int db_writeline_file(db_line* line,db_config* dbconf, url_t* url){
 }
 
 int db_close_file(db_config* dbconf){
-  
+  database *db = &(dbconf->database_out);
+
   if(dbconf->database_out.fp
 #ifdef WITH_ZLIB
      || dbconf->database_out.gzp
 #endif
      ){
+      if (dbconf->database_out.block_rows) {
+          db_write_block(&(dbconf->database_out));
+      }
       dofprintf("@@end_db\n");
+      log_msg(LOG_LEVEL_INFO, "wrote %lu entries to database_out (%lu copied unchanged from database_in)", db->write_stats.lines, db->write_stats.raw_lines);
+      if (conf->database_dictionary) {
+          log_msg(LOG_LEVEL_INFO, "wrote %lu dictionary entries to database_out", db->write_stats.dict_entries);
+      }
+      if (conf->database_columnar) {
+          log_msg(LOG_LEVEL_INFO, "wrote %lu blocks to database_out", db->write_stats.blocks);
+      }
+      if (conf->database_prefix_compression) {
+          log_msg(LOG_LEVEL_INFO, "wrote %llu bytes of paths to database_out (%llu bytes without prefix compression)", db->write_stats.front_coded_path_bytes, db->write_stats.path_bytes);
+      }
   }
+  free_columns(&(dbconf->database_out));
+  free(db->capture_buf);
+  db->capture_buf = NULL;
+  db->capture_size = 0;
 
 #ifdef WITH_ZLIB
   if(dbconf->gzip_dbout){
-    if(gzclose(dbconf->database_out.gzp)){
+    gzFile gzp = dbconf->database_out.gzp;
+    dbconf->database_out.gzp = NULL;
+    if(gzclose(gzp)){
       log_msg(LOG_LEVEL_ERROR,"unable to gzclose database '%s:%s': %s", get_url_type_string((dbconf->database_out.url)->type), (dbconf->database_out.url)->value, strerror(errno));
       return RETFAIL;
     }
   }else {
 #endif
-    if(fclose(dbconf->database_out.fp)){
+    FILE *fp = dbconf->database_out.fp;
+    dbconf->database_out.fp = NULL;
+    if(fclose(fp)){
       log_msg(LOG_LEVEL_ERROR,"unable to close database '%s:%s': %s", get_url_type_string((dbconf->database_out.url)->type), (dbconf->database_out.url)->value, strerror(errno));
       return RETFAIL;
     }
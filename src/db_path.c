@@ -0,0 +1,73 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_config.h"
+#include "db_path.h"
+#include "util.h"
+
+static void set_path(database *db, size_t n, const char *suffix, size_t len) {
+    if (len + 1 > db->path_size) {
+        db->path_size = 2 * len + 1;
+        db->path = checked_realloc(db->path, db->path_size);
+    }
+    memcpy(db->path + n, suffix, len - n);
+    db->path[len] = '\0';
+    db->path_len = len;
+}
+
+char *db_read_path(database *db, char *text, bool copy) {
+    size_t n = 0;
+    const char *suffix = text;
+    if (*text != '/') {
+        char *endp;
+        if (!isdigit((unsigned char) *text)) {
+            return NULL;
+        }
+        unsigned long l = strtoul(text, &endp, 10);
+        if (*endp != ':' || l == 0 || l > db->path_len) {
+            return NULL;
+        }
+        n = l;
+        suffix = endp + 1;
+    }
+    set_path(db, n, suffix, n + strlen(suffix));
+    return n || copy ? checked_strdup(db->path) : text;
+}
+
+void db_set_prev_path(database *db, const char *s, size_t len) {
+    set_path(db, 0, s, len);
+}
+
+size_t db_front_code_path(database *db, const char *s, size_t len) {
+    size_t n = 0;
+    while (n < len && n < db->path_len && s[n] == db->path[n]) {
+        n++;
+    }
+    if (n <= DB_PATH_MIN_PREFIX) {
+        n = 0;
+    }
+    set_path(db, n, s + n, len);
+    return n;
+}
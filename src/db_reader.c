@@ -0,0 +1,224 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "aide.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db.h"
+#include "db_lex.h"
+#include "db_reader.h"
+#include "log.h"
+#include "url.h"
+#include "util.h"
+
+/* number of lines passed to the consumer at once */
+#define DB_READER_BATCH_SIZE 256
+
+/* the reading thread waits while this many lines are queued */
+#define DB_READER_MAX_QUEUED (16*DB_READER_BATCH_SIZE)
+
+typedef struct db_reader_batch {
+    db_line *lines[DB_READER_BATCH_SIZE];
+    int num_lines;
+    struct db_reader_batch *next;
+} db_reader_batch;
+
+struct db_reader {
+    db_config *conf; /* configuration of the scan (bound by the reading thread) */
+    database *db;
+    bool threaded;
+    pthread_t thread;
+
+    /* protected by mutex */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    db_reader_batch *head;
+    db_reader_batch *tail;
+    unsigned long num_queued;
+    unsigned long max_queued;
+    bool done;
+
+    /* owned by the consumer */
+    db_reader_batch *current;
+    int pos;
+    unsigned long num_lines;
+};
+
+static void queue_batch(db_reader *reader, db_reader_batch *batch) {
+    pthread_mutex_lock(&reader->mutex);
+    while (batch && reader->num_queued >= DB_READER_MAX_QUEUED) {
+        pthread_cond_wait(&reader->cond, &reader->mutex);
+    }
+    if (batch) {
+        if (reader->tail) {
+            reader->tail->next = batch;
+        } else {
+            reader->head = batch;
+        }
+        reader->tail = batch;
+        reader->num_queued += batch->num_lines;
+        if (reader->num_queued > reader->max_queued) {
+            reader->max_queued = reader->num_queued;
+        }
+    } else {
+        reader->done = true;
+    }
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->mutex);
+}
+
+static db_reader_batch *new_batch(void) {
+    db_reader_batch *batch = checked_malloc(sizeof(db_reader_batch));
+    batch->num_lines = 0;
+    batch->next = NULL;
+    return batch;
+}
+
+static void *read_database(void *arg) {
+    db_reader *reader = arg;
+    db_reader_batch *batch = new_batch();
+    db_line *line;
+
+    conf = reader->conf;
+    db_lex_buffer(reader->db);
+    while ((line = db_readline(reader->db)) != NULL) {
+        batch->lines[batch->num_lines++] = line;
+        if (batch->num_lines == DB_READER_BATCH_SIZE) {
+            queue_batch(reader, batch);
+            batch = new_batch();
+        }
+    }
+    db_lex_delete_buffer(reader->db);
+
+    if (batch->num_lines) {
+        queue_batch(reader, batch);
+    } else {
+        free(batch);
+    }
+    queue_batch(reader, NULL);
+    return NULL;
+}
+
+db_reader *db_reader_start(database *db, bool threaded) {
+    db_reader *reader = checked_malloc(sizeof(db_reader));
+    reader->conf = conf;
+    reader->db = db;
+    reader->threaded = false;
+    reader->head = NULL;
+    reader->tail = NULL;
+    reader->num_queued = 0;
+    reader->done = false;
+    reader->max_queued = 0;
+    reader->current = NULL;
+    reader->pos = 0;
+    reader->num_lines = 0;
+
+    if (threaded) {
+        pthread_mutex_init(&reader->mutex, NULL);
+        pthread_cond_init(&reader->cond, NULL);
+        int err = pthread_create(&reader->thread, NULL, read_database, reader);
+        if (err == 0) {
+            reader->threaded = true;
+            log_msg(LOG_LEVEL_DEBUG, "db_reader: started reading thread for %s:%s", get_url_type_string((db->url)->type), (db->url)->value);
+            return reader;
+        }
+        log_msg(LOG_LEVEL_WARNING, "db_reader: pthread_create() failed: %s (read %s:%s without separate thread)", strerror(err), get_url_type_string((db->url)->type), (db->url)->value);
+        pthread_cond_destroy(&reader->cond);
+        pthread_mutex_destroy(&reader->mutex);
+    }
+    db_lex_buffer(db);
+    return reader;
+}
+
+static void finish_reader(db_reader *reader) {
+    database *db = reader->db;
+    if (reader->threaded) {
+        pthread_join(reader->thread, NULL);
+        pthread_cond_destroy(&reader->cond);
+        pthread_mutex_destroy(&reader->mutex);
+        log_msg(LOG_LEVEL_DEBUG, "db_reader: read %lu lines from %s:%s on separate thread (max. %lu lines queued)", reader->num_lines, get_url_type_string((db->url)->type), (db->url)->value, reader->max_queued);
+    } else {
+        db_lex_delete_buffer(db);
+    }
+    free(reader);
+}
+
+/* takes the next queued batch, waits for it if wait is true
+ * Return: true (batch taken) / false (no batch queued) */
+static bool take_batch(db_reader *reader, bool wait) {
+    pthread_mutex_lock(&reader->mutex);
+    while (wait && reader->head == NULL && !reader->done) {
+        pthread_cond_wait(&reader->cond, &reader->mutex);
+    }
+    reader->current = reader->head;
+    if (reader->head) {
+        reader->head = reader->head->next;
+        if (reader->head == NULL) {
+            reader->tail = NULL;
+        }
+        reader->num_queued -= reader->current->num_lines;
+        pthread_cond_broadcast(&reader->cond);
+    }
+    pthread_mutex_unlock(&reader->mutex);
+    reader->pos = 0;
+    return reader->current != NULL;
+}
+
+db_line *db_reader_poll(db_reader *reader) {
+    if (!reader->threaded) {
+        return NULL;
+    }
+    if (reader->current && reader->pos == reader->current->num_lines) {
+        free(reader->current);
+        reader->current = NULL;
+    }
+    if (reader->current == NULL && !take_batch(reader, false)) {
+        return NULL;
+    }
+    reader->num_lines++;
+    return reader->current->lines[reader->pos++];
+}
+
+db_line *db_reader_next(db_reader *reader) {
+    db_line *line;
+
+    if (!reader->threaded) {
+        if ((line = db_readline(reader->db)) != NULL) {
+            reader->num_lines++;
+            return line;
+        }
+        finish_reader(reader);
+        return NULL;
+    }
+
+    if (reader->current && reader->pos == reader->current->num_lines) {
+        free(reader->current);
+        reader->current = NULL;
+    }
+    if (reader->current == NULL && !take_batch(reader, true)) {
+        finish_reader(reader);
+        return NULL;
+    }
+    reader->num_lines++;
+    return reader->current->lines[reader->pos++];
+}
@@ -29,10 +29,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <search.h>
+#include <pthread.h>
 #ifdef WITH_XATTR
 #include <sys/xattr.h>
 #include <attr/attributes.h>
@@ -57,14 +60,25 @@
 #include <sys/capability.h>
 #endif
 
+#ifdef HAVE_LINUX_FSVERITY_H
+#include <sys/ioctl.h>
+#include <linux/fsverity.h>
+/* largest digest of the supported fs-verity hash algorithms (SHA-512) */
+#define FSVERITY_MAX_DIGEST_SIZE 64
+#endif
+
 
 #include "md.h"
 
 #include "hashsum.h"
 #include "db_config.h"
+#include "fs.h"
 #include "util.h"
 #include "log.h"
 #include "attributes.h"
+#include "do_md.h"
+#include "hash_cache.h"
+#include "gen_list.h"
 
 /* This define should be somewhere else */
 #define READ_BLOCK_SIZE 16777216
@@ -82,9 +96,13 @@
 */
 
 #ifdef WITH_PRELINK
+#include <sys/socket.h>
 #include <sys/wait.h>
+#include <spawn.h>
 #include <gelf.h>
 
+extern char **environ;
+
 /*
  *  Is file descriptor prelinked binary/library?
  *  Return: 1(yes) / 0(no)
@@ -97,8 +115,15 @@ int is_prelinked(int fd) {
         GElf_Ehdr ehdr;
         GElf_Shdr shdr;
         GElf_Dyn dyn;
+        unsigned char e_ident[SELFMAG];
         int bingo;
 
+        /* only hand files starting with the ELF magic over to libelf */
+        if (pread(fd, e_ident, SELFMAG, 0) != SELFMAG
+            || memcmp(e_ident, ELFMAG, SELFMAG) != 0) {
+                return 0;
+        }
+
         (void) elf_version(EV_CURRENT);
 
         if ((elf = elf_begin (fd, ELF_C_READ, NULL)) == NULL
@@ -135,38 +160,189 @@ int is_prelinked(int fd) {
 }
 
 /*
- * Open path via prelink -y, set fd
- * Return: 0 failure / > 0 success
- *
+ * Environment for prelink (without MALLOC_CHECK_), built on first use
+ * (shared by the scans of all contexts)
+ */
+static char **prelink_environ = NULL;
+static pthread_once_t prelink_environ_once = PTHREAD_ONCE_INIT;
+
+static void init_prelink_environ(void) {
+        int n = 0, i = 0;
+
+        while (environ[n]) { n++; }
+        prelink_environ = checked_malloc((n+1)*sizeof(char*));
+        for (n = 0; environ[n]; n++) {
+                if (strncmp(environ[n], "MALLOC_CHECK_=", strlen("MALLOC_CHECK_=")) != 0) {
+                        prelink_environ[i++] = environ[n];
+                }
+        }
+        prelink_environ[i] = NULL;
+}
+
+static char **get_prelink_environ(void) {
+        pthread_once(&prelink_environ_once, init_prelink_environ);
+        return prelink_environ;
+}
+
+/*
+ * prelink --verify can only verify one file per invocation, so a single
+ * long-lived helper process (a shell loop) is started on first use in a scan. It reads
+ * one path per line from its stdin, writes the original content to the
+ * temporary file prelink_helper.output and answers with a status line.
+ * AIDE itself spawns a process only once per scan, whatever the number of
+ * prelinked files.
  */
-pid_t open_prelinked(const char * path, int * fd) {
-        const char *cmd = PRELINK_PATH;
+static const char prelink_helper_script[] =
+        "while IFS= read -r f; do "
+        "if \"$0\" --verify -- \"$f\" >\"$1\" </dev/null; then echo 0; else echo 1; fi; "
+        "done";
+
+struct prelink_helper {
+        pid_t pid; /* 0 if not started */
+        int fd; /* our end of the socket pair (requests and replies) */
+        char *output; /* temporary file for the original content */
+        bool failed; /* do not try to start it again */
+};
+
+/* Return: prelink helper of the scan (allocated on first use) */
+static struct prelink_helper *get_prelink_helper(void) {
+        if (conf->scan.prelink_helper == NULL) {
+                conf->scan.prelink_helper = checked_malloc(sizeof(struct prelink_helper));
+                conf->scan.prelink_helper->pid = 0;
+                conf->scan.prelink_helper->fd = -1;
+                conf->scan.prelink_helper->output = NULL;
+                conf->scan.prelink_helper->failed = false;
+        }
+        return conf->scan.prelink_helper;
+}
+
+static bool start_prelink_helper(struct prelink_helper *helper) {
+        const char *tmpdir = getenv("TMPDIR");
+        posix_spawn_file_actions_t actions;
         pid_t pid = 0;
-        int pipes[2];
-
-        pipes[0] = pipes[1] = -1;
-        if (pipe(pipes) < 0)
-           return 0;
-        pid = fork();
-        switch (pid) {
-           case 0:
-              /* child */
-              close(pipes[0]);
-              dup2(pipes[1], STDOUT_FILENO);
-              close(pipes[1]);
-              unsetenv("MALLOC_CHECK_");
-              execl(cmd, cmd, "--verify", path, (char *) NULL);
-              exit(1);
-              break;
-           case -1:
-              close(pipes[0]);
-              close(pipes[1]);
-              return 0;
+        int sv[2];
+
+        if (tmpdir == NULL || *tmpdir == '\0') {
+                tmpdir = "/tmp";
+        }
+        int len = snprintf(NULL, 0, "%s/aide-prelink-XXXXXX", tmpdir) + 1;
+        char *output = checked_malloc(len);
+        snprintf(output, len, "%s/aide-prelink-XXXXXX", tmpdir);
+        int tmp_fd = mkostemp(output, O_CLOEXEC);
+        if (tmp_fd == -1) {
+                log_msg(LOG_LEVEL_WARNING, "prelink: creating temporary file '%s' failed: %s", output, strerror(errno));
+                free(output);
+                return false;
+        }
+        close(tmp_fd);
+
+        char * const argv[] = { "/bin/sh", "-c", (char *) prelink_helper_script, PRELINK_PATH, output, NULL };
+
+        if (socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, sv) == -1) {
+                log_msg(LOG_LEVEL_WARNING, "prelink: socketpair() failed: %s", strerror(errno));
+                unlink(output);
+                free(output);
+                return false;
+        }
+        if (posix_spawn_file_actions_init(&actions) == 0) {
+                /* dup2(2) clears FD_CLOEXEC of the helper's stdin and stdout */
+                posix_spawn_file_actions_adddup2(&actions, sv[1], STDIN_FILENO);
+                posix_spawn_file_actions_adddup2(&actions, sv[1], STDOUT_FILENO);
+                if (posix_spawn(&pid, argv[0], &actions, NULL, argv, get_prelink_environ()) != 0) {
+                        pid = 0;
+                }
+                posix_spawn_file_actions_destroy(&actions);
+        }
+        close(sv[1]);
+        if (pid == 0) {
+                log_msg(LOG_LEVEL_WARNING, "prelink: starting helper process failed");
+                close(sv[0]);
+                unlink(output);
+                free(output);
+                return false;
+        }
+        log_msg(LOG_LEVEL_DEBUG, "prelink: started helper process (pid %d, output: '%s')", pid, output);
+        helper->pid = pid;
+        helper->fd = sv[0];
+        helper->output = output;
+        return true;
+}
+
+static void stop_prelink_helper(struct prelink_helper *helper) {
+        if (helper->pid) {
+                int status;
+                /* EOF on its stdin ends the loop of the helper */
+                close(helper->fd);
+                (void) waitpid(helper->pid, &status, 0);
+                unlink(helper->output);
+                free(helper->output);
+                helper->pid = 0;
+                helper->fd = -1;
+                helper->output = NULL;
+        }
+}
+
+void close_prelink_helper(void) {
+        if (conf->scan.prelink_helper) {
+                stop_prelink_helper(conf->scan.prelink_helper);
+                free(conf->scan.prelink_helper);
+                conf->scan.prelink_helper = NULL;
         }
-        /* parent */
-        close(pipes[1]);
-        *fd = pipes[0];
-        return pid;
+}
+
+/*
+ * Open the original content of the prelinked file path (via the prelink
+ * helper process)
+ * Return: file descriptor / -1 (failure)
+ */
+int open_prelinked(const char * path) {
+        struct prelink_helper *helper = get_prelink_helper();
+        char reply[2];
+        size_t n = 0;
+
+        if (strchr(path, '\n')) {
+                log_msg(LOG_LEVEL_WARNING, "prelink: path '%s' contains a newline and cannot be passed to prelink", path);
+                return -1;
+        }
+        if (helper->pid == 0) {
+                if (helper->failed || !start_prelink_helper(helper)) {
+                        helper->failed = true;
+                        return -1;
+                }
+        }
+
+        size_t len = strlen(path);
+        char *request = checked_malloc(len+1);
+        memcpy(request, path, len);
+        request[len] = '\n';
+        bool ok = true;
+        for (size_t sent = 0 ; ok && sent < len+1 ; ) {
+                ssize_t r = TEMP_FAILURE_RETRY(send(helper->fd, request+sent, len+1-sent, MSG_NOSIGNAL));
+                if (r <= 0) {
+                        ok = false;
+                } else {
+                        sent += r;
+                }
+        }
+        free(request);
+        while (ok && n < sizeof(reply)) {
+                ssize_t r = TEMP_FAILURE_RETRY(read(helper->fd, reply+n, sizeof(reply)-n));
+                if (r <= 0) {
+                        ok = false;
+                } else {
+                        n += r;
+                }
+        }
+        if (!ok || reply[1] != '\n') {
+                log_msg(LOG_LEVEL_WARNING, "prelink: communication with helper process failed for '%s'", path);
+                stop_prelink_helper(helper);
+                helper->failed = true;
+                return -1;
+        }
+        if (reply[0] != '0') {
+                return -1;
+        }
+        return open(helper->output, O_RDONLY|O_CLOEXEC);
 }
 
 #endif
@@ -194,7 +370,805 @@ int stat_cmp(struct stat* f1,struct stat* f2) {
 
 void no_hash(db_line* line);
 
-void calc_md(struct stat* old_fs,db_line* line) {
+/*
+ * Per-chunk digests for the chunks attribute
+ *
+ * Every chunk of conf->chunk_size bytes is hashed on its own with
+ * CHUNK_HASHSUM, the last chunk may be shorter.
+ * If the digests have already been calculated (see calc_chunks_parallel())
+ * the chunk_md only passes them on to the line.
+ */
+typedef struct chunk_md {
+  struct md_container mdc;
+  long long remaining; /* bytes left in the current chunk, 0 if none started */
+  chunks_type *chunks;
+  bool calculated; /* chunks set by calc_chunks_parallel() */
+  const char *filename;
+} chunk_md;
+
+static void init_chunk_md(chunk_md *c, db_line *line, chunks_type *calculated) {
+  c->remaining = 0;
+  c->filename = line->filename;
+  c->chunks = calculated;
+  c->calculated = calculated != NULL;
+  if (calculated == NULL && line->attr&ATTR(attr_chunks)) {
+    c->chunks = checked_malloc(sizeof(chunks_type));
+    c->chunks->chunk_size = conf->chunk_size;
+    c->chunks->num = 0;
+    c->chunks->digests = NULL;
+  }
+}
+
+static void finish_chunk(chunk_md *c) {
+  int len = hashsums[CHUNK_HASHSUM].length;
+
+  close_md(&c->mdc);
+  c->chunks->digests = checked_realloc(c->chunks->digests, (c->chunks->num+1)*len);
+  memcpy(&c->chunks->digests[c->chunks->num*len], c->mdc.hashsums[CHUNK_HASHSUM], len);
+  c->chunks->num++;
+  c->remaining = 0;
+}
+
+static int update_chunk_md(chunk_md *c, byte *buf, ssize_t size) {
+  if (c->chunks == NULL || c->calculated) {
+    return RETOK;
+  }
+  while (size > 0) {
+    if (c->remaining == 0) {
+      c->mdc.todo_attr = ATTR(hashsums[CHUNK_HASHSUM].attribute);
+      if (init_md(&c->mdc, c->filename) != RETOK || c->mdc.calc_attr == 0) {
+        return RETFAIL;
+      }
+      c->remaining = c->chunks->chunk_size;
+    }
+    ssize_t n = size < c->remaining ? size : c->remaining;
+    if (update_md(&c->mdc, buf, n) != RETOK) {
+      return RETFAIL;
+    }
+    buf += n;
+    size -= n;
+    c->remaining -= n;
+    if (c->remaining == 0) {
+      finish_chunk(c);
+    }
+  }
+  return RETOK;
+}
+
+static void free_chunk_md(chunk_md *c) {
+  if (c->chunks) {
+    if (c->remaining) {
+      close_md(&c->mdc);
+    }
+    free(c->chunks->digests);
+    free(c->chunks);
+    c->chunks = NULL;
+  }
+}
+
+static void chunk_md2line(chunk_md *c, db_line *line) {
+  if (c->chunks) {
+    if (c->remaining) {
+      finish_chunk(c);
+    }
+    log_msg(LOG_LEVEL_DEBUG, " calculated %zu chunk digest(s) (chunk size: %lld) for '%s'", c->chunks->num, c->chunks->chunk_size, line->filename);
+    line->chunks = c->chunks;
+    c->chunks = NULL;
+  }
+}
+
+#ifdef WITH_AF_ALG
+/*
+ * Splice the content of fd to the kernel crypto API (see splice_md()).
+ * Chunks which are not calculated yet are spliced one after the other to
+ * an additional AF_ALG socket.
+ * Return: as splice_md()
+ */
+static int splice_file_md(struct md_container *mdc, chunk_md *c, int fd, off_t *size) {
+  if (c->chunks == NULL || c->calculated) {
+    struct md_container *mds[] = { mdc };
+    return splice_md(mds, 1, fd, NULL, -1, size);
+  }
+  struct md_container *mds[] = { mdc, &c->mdc };
+  *size = 0;
+  while (true) {
+    off_t n = 0;
+    c->mdc.todo_attr = ATTR(hashsums[CHUNK_HASHSUM].attribute);
+    if (init_md(&c->mdc, c->filename) != RETOK) {
+      return RETFAIL;
+    }
+    int ret = c->mdc.calc_attr ? splice_md(mds, 2, fd, NULL, c->chunks->chunk_size, &n) : RETFAIL;
+    *size += n;
+    if (ret != RETOK || n == 0) {
+      close_md(&c->mdc);
+      return ret;
+    }
+    finish_chunk(c);
+    if (n < c->chunks->chunk_size) {
+      return RETOK;
+    }
+  }
+}
+#endif
+
+/* size of the read buffer of each chunk thread */
+#define CHUNK_READ_BLOCK_SIZE 1048576
+
+/* shared state of the threads of calc_chunks_parallel() */
+typedef struct chunk_job {
+  db_config *conf; /* configuration of the scan (bound by each thread) */
+  int fd;
+  off_t size;
+  const char *filename;
+  chunks_type *chunks;
+
+  /* protected by mutex */
+  pthread_mutex_t mutex;
+  size_t next; /* next chunk to hash */
+  bool failed;
+} chunk_job;
+
+static int hash_chunk(chunk_job *job, size_t i, char *buf) {
+  int len = hashsums[CHUNK_HASHSUM].length;
+  struct md_container mdc;
+  off_t pos = (off_t) i * job->chunks->chunk_size;
+  off_t end = job->size - pos > job->chunks->chunk_size ? pos + job->chunks->chunk_size : job->size;
+
+  mdc.todo_attr = ATTR(hashsums[CHUNK_HASHSUM].attribute);
+  if (init_md(&mdc, job->filename) != RETOK) {
+    return RETFAIL;
+  }
+  int ret = mdc.calc_attr ? RETOK : RETFAIL;
+#ifdef WITH_AF_ALG
+  if (ret == RETOK && conf->fs->native) {
+    struct md_container *mds[] = { &mdc };
+    off_t spliced = 0;
+    /* falls back to pread(2) below if nothing has been spliced */
+    if (splice_md(mds, 1, job->fd, &pos, end - pos, &spliced) == RETOK) {
+      if (pos < end) {
+        ret = RETFAIL; /* truncated */
+      }
+    } else if (spliced) {
+      ret = RETFAIL;
+    }
+  }
+#endif
+  while (ret == RETOK && pos < end) {
+    size_t n = end - pos < CHUNK_READ_BLOCK_SIZE ? end - pos : CHUNK_READ_BLOCK_SIZE;
+    ssize_t r = TEMP_FAILURE_RETRY(conf->fs->pread(job->fd, buf, n, pos));
+    if (r <= 0 || update_md(&mdc, buf, r) != RETOK) {
+      ret = RETFAIL;
+    } else {
+      pos += r;
+    }
+  }
+  if (close_md(&mdc) != RETOK) {
+    ret = RETFAIL;
+  }
+  if (ret == RETOK) {
+    /* every thread writes the digests of its own chunks only */
+    memcpy(&job->chunks->digests[i*len], mdc.hashsums[CHUNK_HASHSUM], len);
+  }
+  return ret;
+}
+
+static void *hash_chunks(void *arg) {
+  chunk_job *job = arg;
+  char *buf = checked_malloc(CHUNK_READ_BLOCK_SIZE);
+
+  conf = job->conf;
+
+  pthread_mutex_lock(&job->mutex);
+  while (!job->failed && job->next < job->chunks->num) {
+    size_t i = job->next++;
+    pthread_mutex_unlock(&job->mutex);
+
+    int ret = hash_chunk(job, i, buf);
+
+    pthread_mutex_lock(&job->mutex);
+    if (ret != RETOK) {
+      job->failed = true;
+    }
+  }
+  pthread_mutex_unlock(&job->mutex);
+  free(buf);
+  return NULL;
+}
+
+/*
+ * Calculate the chunk digests of a file with more than one chunk on one
+ * thread per online CPU (including the calling thread). The chunks are
+ * read with pread(2), so the file offset of fd is not changed.
+ * Return: chunk digests / NULL (not worthwhile or failed, the digests are
+ * then calculated in the sequential read pass)
+ */
+static chunks_type *calc_chunks_parallel(int fd, struct stat *fs, db_line *line) {
+  int len = hashsums[CHUNK_HASHSUM].length;
+
+  if (!(line->attr&ATTR(attr_chunks))) {
+    return NULL;
+  }
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t num = (fs->st_size + conf->chunk_size - 1) / conf->chunk_size;
+  if (cpus < 2 || num < 2) {
+    return NULL;
+  }
+  size_t num_threads = (size_t) cpus < num ? (size_t) cpus : num;
+
+  chunk_job job;
+  job.conf = conf;
+  job.fd = fd;
+  job.size = fs->st_size;
+  job.filename = line->filename;
+  job.chunks = checked_malloc(sizeof(chunks_type));
+  job.chunks->chunk_size = conf->chunk_size;
+  job.chunks->num = num;
+  job.chunks->digests = checked_malloc(num*len);
+  job.next = 0;
+  job.failed = false;
+  pthread_mutex_init(&job.mutex, NULL);
+
+  pthread_t *threads = checked_malloc((num_threads-1)*sizeof(pthread_t));
+  size_t started = 0;
+  while (started < num_threads-1) {
+    int err = pthread_create(&threads[started], NULL, hash_chunks, &job);
+    if (err) {
+      log_msg(LOG_LEVEL_DEBUG, "hash calculation: pthread_create() failed for '%s': %s (hash the chunks on %zu thread(s))", line->filename, strerror(err), started+1);
+      break;
+    }
+    started++;
+  }
+  hash_chunks(&job);
+  for (size_t i = 0 ; i < started ; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+  pthread_mutex_destroy(&job.mutex);
+
+  if (job.failed) {
+    log_msg(LOG_LEVEL_WARNING, "hash calculation: parallel calculation of the chunk digests failed for '%s' (calculate them sequentially)", line->fullpath);
+    free(job.chunks->digests);
+    free(job.chunks);
+    return NULL;
+  }
+  log_msg(LOG_LEVEL_DEBUG, " calculated %zu chunk digest(s) on %zu thread(s) for '%s'", num, started+1, line->filename);
+  conf->hash_stats.parallel_chunk_files++;
+  return job.chunks;
+}
+
+#ifdef SEEK_HOLE
+/* size of the shared buffer of zeros used to hash the holes of sparse files */
+#define ZERO_BLOCK_SIZE 1048576
+
+/*
+ * Does the file have holes?
+ * Return: true (yes) / false (no or not supported by the file system)
+ */
+static bool has_holes(int fd, struct stat *fs) {
+  if (fs->st_blocks*512 >= fs->st_size) {
+    return false;
+  }
+  off_t hole = lseek(fd, 0, SEEK_HOLE);
+  return hole >= 0 && hole < fs->st_size;
+}
+
+static int update_md_zeros(struct md_container *mdc, chunk_md *cmd, off_t len) {
+  if (conf->scan.zero_buffer == NULL) {
+    conf->scan.zero_buffer = checked_malloc(ZERO_BLOCK_SIZE);
+    memset(conf->scan.zero_buffer, 0, ZERO_BLOCK_SIZE);
+  }
+  while (len > 0) {
+    ssize_t n = len < ZERO_BLOCK_SIZE ? len : ZERO_BLOCK_SIZE;
+    if (update_md(mdc, conf->scan.zero_buffer, n) != RETOK || update_chunk_md(cmd, conf->scan.zero_buffer, n) != RETOK) {
+      return RETFAIL;
+    }
+    len -= n;
+  }
+  return RETOK;
+}
+
+/*
+ * Hash the first size bytes of a sparse file. Only the data extents are
+ * read, holes are hashed from the zero buffer (resulting in the same
+ * digests).
+ * data_size is set to the number of bytes read.
+ */
+static int update_md_sparse(struct md_container *mdc, chunk_md *cmd, int fd, off_t size, off_t *data_size) {
+  char *buf = checked_malloc(READ_BLOCK_SIZE);
+  off_t pos = 0;
+  int ret = RETOK;
+
+  *data_size = 0;
+  while (ret == RETOK && pos < size) {
+    off_t data = lseek(fd, pos, SEEK_DATA);
+    if (data == -1) {
+      if (errno != ENXIO) {
+        ret = RETFAIL;
+        break;
+      }
+      data = size; /* trailing hole */
+    }
+    if (data > size) {
+      data = size;
+    }
+    if (update_md_zeros(mdc, cmd, data - pos) != RETOK) {
+      ret = RETFAIL;
+      break;
+    }
+    pos = data;
+    if (pos == size) {
+      break;
+    }
+    off_t hole = lseek(fd, pos, SEEK_HOLE);
+    if (hole == -1) {
+      ret = RETFAIL;
+      break;
+    }
+    if (hole > size) {
+      hole = size;
+    }
+    while (pos < hole) {
+      size_t len = hole - pos < READ_BLOCK_SIZE ? hole - pos : READ_BLOCK_SIZE;
+      ssize_t n = TEMP_FAILURE_RETRY(pread(fd, buf, len, pos));
+      if (n <= 0 || update_md(mdc, buf, n) != RETOK || update_chunk_md(cmd, (byte*)buf, n) != RETOK) {
+        ret = RETFAIL;
+        break;
+      }
+      pos += n;
+      *data_size += n;
+    }
+  }
+  free(buf);
+  return ret;
+}
+#endif
+
+/*
+ * Calculate the chunk digests of a growing file from its old database
+ * entry: the digests of the chunks completed before the old size are
+ * reused, the old last (partial) chunk is read again and verified
+ * against its old digest and only the data behind it is hashed.
+ * read_bytes is set to the number of bytes read.
+ * Return: true (chunks set) / false (full calculation needed)
+ */
+static bool calc_chunks_incremental(int fd, struct stat *fs, db_line *line, off_t *read_bytes) {
+  int len = hashsums[CHUNK_HASHSUM].length;
+  struct md_container verify_md;
+  chunk_md cmd;
+
+  if (!conf->incremental_growing_files || !(line->attr&ATTR(attr_sizeg))
+      || !(line->attr&ATTR(attr_chunks)) || line->attr&get_hashes(true)) {
+    return false;
+  }
+  db_line *old = get_old_entry(line->filename);
+  if (old == NULL || old->chunks == NULL || !(old->attr&ATTR(attr_chunks))
+      || !(old->attr&(ATTR(attr_size)|ATTR(attr_sizeg))) || old->size > fs->st_size
+      || !(old->attr&ATTR(attr_inode)) || old->inode != (long) fs->st_ino
+      || old->chunks->chunk_size != conf->chunk_size
+      || old->chunks->num != (size_t) ((old->size + conf->chunk_size - 1) / conf->chunk_size)) {
+    return false;
+  }
+
+  size_t complete = old->size / conf->chunk_size;
+  off_t pos = complete * conf->chunk_size;
+  bool verify = pos < old->size;
+
+  verify_md.todo_attr = ATTR(hashsums[CHUNK_HASHSUM].attribute);
+  if (verify && (init_md(&verify_md, line->filename) != RETOK || verify_md.calc_attr == 0)) {
+    return false;
+  }
+  log_msg(LOG_LEVEL_DEBUG, " reuse %zu chunk digest(s) of growing file '%s'", complete, line->filename);
+  init_chunk_md(&cmd, line, NULL);
+  cmd.chunks->num = complete;
+  cmd.chunks->digests = checked_malloc(complete*len);
+  memcpy(cmd.chunks->digests, old->chunks->digests, complete*len);
+
+  char *buf = checked_malloc(READ_BLOCK_SIZE);
+  bool ok = true;
+  *read_bytes = 0;
+  while (ok && pos < fs->st_size) {
+    /* stop at the old size to verify the old last chunk */
+    off_t end = verify ? old->size : fs->st_size;
+    size_t n = end - pos < READ_BLOCK_SIZE ? end - pos : READ_BLOCK_SIZE;
+    ssize_t r = TEMP_FAILURE_RETRY(conf->fs->pread(fd, buf, n, pos));
+    if (r <= 0 || update_chunk_md(&cmd, (byte*)buf, r) != RETOK
+        || (verify && update_md(&verify_md, buf, r) != RETOK)) {
+      ok = false;
+      break;
+    }
+    pos += r;
+    *read_bytes += r;
+    if (verify && pos == old->size) {
+      close_md(&verify_md);
+      verify = false;
+      if (memcmp(verify_md.hashsums[CHUNK_HASHSUM], &old->chunks->digests[complete*len], len)) {
+        log_msg(LOG_LEVEL_DEBUG, " old content of growing file '%s' has changed, calculate all chunk digests", line->filename);
+        ok = false;
+      }
+    }
+  }
+  if (verify) {
+    close_md(&verify_md);
+  }
+  free(buf);
+  if (!ok) {
+    free_chunk_md(&cmd);
+    return false;
+  }
+  chunk_md2line(&cmd, line);
+  return true;
+}
+
+/*
+ * Hashsums of files with more than one hard link, so that every
+ * further link of the same inode is not read again.
+ */
+typedef struct hardlink_node {
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  long mtime_nsec;
+  time_t ctime;
+  long ctime_nsec;
+  DB_ATTR_TYPE attr;
+  byte* hashsums[num_hashes];
+  chunks_type* chunks;
+} hardlink_node;
+
+static int cmp_hardlink_node(const void *n1, const void *n2) {
+  const hardlink_node *h1 = n1;
+  const hardlink_node *h2 = n2;
+
+  if (h1->dev != h2->dev) {
+    return h1->dev < h2->dev ? -1 : 1;
+  }
+  if (h1->ino != h2->ino) {
+    return h1->ino < h2->ino ? -1 : 1;
+  }
+  return 0;
+}
+
+static chunks_type *copy_chunks(chunks_type *chunks) {
+  chunks_type *copy = NULL;
+  if (chunks) {
+    size_t len = chunks->num*hashsums[CHUNK_HASHSUM].length;
+    copy = checked_malloc(sizeof(chunks_type));
+    copy->chunk_size = chunks->chunk_size;
+    copy->num = chunks->num;
+    copy->digests = NULL;
+    if (len) {
+      copy->digests = checked_malloc(len);
+      memcpy(copy->digests, chunks->digests, len);
+    }
+  }
+  return copy;
+}
+
+static bool reuse_hardlink_hashsums(struct stat *fs, db_line *line) {
+  hardlink_node key, **node;
+
+  if (fs->st_nlink < 2) {
+    return false;
+  }
+  key.dev = fs->st_dev;
+  key.ino = fs->st_ino;
+  node = tfind(&key, &conf->scan.hardlinks, cmp_hardlink_node);
+  if (node == NULL || (*node)->size != fs->st_size
+      || (*node)->mtime != fs->st_mtime || (*node)->mtime_nsec != (long) get_mtime_nsec(fs)
+      || (*node)->ctime != fs->st_ctime || (*node)->ctime_nsec != (long) get_ctime_nsec(fs)) {
+    return false;
+  }
+  DB_ATTR_TYPE requested = line->attr&(get_hashes(false)|ATTR(attr_chunks));
+  if ((requested&(*node)->attr) != requested) {
+    log_msg(LOG_LEVEL_DEBUG, " hashsums of hard link target (dev: %llu, inode: %llu) lack requested hashsums for '%s'", (unsigned long long) key.dev, (unsigned long long) key.ino, line->filename);
+    return false;
+  }
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    DB_ATTR_TYPE attr = ATTR(hashsums[i].attribute);
+    if (requested&attr) {
+      line->hashsums[i] = checked_malloc(hashsums[i].length);
+      memcpy(line->hashsums[i], (*node)->hashsums[i], hashsums[i].length);
+    } else if (line->attr&attr) {
+      /* unsupported hashsum */
+      line->attr&=~attr;
+    }
+  }
+  if (requested&ATTR(attr_chunks)) {
+    line->chunks = copy_chunks((*node)->chunks);
+  }
+  conf->hash_stats.hardlinks++;
+  conf->hash_stats.hardlink_bytes += fs->st_size;
+  log_msg(LOG_LEVEL_DEBUG, " reuse hashsums of hard link target (dev: %llu, inode: %llu) for '%s'", (unsigned long long) key.dev, (unsigned long long) key.ino, line->filename);
+  return true;
+}
+
+static void free_hardlink_node(void *n) {
+  hardlink_node *node = n;
+
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    free(node->hashsums[i]);
+  }
+  if (node->chunks) {
+    free(node->chunks->digests);
+    free(node->chunks);
+  }
+  free(node);
+}
+
+void free_hardlink_hashsums(void) {
+  tdestroy(conf->scan.hardlinks, free_hardlink_node);
+  conf->scan.hardlinks = NULL;
+}
+
+static void add_hardlink_hashsums(struct stat *fs, db_line *line) {
+  hardlink_node *new, **node;
+
+  if (fs->st_nlink < 2) {
+    return;
+  }
+  new = checked_malloc(sizeof(hardlink_node));
+  new->dev = fs->st_dev;
+  new->ino = fs->st_ino;
+  node = tsearch(new, &conf->scan.hardlinks, cmp_hardlink_node);
+  if (*node != new) {
+    /* replace outdated or less complete hashsums */
+    free(new);
+    new = *node;
+    for (int i = 0 ; i < num_hashes ; ++i) {
+      free(new->hashsums[i]);
+    }
+    if (new->chunks) {
+      free(new->chunks->digests);
+      free(new->chunks);
+    }
+  }
+  new->size = fs->st_size;
+  new->mtime = fs->st_mtime;
+  new->mtime_nsec = get_mtime_nsec(fs);
+  new->ctime = fs->st_ctime;
+  new->ctime_nsec = get_ctime_nsec(fs);
+  new->attr = 0LLU;
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    new->hashsums[i] = NULL;
+    if (line->attr&ATTR(hashsums[i].attribute) && line->hashsums[i]) {
+      new->hashsums[i] = checked_malloc(hashsums[i].length);
+      memcpy(new->hashsums[i], line->hashsums[i], hashsums[i].length);
+      new->attr |= ATTR(hashsums[i].attribute);
+    }
+  }
+  new->chunks = NULL;
+  if (line->attr&ATTR(attr_chunks) && line->chunks) {
+    new->chunks = copy_chunks(line->chunks);
+    new->attr |= ATTR(attr_chunks);
+  }
+}
+
+/*
+ * Get the fs-verity file digest of fd (O(1), the kernel keeps a Merkle
+ * tree of the file content and verifies all reads against it)
+ * Return: true (fs-verity enabled) / false (not enabled or not supported)
+ */
+static bool fsverity2line(int fd, db_line *line) {
+#ifdef HAVE_LINUX_FSVERITY_H
+  struct fsverity_digest *d = checked_malloc(sizeof(struct fsverity_digest) + FSVERITY_MAX_DIGEST_SIZE);
+
+  d->digest_size = FSVERITY_MAX_DIGEST_SIZE;
+  if (ioctl(fd, FS_IOC_MEASURE_VERITY, d) == -1) {
+    log_msg(LOG_LEVEL_DEBUG, " no fs-verity digest for '%s': %s", line->filename, strerror(errno));
+    free(d);
+    return false;
+  }
+  line->fsverity = checked_malloc(sizeof(fsverity_type));
+  line->fsverity->algorithm = d->digest_algorithm;
+  line->fsverity->length = d->digest_size;
+  line->fsverity->digest = checked_malloc(d->digest_size);
+  memcpy(line->fsverity->digest, d->digest, d->digest_size);
+  free(d);
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*
+ * Rolling re-hash: in every run the hashsums of the least recently
+ * verified 1/conf->rolling_rehash of the old entries are calculated,
+ * the hashsums of all other files with unchanged metadata are taken
+ * from the old entries. Entries verified at the same time are ordered
+ * by the hash of their path.
+ */
+typedef struct rehash_key {
+  time_t verified;
+  unsigned long path_hash;
+} rehash_key;
+
+static unsigned long get_path_hash(const char *path) {
+  unsigned long hash = 5381;
+  for (const char *c = path ; *c ; ++c) {
+    hash = hash * 33 ^ (unsigned char) *c;
+  }
+  return hash;
+}
+
+static int cmp_rehash_key(const void *k1, const void *k2) {
+  const rehash_key *a = k1;
+  const rehash_key *b = k2;
+  if (a->verified != b->verified) {
+    return a->verified < b->verified ? -1 : 1;
+  }
+  if (a->path_hash != b->path_hash) {
+    return a->path_hash < b->path_hash ? -1 : 1;
+  }
+  return 0;
+}
+
+void init_rolling_rehash(list *old_entries) {
+  size_t num = 0;
+  list *l;
+
+  free(conf->scan.rehash_threshold);
+  conf->scan.rehash_threshold = NULL;
+  for (l = old_entries ; l ; l = l->next) {
+    if (((db_line*)l->data)->attr&ATTR(attr_verified)) {
+      num++;
+    }
+  }
+  if (num == 0) {
+    log_msg(LOG_LEVEL_INFO, "rolling re-hash: no verified entries in database_in, calculate all hashsums");
+    return;
+  }
+  rehash_key *keys = checked_malloc(num*sizeof(rehash_key));
+  num = 0;
+  for (l = old_entries ; l ; l = l->next) {
+    db_line *old = l->data;
+    if (old->attr&ATTR(attr_verified)) {
+      keys[num].verified = old->verified;
+      keys[num].path_hash = get_path_hash(old->filename);
+      num++;
+    }
+  }
+  qsort(keys, num, sizeof(rehash_key), cmp_rehash_key);
+  size_t slice = (num + conf->rolling_rehash - 1) / conf->rolling_rehash;
+  conf->scan.rehash_threshold = checked_malloc(sizeof(rehash_key));
+  *conf->scan.rehash_threshold = keys[slice - 1];
+  free(keys);
+  log_msg(LOG_LEVEL_INFO, "rolling re-hash: re-hash the %zu least recently verified of %zu entries", slice, num);
+}
+
+/*
+ * Reuse the hashsums of the old entry if the file is not part of the
+ * current slice and its metadata is unchanged
+ * Return: true (hashsums set) / false (hashsums need to be calculated)
+ */
+static bool reuse_rolling_hashsums(struct stat *fs, db_line *line) {
+  const DB_ATTR_TYPE metadata = ATTR(attr_size)|ATTR(attr_mtime)|ATTR(attr_ctime)|ATTR(attr_inode)|ATTR(attr_verified);
+  DB_ATTR_TYPE requested = line->attr&get_hashes(false);
+
+  if (!conf->rolling_rehash || conf->scan.rehash_threshold == NULL) {
+    return false;
+  }
+  db_line *old = get_old_entry(line->filename);
+  if (old == NULL || (old->attr&metadata) != metadata || (old->attr&requested) != requested
+      || old->size != fs->st_size || old->mtime != fs->st_mtime
+      || old->ctime != fs->st_ctime || old->inode != (long) fs->st_ino) {
+    return false;
+  }
+  rehash_key key = { old->verified, get_path_hash(line->filename) };
+  if (cmp_rehash_key(&key, conf->scan.rehash_threshold) <= 0) {
+    log_msg(LOG_LEVEL_DEBUG, " rolling re-hash: '%s' is part of the current slice", line->filename);
+    conf->hash_stats.rolling_rehashed++;
+    return false;
+  }
+  if (line->attr&ATTR(attr_chunks) && (old->chunks == NULL || !(old->attr&ATTR(attr_chunks))
+              || old->chunks->chunk_size != conf->chunk_size)) {
+    return false;
+  }
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    if (requested&ATTR(hashsums[i].attribute) && old->hashsums[i] == NULL) {
+      return false;
+    }
+  }
+
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    DB_ATTR_TYPE attr = ATTR(hashsums[i].attribute);
+    if (requested&attr) {
+      line->hashsums[i] = checked_malloc(hashsums[i].length);
+      memcpy(line->hashsums[i], old->hashsums[i], hashsums[i].length);
+    } else if (line->attr&attr) {
+      /* unsupported hashsum */
+      line->attr&=~attr;
+    }
+  }
+  if (line->attr&ATTR(attr_chunks)) {
+    line->chunks = copy_chunks(old->chunks);
+  }
+  line->verified = old->verified;
+  conf->hash_stats.rolling_reused++;
+  log_msg(LOG_LEVEL_DEBUG, " rolling re-hash: use hashsums of old entry for '%s'", line->filename);
+  return true;
+}
+
+/*
+ * Reuse the hashsums of the old entry if the fs-verity digest of the file
+ * is unchanged
+ * Return: true (hashsums set) / false (hashsums need to be calculated)
+ */
+static bool reuse_fsverity_hashsums(db_line *line) {
+  DB_ATTR_TYPE requested = line->attr&(get_hashes(false)|ATTR(attr_chunks));
+
+  db_line *old = get_old_entry(line->filename);
+  if (old == NULL || !(old->attr&ATTR(attr_fsverity)) || (old->attr&requested) != requested
+      || old->fsverity == NULL || old->fsverity->algorithm != line->fsverity->algorithm
+      || old->fsverity->length != line->fsverity->length
+      || memcmp(old->fsverity->digest, line->fsverity->digest, line->fsverity->length)) {
+    return false;
+  }
+  if (line->attr&ATTR(attr_chunks) && (old->chunks == NULL || old->chunks->chunk_size != conf->chunk_size)) {
+    return false;
+  }
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    if (requested&ATTR(hashsums[i].attribute) && old->hashsums[i] == NULL) {
+      return false;
+    }
+  }
+
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    DB_ATTR_TYPE attr = ATTR(hashsums[i].attribute);
+    if (requested&attr) {
+      line->hashsums[i] = checked_malloc(hashsums[i].length);
+      memcpy(line->hashsums[i], old->hashsums[i], hashsums[i].length);
+    } else if (line->attr&attr) {
+      /* unsupported hashsum */
+      line->attr&=~attr;
+    }
+  }
+  if (line->attr&ATTR(attr_chunks)) {
+    line->chunks = copy_chunks(old->chunks);
+  }
+  log_msg(LOG_LEVEL_DEBUG, " fs-verity digest unchanged, use hashsums of old entry for '%s'", line->filename);
+  return true;
+}
+
+void log_hash_stats(LOG_LEVEL log_level) {
+  log_msg(log_level, "hash calculation: read %lld byte(s) of %lu file(s), reused hashsums for %lu hard link(s) (%lld byte(s) saved)",
+          conf->hash_stats.bytes, conf->hash_stats.files,
+          conf->hash_stats.hardlinks, conf->hash_stats.hardlink_bytes);
+  if (conf->hash_stats.hole_bytes) {
+    log_msg(log_level, "hash calculation: skipped %lld byte(s) of holes in %lu sparse file(s)",
+            conf->hash_stats.hole_bytes, conf->hash_stats.sparse_files);
+  }
+  if (conf->hash_stats.incremental) {
+    log_msg(log_level, "hash calculation: reused chunk digests for %lu growing file(s) (%lld byte(s) saved)",
+            conf->hash_stats.incremental, conf->hash_stats.incremental_bytes);
+  }
+  if (conf->hash_stats.parallel_chunk_files) {
+    log_msg(log_level, "hash calculation: calculated the chunk digests of %lu file(s) in parallel",
+            conf->hash_stats.parallel_chunk_files);
+  }
+  if (conf->rolling_rehash && conf->scan.rehash_threshold) {
+    char since[32];
+    struct tm tm;
+    strftime(since, sizeof(since), "%Y-%m-%d %H:%M:%S %z", localtime_r(&conf->scan.rehash_threshold->verified, &tm));
+    log_msg(log_level, "rolling re-hash: re-hashed %lu unchanged file(s) of the current slice (1/%lu), reused hashsums of %lu unchanged file(s) verified after %s",
+            conf->hash_stats.rolling_rehashed, conf->rolling_rehash, conf->hash_stats.rolling_reused, since);
+  }
+  if (conf->hash_stats.fsverity) {
+    log_msg(log_level, "hash calculation: used fs-verity digests for %lu file(s) (%lld byte(s) saved)",
+            conf->hash_stats.fsverity, conf->hash_stats.fsverity_bytes);
+  }
+  if (conf->hash_stats.primary_verified || conf->hash_stats.primary_mismatch) {
+    log_msg(log_level, "hash calculation: verified primary hashsum of %lu file(s), calculated secondary hashsums of %lu file(s) after a mismatch",
+            conf->hash_stats.primary_verified, conf->hash_stats.primary_mismatch);
+  }
+#ifdef WITH_AF_ALG
+  if (conf->kernel_crypto) {
+    log_msg(log_level, "hash calculation: spliced %lld byte(s) to the kernel crypto API", conf->hash_stats.spliced_bytes);
+  }
+#endif
+}
+
+static void calc_file_md(struct stat* old_fs,db_line* line) {
   /*
     We stat after opening just to make sure that the file
     from we are about to calculate the hash is the correct one,
@@ -204,7 +1178,7 @@ void calc_md(struct stat* old_fs,db_line* line) {
   int sres=0;
   int stat_diff,filedes;
 #ifdef WITH_PRELINK
-  pid_t pid;
+  bool prelinked;
 #endif
 
 #ifdef _PARAMETER_CHECK_
@@ -214,10 +1188,10 @@ void calc_md(struct stat* old_fs,db_line* line) {
 #endif  
 
 #ifdef HAVE_O_NOATIME
-  filedes=open(line->fullpath,O_RDONLY|O_NOATIME);
+  filedes=conf->fs->open(line->fullpath,O_RDONLY|O_NOATIME);
   if(filedes<0)
 #endif
-    filedes=open(line->fullpath,O_RDONLY);
+    filedes=conf->fs->open(line->fullpath,O_RDONLY);
 
   if (filedes==-1) {
     char* er=strerror(errno);
@@ -235,7 +1209,7 @@ void calc_md(struct stat* old_fs,db_line* line) {
     return;
   }
   
-  sres=fstat(filedes,&fs);
+  sres=conf->fs->fstat(filedes,&fs);
   if (sres != 0) {
       log_msg(LOG_LEVEL_WARNING, "hash calculation: fstat() failed for '%s': %s", line->fullpath, strerror(errno));
   }
@@ -243,7 +1217,7 @@ void calc_md(struct stat* old_fs,db_line* line) {
 	  fs.st_rdev=0;
   
 #ifdef HAVE_POSIX_FADVISE
-  if (posix_fadvise(filedes,0,fs.st_size,POSIX_FADV_NOREUSE)!=0) {
+  if (conf->fs->native && posix_fadvise(filedes,0,fs.st_size,POSIX_FADV_NOREUSE)!=0) {
     log_msg(LOG_LEVEL_DEBUG, "hash calculation: posix_fadvise error for '%s': %s", line->fullpath, strerror(errno));
   }
 #endif
@@ -252,34 +1226,166 @@ void calc_md(struct stat* old_fs,db_line* line) {
       Now we have a 'valid' filehandle to read from a file.
      */
 
+    if (line->attr&ATTR(attr_fsverity)) {
+      if (conf->fs->native && fsverity2line(filedes, line)) {
+        if (!(line->attr&(get_hashes(true)|ATTR(attr_chunks))) || reuse_fsverity_hashsums(line)) {
+          conf->hash_stats.fsverity++;
+          conf->hash_stats.fsverity_bytes+=fs.st_size;
+          conf->fs->close(filedes);
+          return;
+        }
+        /* the other hashsums of the rule are calculated as usual */
+      } else {
+        line->attr&=~ATTR(attr_fsverity);
+        if (!(line->attr&(get_hashes(true)|ATTR(attr_chunks)))) {
+          /* a bare fsverity rule must not leave the file without any hashsum */
+          log_msg(LOG_LEVEL_DEBUG, "hash calculation: fs-verity not enabled for '%s', calculate %s instead", line->fullpath, attributes[hashsums[CHUNK_HASHSUM].attribute].config_name);
+          line->attr|=ATTR(hashsums[CHUNK_HASHSUM].attribute);
+        }
+      }
+    }
+
+    if (reuse_rolling_hashsums(&fs, line)) {
+      conf->fs->close(filedes);
+      return;
+    }
+
+    if (reuse_hardlink_hashsums(&fs, line)) {
+      conf->fs->close(filedes);
+      return;
+    }
+
+#ifdef HAVE_MMAP
+    /* rolling re-hash needs hashsums calculated in this run */
+    if (!conf->rolling_rehash && hash_cache_lookup(conf->scan.hash_cache, &fs, line)) {
+      add_hardlink_hashsums(&fs, line);
+      conf->fs->close(filedes);
+      return;
+    }
+#endif
+
+    off_t inc_size=0;
+    if (calc_chunks_incremental(filedes, &fs, line, &inc_size)) {
+      add_hardlink_hashsums(&fs, line);
+      conf->hash_stats.files++;
+      conf->hash_stats.bytes+=inc_size;
+      conf->hash_stats.incremental++;
+      conf->hash_stats.incremental_bytes+=fs.st_size-inc_size;
+      conf->fs->close(filedes);
+      return;
+    }
+
 #ifdef WITH_PRELINK
     /*
      * Let's take care of prelinked libraries/binaries 	
      */
-    pid=0;
-    if ( is_prelinked(filedes) ) {
+    prelinked=false;
+    if (conf->fs->native && is_prelinked(filedes)) {
       close(filedes);
-      pid = open_prelinked(line->fullpath, &filedes);
-      if (pid == 0) {
-        log_msg(LOG_LEVEL_WARNING, "hash calculation: error on starting prelink for '%s'", line->fullpath);
+      /* the original content, its size differs from fs.st_size */
+      filedes = open_prelinked(line->fullpath);
+      if (filedes == -1) {
+        log_msg(LOG_LEVEL_WARNING, "hash calculation: prelink --verify failed for '%s'", line->fullpath);
 	return;
       }
+      prelinked=true;
     }
 #endif
 
+    chunks_type *chunks=NULL;
+    if (
+#ifdef WITH_PRELINK
+        !prelinked &&
+#endif
+        conf->fs->native) {
+      chunks = calc_chunks_parallel(filedes, &fs, line);
+      if (chunks && !(line->attr&get_hashes(true))) {
+        line->chunks = chunks;
+#ifdef HAVE_MMAP
+        hash_cache_store(conf->scan.hash_cache, &fs,line);
+#endif
+        add_hardlink_hashsums(&fs,line);
+        conf->hash_stats.files++;
+        conf->hash_stats.bytes+=fs.st_size;
+        conf->fs->close(filedes);
+        return;
+      }
+    }
+
     off_t r_size=0;
     off_t size=0;
     char* buf;
 
     struct md_container mdc;
+    chunk_md cmd;
     
     mdc.todo_attr=line->attr;
     
     if (init_md(&mdc, line->filename)==RETOK) {
         log_msg(LOG_LEVEL_DEBUG," calculate hashes for '%s'", line->filename);
+        init_chunk_md(&cmd, line, chunks);
+#ifdef SEEK_HOLE
+      if (
+#ifdef WITH_PRELINK
+          !prelinked &&
+#endif
+          conf->fs->native && has_holes(filedes, &fs)) {
+        if (update_md_sparse(&mdc, &cmd, filedes, fs.st_size, &r_size) != RETOK) {
+          log_msg(LOG_LEVEL_WARNING, "hash calculation: reading sparse file '%s' failed: %s", line->fullpath, strerror(errno));
+          conf->fs->close(filedes);
+          close_md(&mdc);
+          free_chunk_md(&cmd);
+          return;
+        }
+        close_md(&mdc);
+        md2line(&mdc,line);
+        chunk_md2line(&cmd,line);
+#ifdef HAVE_MMAP
+        hash_cache_store(conf->scan.hash_cache, &fs,line);
+#endif
+        add_hardlink_hashsums(&fs,line);
+        conf->hash_stats.files++;
+        conf->hash_stats.bytes+=r_size;
+        conf->hash_stats.sparse_files++;
+        conf->hash_stats.hole_bytes+=fs.st_size-r_size;
+        conf->fs->close(filedes);
+        return;
+      }
+#endif
+#ifdef WITH_AF_ALG
+      if (conf->fs->native
+#ifdef WITH_PRELINK
+              && !prelinked
+#endif
+         ) {
+        /* fails without reading if not all hashsums are calculated by the kernel */
+        if (splice_file_md(&mdc, &cmd, filedes, &r_size) == RETOK) {
+          close_md(&mdc);
+          md2line(&mdc,line);
+          chunk_md2line(&cmd,line);
+#ifdef HAVE_MMAP
+          hash_cache_store(conf->scan.hash_cache, &fs,line);
+#endif
+          add_hardlink_hashsums(&fs,line);
+          conf->hash_stats.files++;
+          conf->hash_stats.bytes+=r_size;
+          conf->hash_stats.spliced_bytes+=r_size;
+          conf->fs->close(filedes);
+          return;
+        } else if (r_size) {
+          log_msg(LOG_LEVEL_WARNING, "hash calculation: splice_md() failed for '%s'", line->fullpath);
+          conf->fs->close(filedes);
+          close_md(&mdc);
+          free_chunk_md(&cmd);
+          return;
+        }
+      }
+#endif
 #ifdef HAVE_MMAP
 #ifdef WITH_PRELINK
-      if (pid == 0) {
+      if (!prelinked && conf->fs->native) {
+#else
+      if (conf->fs->native) {
 #endif
         off_t curpos=0;
 
@@ -307,15 +1413,17 @@ void calc_md(struct stat* old_fs,db_line* line) {
 	 }
 	 if ( buf == MAP_FAILED ) {
 	   log_msg(LOG_LEVEL_WARNING, "hash calculation: error mmap'ing '%s': %s", line->fullpath, strerror(errno));
-	   close(filedes);
+	   conf->fs->close(filedes);
 	   close_md(&mdc);
+	   free_chunk_md(&cmd);
 	   return;
 	 }
 	 conf->catch_mmap=1;
-	 if (update_md(&mdc,buf,size)!=RETOK) {
+	 if (update_md(&mdc,buf,size)!=RETOK || update_chunk_md(&cmd,(byte*)buf,size)!=RETOK) {
 	   log_msg(LOG_LEVEL_WARNING, "hash calculation: update_md() failed for '%s'", line->fullpath);
-	   close(filedes);
+	   conf->fs->close(filedes);
 	   close_md(&mdc);
+	   free_chunk_md(&cmd);
 	   munmap(buf,size);
 	   return;
 	 }
@@ -325,46 +1433,49 @@ void calc_md(struct stat* old_fs,db_line* line) {
 	/* we have used MMAP, let's return */
         close_md(&mdc);
         md2line(&mdc,line);
-        close(filedes);
+        chunk_md2line(&cmd,line);
+        hash_cache_store(conf->scan.hash_cache, &fs,line);
+        add_hardlink_hashsums(&fs,line);
+        conf->hash_stats.files++;
+        conf->hash_stats.bytes+=fs.st_size;
+        conf->fs->close(filedes);
         return;
-#ifdef WITH_PRELINK
       }
-#endif
 #endif /* not HAVE_MMAP */
       buf=checked_malloc(READ_BLOCK_SIZE);
 #if READ_BLOCK_SIZE>SSIZE_MAX
 #error "READ_BLOCK_SIZE" is too large. Max value is SSIZE_MAX, and current is READ_BLOCK_SIZE
 #endif
-      while ((size=TEMP_FAILURE_RETRY(read(filedes,buf,READ_BLOCK_SIZE)))>0) {
-	if (update_md(&mdc,buf,size)!=RETOK) {
+      while ((size=TEMP_FAILURE_RETRY(conf->fs->read(filedes,buf,READ_BLOCK_SIZE)))>0) {
+	if (update_md(&mdc,buf,size)!=RETOK || update_chunk_md(&cmd,(byte*)buf,size)!=RETOK) {
 	   log_msg(LOG_LEVEL_WARNING, "hash calculation: update_md() failed for '%s'", line->fullpath);
-	  close(filedes);
+	  conf->fs->close(filedes);
 	  close_md(&mdc);
+	  free_chunk_md(&cmd);
 	  return;
 	}
 	r_size+=size;
       }
 
-#ifdef WITH_PRELINK
-      if (pid) {
-        int status;
-        (void) waitpid(pid, &status, 0);
-        if (!WIFEXITED(status) || WEXITSTATUS(status)) {
-	     log_msg(LOG_LEVEL_WARNING, "hash calculation: error on exit of prelink child process for '%s'", line->fullpath);
-	  close(filedes);
-	  close_md(&mdc);
-          return;
-        }
-      }
-#endif
       free(buf);
       close_md(&mdc);
       md2line(&mdc,line);
+      chunk_md2line(&cmd,line);
+#ifdef HAVE_MMAP
+      hash_cache_store(conf->scan.hash_cache, &fs,line);
+#endif
+      add_hardlink_hashsums(&fs,line);
+      conf->hash_stats.files++;
+      conf->hash_stats.bytes+=r_size;
 
     } else {
 	  log_msg(LOG_LEVEL_WARNING, "hash calculation: init_md() failed for '%s'", line->fullpath);
+      if (chunks) {
+        free(chunks->digests);
+        free(chunks);
+      }
       no_hash(line);
-      close(filedes);
+      conf->fs->close(filedes);
       return;
     }
   } else {
@@ -382,13 +1493,92 @@ void calc_md(struct stat* old_fs,db_line* line) {
     log_msg(LOG_LEVEL_WARNING, "hash calculation: '%s' has been changed (changed attributes: %s), hash could not be calculated", line->fullpath, str = diff_attributes(0, changed_attribures));
     free(str);
     no_hash(line);
-    close(filedes);
+    conf->fs->close(filedes);
     return;
   }
-  close(filedes);
+  conf->fs->close(filedes);
   return;
 }
 
+/*
+ * Get the old entry to verify the primary hashsum against
+ * Return: the old entry (only the primary hashsum needs to be calculated) / NULL
+ */
+static db_line *get_primary_hashsum_entry(db_line *line, DB_ATTR_TYPE secondary, int *primary) {
+  if (!conf->primary_hashsum || conf->action&DO_INIT || !(conf->action&DO_COMPARE)
+          || !(line->attr&conf->primary_hashsum) || !secondary
+          || line->attr&(ATTR(attr_chunks)|ATTR(attr_fsverity))) {
+    return NULL;
+  }
+  db_line *old = get_old_entry(line->filename);
+  if (old == NULL || (old->attr&(secondary|conf->primary_hashsum)) != (secondary|conf->primary_hashsum)) {
+    return NULL;
+  }
+  for (int i = 0 ; i < num_hashes ; ++i) {
+    DB_ATTR_TYPE attr = ATTR(hashsums[i].attribute);
+    if ((secondary|conf->primary_hashsum)&attr && old->hashsums[i] == NULL) {
+      return NULL;
+    }
+    if (attr == conf->primary_hashsum) {
+      *primary = i;
+    }
+  }
+  return old;
+}
+
+/*
+ * During --check only the primary hashsum is calculated, the secondary
+ * hashsums are taken from the old entry if it matches and are calculated
+ * in a second pass otherwise
+ */
+void calc_md(struct stat* old_fs,db_line* line) {
+  DB_ATTR_TYPE secondary = line->attr&get_hashes(false)&~conf->primary_hashsum;
+  int primary = -1;
+
+  db_line *old = get_primary_hashsum_entry(line, secondary, &primary);
+  if (old == NULL) {
+    calc_file_md(old_fs, line);
+    return;
+  }
+
+  line->attr&=~secondary;
+  calc_file_md(old_fs, line);
+  if (!(line->attr&conf->primary_hashsum) || line->hashsums[primary] == NULL) {
+    /* hashsum calculation failed */
+    return;
+  }
+
+  if (memcmp(line->hashsums[primary], old->hashsums[primary], hashsums[primary].length) == 0) {
+    for (int i = 0 ; i < num_hashes ; ++i) {
+      if (secondary&ATTR(hashsums[i].attribute)) {
+        line->hashsums[i] = checked_malloc(hashsums[i].length);
+        memcpy(line->hashsums[i], old->hashsums[i], hashsums[i].length);
+      }
+    }
+    line->attr|=secondary;
+    conf->hash_stats.primary_verified++;
+    log_msg(LOG_LEVEL_DEBUG, " primary hashsum matches, use secondary hashsums of old entry for '%s'", line->filename);
+    return;
+  }
+
+  log_msg(LOG_LEVEL_DEBUG, " primary hashsum differs, calculate secondary hashsums for '%s'", line->filename);
+  byte *digest = line->hashsums[primary];
+  line->hashsums[primary] = NULL;
+  line->attr = (line->attr&~conf->primary_hashsum)|secondary;
+  /* the file has already been accounted for by the first pass */
+  hash_stats stats = conf->hash_stats;
+  calc_file_md(old_fs, line);
+  conf->hash_stats = stats;
+  if (line->attr&secondary) {
+    line->hashsums[primary] = digest;
+    line->attr|=conf->primary_hashsum;
+  } else {
+    /* file changed in between, no hashsums */
+    free(digest);
+  }
+  conf->hash_stats.primary_mismatch++;
+}
+
 void fs2db_line(struct stat* fs,db_line* line) {
   
   line->inode=fs->st_ino;
@@ -541,8 +1731,8 @@ static void xattr_add(xattrs_type *xattrs, const char *key, const char
 void xattrs2line(db_line *line) {
     /* get all generic user xattrs. */
     xattrs_type *xattrs = NULL;
-    static ssize_t xsz = 1024;
-    static char *xatrs = NULL;
+    static __thread ssize_t xsz = 1024;
+    static __thread char *xatrs = NULL;
     ssize_t xret = -1;
 
     if (!(ATTR(attr_xattrs)&line->attr))
@@ -550,7 +1740,7 @@ void xattrs2line(db_line *line) {
 
     if (!xatrs) xatrs = checked_malloc(xsz);
 
-    while (((xret = llistxattr(line->fullpath, xatrs, xsz)) == -1) && (errno == ERANGE)) {
+    while (((xret = conf->fs->listxattr(line->fullpath, xatrs, xsz)) == -1) && (errno == ERANGE)) {
         xsz <<= 1;
         xatrs = checked_realloc(xatrs, xsz);
     }
@@ -561,8 +1751,8 @@ void xattrs2line(db_line *line) {
         log_msg(LOG_LEVEL_WARNING, "listxattrs failed for %s:%s", line->fullpath, strerror(errno));
     } else if (xret) {
         const char *attr = xatrs;
-        static ssize_t asz = 1024;
-        static char *val = NULL;
+        static __thread ssize_t asz = 1024;
+        static __thread char *val = NULL;
 
         if (!val) val = checked_malloc(asz);
 
@@ -577,7 +1767,7 @@ void xattrs2line(db_line *line) {
                     strncmp(attr, "trusted.", strlen("trusted.")))
                 goto next_attr; /* only store normal xattrs, and SELinux */
 
-            while (((aret = getxattr(line->fullpath, attr, val, asz)) ==
+            while (((aret = conf->fs->getxattr(line->fullpath, attr, val, asz)) ==
                         -1) && (errno == ERANGE)) {
                 asz <<= 1;
                 val = checked_realloc (val, asz);
@@ -657,6 +1847,6 @@ void capabilities2line(db_line* line) {
 #endif
 
 void no_hash(db_line* line) {
-  line->attr&=~get_hashes(true);
+  line->attr&=~(get_hashes(true)|ATTR(attr_chunks)|ATTR(attr_fsverity));
 }
 
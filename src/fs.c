@@ -0,0 +1,120 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef WITH_XATTR
+#include <sys/xattr.h>
+#endif
+
+#include "aide.h"
+#include "db_config.h"
+#include "fs.h"
+#include "log.h"
+
+static int disk_lstat(const char *path, struct stat *fs) {
+    return lstat(path, fs);
+}
+
+static int disk_stat(const char *path, struct stat *fs) {
+    return stat(path, fs);
+}
+
+static int disk_fstat(int fd, struct stat *fs) {
+    return fstat(fd, fs);
+}
+
+static void *disk_opendir(const char *path) {
+    return opendir(path);
+}
+
+static const char *disk_readdir(void *dir) {
+    struct dirent *entp = readdir((DIR *) dir);
+    return entp ? entp->d_name : NULL;
+}
+
+static int disk_closedir(void *dir) {
+    return closedir((DIR *) dir);
+}
+
+static int disk_open(const char *path, int flags) {
+    return open(path, flags);
+}
+
+static ssize_t disk_listxattr(const char *path, char *names, size_t size) {
+#ifdef WITH_XATTR
+    return llistxattr(path, names, size);
+#else
+    (void)path; (void)names; (void)size;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+static ssize_t disk_getxattr(const char *path, const char *name, void *value, size_t size) {
+#ifdef WITH_XATTR
+    return getxattr(path, name, value, size);
+#else
+    (void)path; (void)name; (void)value; (void)size;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+const fs_ops disk_fs_ops = {
+    "disk",
+    true,
+    disk_lstat,
+    disk_stat,
+    readlink,
+    disk_opendir,
+    disk_readdir,
+    disk_closedir,
+    disk_open,
+    disk_fstat,
+    read,
+    pread,
+    close,
+    disk_listxattr,
+    disk_getxattr,
+};
+
+bool set_fs_backend(const char *backend) {
+    if (strcmp(backend, disk_fs_ops.name) == 0) {
+        conf->fs = &disk_fs_ops;
+    } else if (strncmp(backend, "memory", strlen("memory")) == 0
+            && (backend[strlen("memory")] == '\0' || backend[strlen("memory")] == ':')) {
+        const char *params = backend[strlen("memory")] ? &backend[strlen("memory")+1] : "";
+        if (!init_memory_fs(params)) {
+            return false;
+        }
+        conf->fs = &memory_fs_ops;
+    } else {
+        log_msg(LOG_LEVEL_ERROR, "unknown file system backend: '%s' (expecting 'disk' or 'memory[:<parameters>]')", backend);
+        return false;
+    }
+    log_msg(LOG_LEVEL_DEBUG, "use file system backend '%s'", conf->fs->name);
+    return true;
+}
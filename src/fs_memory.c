@@ -0,0 +1,360 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "fs.h"
+#include "log.h"
+#include "util.h"
+
+/*
+ * Synthetic file system generated on the fly, nothing but the open files
+ * is kept in memory. Every directory below depth 'depth' has the
+ * sub-directories d0 .. d<dirs-1>, every directory has the regular files
+ * f0 .. f<files-1> of 'size' bytes. The file content is derived from the
+ * inode number (a hash of the path) and 'seed'.
+ */
+
+typedef struct memory_fs_params {
+    unsigned long depth;
+    unsigned long dirs;
+    unsigned long files;
+    long long size;
+    unsigned long long seed;
+    long long mtime;
+} memory_fs_params;
+
+static memory_fs_params params = { 3, 10, 100, 4096, 0, 1600000000 };
+
+#define MEMORY_FS_DEV 0x6d656dLU
+#define MEMORY_FS_FD_BASE (1<<20)
+
+typedef struct memory_file {
+    bool used;
+    struct stat fs;
+    off_t pos;
+} memory_file;
+
+static memory_file *open_files = NULL;
+static int num_open_files = 0;
+
+typedef struct memory_dir {
+    unsigned long next;
+    unsigned long dirs;
+    char name[32];
+} memory_dir;
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15LLU;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9LLU;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBLLU;
+    return x ^ (x >> 31);
+}
+
+static bool parse_number(const char *s, size_t len, unsigned long *n) {
+    if (len == 0 || len > 19 || (len > 1 && s[0] == '0')) {
+        return false;
+    }
+    *n = 0;
+    for (size_t i = 0 ; i < len ; ++i) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+        *n = *n * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+/*
+ * Get file type, depth and inode of path
+ * Return: S_IFDIR / S_IFREG / 0 (errno set)
+ */
+static mode_t lookup(const char *path, unsigned long *depth, uint64_t *ino) {
+    uint64_t h = 0xcbf29ce484222325LLU;
+    mode_t type = S_IFDIR;
+    *depth = 0;
+
+    if (*path != '/') {
+        errno = ENOENT;
+        return 0;
+    }
+    while (*path) {
+        while (*path == '/') {
+            path++;
+        }
+        if (*path == '\0') {
+            break;
+        }
+        size_t len = strcspn(path, "/");
+        unsigned long n;
+        if (type != S_IFDIR) {
+            errno = ENOTDIR;
+            return 0;
+        }
+        if (!parse_number(path + 1, len - 1, &n)) {
+            errno = ENOENT;
+            return 0;
+        }
+        if (path[0] == 'd' && n < params.dirs && *depth < params.depth) {
+            (*depth)++;
+        } else if (path[0] == 'f' && n < params.files) {
+            type = S_IFREG;
+        } else {
+            errno = ENOENT;
+            return 0;
+        }
+        for (size_t i = 0 ; i < len ; ++i) {
+            h = (h ^ (unsigned char) path[i]) * 0x100000001b3LLU;
+        }
+        h = (h ^ '/') * 0x100000001b3LLU;
+        path += len;
+    }
+    *ino = h;
+    return type;
+}
+
+static int memory_lstat(const char *path, struct stat *fs) {
+    unsigned long depth;
+    uint64_t ino;
+    mode_t type = lookup(path, &depth, &ino);
+
+    if (!type) {
+        return -1;
+    }
+    memset(fs, 0, sizeof(struct stat));
+    fs->st_dev = MEMORY_FS_DEV;
+    fs->st_ino = ino;
+    fs->st_mode = type|(type == S_IFDIR ? 0755 : 0644);
+    fs->st_nlink = type == S_IFDIR ? 2 + (depth < params.depth ? params.dirs : 0) : 1;
+    fs->st_size = type == S_IFDIR ? 4096 : params.size;
+    fs->st_blksize = 4096;
+    fs->st_blocks = (fs->st_size + 511) / 512;
+    fs->st_atime = fs->st_mtime = fs->st_ctime = params.mtime;
+    return 0;
+}
+
+static ssize_t memory_readlink(const char *path, char *buf, size_t size) {
+    struct stat fs;
+    (void)buf; (void)size;
+    if (memory_lstat(path, &fs) == 0) {
+        errno = EINVAL;
+    }
+    return -1;
+}
+
+static void *memory_opendir(const char *path) {
+    unsigned long depth;
+    uint64_t ino;
+    mode_t type = lookup(path, &depth, &ino);
+
+    if (type != S_IFDIR) {
+        if (type) {
+            errno = ENOTDIR;
+        }
+        return NULL;
+    }
+    memory_dir *dir = checked_malloc(sizeof(memory_dir));
+    dir->next = 0;
+    dir->dirs = depth < params.depth ? params.dirs : 0;
+    return dir;
+}
+
+static const char *memory_readdir(void *d) {
+    memory_dir *dir = d;
+
+    if (dir->next < dir->dirs) {
+        snprintf(dir->name, sizeof(dir->name), "d%lu", dir->next);
+    } else if (dir->next < dir->dirs + params.files) {
+        snprintf(dir->name, sizeof(dir->name), "f%lu", dir->next - dir->dirs);
+    } else {
+        return NULL;
+    }
+    dir->next++;
+    return dir->name;
+}
+
+static int memory_closedir(void *dir) {
+    free(dir);
+    return 0;
+}
+
+static memory_file *get_open_file(int fd) {
+    fd -= MEMORY_FS_FD_BASE;
+    if (fd < 0 || fd >= num_open_files || !open_files[fd].used) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &open_files[fd];
+}
+
+static int memory_open(const char *path, int flags) {
+    struct stat fs;
+    int fd;
+    (void)flags;
+
+    if (memory_lstat(path, &fs) == -1) {
+        return -1;
+    }
+    if (S_ISDIR(fs.st_mode)) {
+        errno = EISDIR;
+        return -1;
+    }
+    for (fd = 0 ; fd < num_open_files && open_files[fd].used ; ++fd);
+    if (fd == num_open_files) {
+        num_open_files = num_open_files ? 2*num_open_files : 16;
+        open_files = checked_realloc(open_files, num_open_files*sizeof(memory_file));
+        for (int i = fd ; i < num_open_files ; ++i) {
+            open_files[i].used = false;
+        }
+    }
+    open_files[fd].used = true;
+    open_files[fd].fs = fs;
+    open_files[fd].pos = 0;
+    return MEMORY_FS_FD_BASE + fd;
+}
+
+static int memory_fstat(int fd, struct stat *fs) {
+    memory_file *file = get_open_file(fd);
+    if (file == NULL) {
+        return -1;
+    }
+    *fs = file->fs;
+    return 0;
+}
+
+static ssize_t memory_pread(int fd, void *buf, size_t count, off_t offset) {
+    memory_file *file = get_open_file(fd);
+    if (file == NULL) {
+        return -1;
+    }
+    if (offset >= file->fs.st_size) {
+        return 0;
+    }
+    if ((off_t) count > file->fs.st_size - offset) {
+        count = file->fs.st_size - offset;
+    }
+    unsigned char *p = buf;
+    for (size_t i = 0 ; i < count ; ) {
+        off_t pos = offset + i;
+        uint64_t v = splitmix64(file->fs.st_ino ^ splitmix64(params.seed ^ (uint64_t) (pos >> 3)));
+        for (int b = pos & 7 ; b < 8 && i < count ; ++b, ++i) {
+            p[i] = (unsigned char) (v >> (8*b));
+        }
+    }
+    return count;
+}
+
+static ssize_t memory_read(int fd, void *buf, size_t count) {
+    memory_file *file = get_open_file(fd);
+    if (file == NULL) {
+        return -1;
+    }
+    ssize_t n = memory_pread(fd, buf, count, file->pos);
+    if (n > 0) {
+        file->pos += n;
+    }
+    return n;
+}
+
+static int memory_close(int fd) {
+    memory_file *file = get_open_file(fd);
+    if (file == NULL) {
+        return -1;
+    }
+    file->used = false;
+    return 0;
+}
+
+static ssize_t memory_listxattr(const char *path, char *names, size_t size) {
+    (void)path; (void)names; (void)size;
+    errno = ENOTSUP;
+    return -1;
+}
+
+static ssize_t memory_getxattr(const char *path, const char *name, void *value, size_t size) {
+    (void)path; (void)name; (void)value; (void)size;
+    errno = ENOTSUP;
+    return -1;
+}
+
+const fs_ops memory_fs_ops = {
+    "memory",
+    false,
+    memory_lstat,
+    memory_lstat,
+    memory_readlink,
+    memory_opendir,
+    memory_readdir,
+    memory_closedir,
+    memory_open,
+    memory_fstat,
+    memory_read,
+    memory_pread,
+    memory_close,
+    memory_listxattr,
+    memory_getxattr,
+};
+
+bool init_memory_fs(const char *param_string) {
+    char *str = checked_strdup(param_string);
+    char *saveptr = NULL;
+    bool valid = true;
+
+    for (char *param = strtok_r(str, ",", &saveptr) ; param ; param = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(param, '=');
+        char *endp = NULL;
+        long long n = -1;
+        if (value) {
+            *value++ = '\0';
+            n = strtoll(value, &endp, 10);
+        }
+        if (value == NULL || *value == '\0' || *endp != '\0' || n < 0) {
+            log_msg(LOG_LEVEL_ERROR, "memory file system: invalid parameter '%s' (expecting <name>=<number>)", param);
+            valid = false;
+        } else if (strcmp(param, "depth") == 0) {
+            params.depth = n;
+        } else if (strcmp(param, "dirs") == 0) {
+            params.dirs = n;
+        } else if (strcmp(param, "files") == 0) {
+            params.files = n;
+        } else if (strcmp(param, "size") == 0) {
+            params.size = n;
+        } else if (strcmp(param, "seed") == 0) {
+            params.seed = n;
+        } else if (strcmp(param, "mtime") == 0) {
+            params.mtime = n;
+        } else {
+            log_msg(LOG_LEVEL_ERROR, "memory file system: unknown parameter '%s'", param);
+            valid = false;
+        }
+    }
+    free(str);
+    if (valid) {
+        log_msg(LOG_LEVEL_INFO, "memory file system: depth: %lu, dirs: %lu, files: %lu, size: %lld, seed: %llu, mtime: %lld",
+                params.depth, params.dirs, params.files, params.size, params.seed, params.mtime);
+    }
+    return valid;
+}
@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <time.h>
+#include <search.h>
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
 
@@ -46,7 +47,9 @@
 #include "db_config.h"
 #include "db_disk.h"
 #include "db_lex.h"
+#include "db_reader.h"
 #include "do_md.h"
+#include "fs.h"
 #include "log.h"
 #include "util.h"
 /*for locale support*/
@@ -151,6 +154,32 @@ static int have_xattrs_changed(xattrs_type* x1,xattrs_type* x2) {
 }
 #endif
 
+static int have_chunks_changed(chunks_type* c1, chunks_type* c2) {
+    if (c1==NULL && c2==NULL) {
+        return RETOK;
+    }
+    if (c1==NULL || c2==NULL) {
+        return RETFAIL;
+    }
+    if (c1->chunk_size != c2->chunk_size || c1->num != c2->num) {
+        return RETFAIL;
+    }
+    return c1->num && memcmp(c1->digests, c2->digests, c1->num*hashsums[CHUNK_HASHSUM].length);
+}
+
+static int has_fsverity_changed(fsverity_type* f1, fsverity_type* f2) {
+    if (f1==NULL && f2==NULL) {
+        return RETOK;
+    }
+    if (f1==NULL || f2==NULL) {
+        return RETFAIL;
+    }
+    if (f1->algorithm != f2->algorithm || f1->length != f2->length) {
+        return RETFAIL;
+    }
+    return f1->length && memcmp(f1->digest, f2->digest, f1->length);
+}
+
 #ifdef WITH_E2FSATTRS
 static int has_e2fsattrs_changed(unsigned long old, unsigned long new) {
     return (old^new);
@@ -196,6 +225,8 @@ static DB_ATTR_TYPE get_changed_attributes(db_line* l1,db_line* l2) {
         ret|=attr;
     }
   }
+    easy_function_compare(ATTR(attr_chunks),chunks,have_chunks_changed);
+    easy_function_compare(ATTR(attr_fsverity),fsverity,has_fsverity_changed);
 
 #ifdef WITH_ACL
     easy_function_compare(ATTR(attr_acl),acl,has_acl_changed);
@@ -269,6 +300,9 @@ void strip_dbline(db_line* line)
 
     DB_ATTR_TYPE attr = line->attr;
 
+  release_dict_values(line, ~attr);
+  release_view_values(line, ~attr&~ATTR(attr_filename));
+
   /* filename is always needed, hence it is never stripped */
   if(!(attr&ATTR(attr_linkname))){
     checked_free(line->linkname);
@@ -301,12 +335,28 @@ void strip_dbline(db_line* line)
   if(!(attr&ATTR(attr_bcount))){
     line->bcount=0;
   }
+  if(!(attr&ATTR(attr_verified))){
+    line->verified=0;
+  }
+  if(!(attr&ATTR(attr_rule))){
+    line->rule=0;
+  }
 
   for (int i = 0 ; i < num_hashes ; ++i) {
       if(!(attr&ATTR(hashsums[i].attribute))){
           checked_free(line->hashsums[i]);
       }
   }
+  if(!(attr&ATTR(attr_chunks))){
+    if (line->chunks)
+      free(line->chunks->digests);
+    checked_free(line->chunks);
+  }
+  if(!(attr&ATTR(attr_fsverity))){
+    if (line->fsverity)
+      free(line->fsverity->digest);
+    checked_free(line->fsverity);
+  }
 
 #ifdef WITH_ACL
   if(!(attr&ATTR(attr_acl))){
@@ -338,6 +388,23 @@ void strip_dbline(db_line* line)
   /* e2fsattrs is stripped within e2fsattrs2line in do_md */
 }
 
+/*
+ * is_raw_line_current()
+ * whether the raw line of an unchanged old entry can be written instead of
+ * the new entry (the fields written regardless of the attributes of the rule
+ * have to be equal, too)
+ */
+static bool is_raw_line_current(db_line* old, db_line* new)
+{
+  return old->raw && old->attr == new->attr && old->perm == new->perm
+      && old->inode == new->inode && old->size == new->size
+      && old->verified == new->verified && old->rule == new->rule
+#ifdef WITH_E2FSATTRS
+      && old->e2fsattrs == new->e2fsattrs
+#endif
+      ;
+}
+
 /*
  * add_file_to_tree
  */
@@ -377,9 +444,9 @@ static void add_file_to_tree(seltree* tree,db_line* file,int db_flags, const dat
     node->new_data=file;
     if(conf->action&DO_INIT) {
         node->checked|=NODE_FREE;
-        log_msg(LOG_LEVEL_DEBUG, "add old entry '%s' (%c) to node (%p) as new data (entry does not match limit but keep it for database_out)", file->filename, get_file_type_char_from_perm(file->perm), node);
+        log_msg(LOG_LEVEL_DEBUG, "add old entry '%s' (%c) to node (%p) as new data (keep it for database_out)", file->filename, get_file_type_char_from_perm(file->perm), node);
     } else {
-        log_msg(LOG_LEVEL_DEBUG, "drop old entry '%s' (entry does not match limit)", file->filename);
+        log_msg(LOG_LEVEL_DEBUG, "drop old entry '%s'", file->filename);
         free_db_line(node->new_data);
         free(node->new_data);
         node->new_data=NULL;
@@ -397,11 +464,22 @@ static void add_file_to_tree(seltree* tree,db_line* file,int db_flags, const dat
     str = ((node->old_data)->attr^(node->new_data)->attr)?diff_attributes((node->old_data)->attr, (node->new_data)->attr):NULL;
     log_msg(LOG_LEVEL_DEBUG,"different attributes for entry '%s': %s", (node->old_data)->filename, str?str:"(none)");
     free(str);
-    /* Free the data if same else leave as is for report_tree */
-    if(node->changed_attrs==RETOK && !((node->old_data)->attr^(node->new_data)->attr)) {
+    if ((node->old_data)->attr&(node->new_data)->attr&ATTR(attr_rule) && (node->old_data)->rule != (node->new_data)->rule) {
+      log_msg(LOG_LEVEL_DEBUG, "mark node '%s' as NODE_CONFIG_CHANGED (reason: entries were collected with different rules)", node->path);
+      node->checked|=NODE_CONFIG_CHANGED;
+    }
+    /* Free the data if same else leave as is for report_tree
+     * (the time of verification and the rule fingerprint are no file attributes) */
+    if(node->changed_attrs==RETOK && !(((node->old_data)->attr^(node->new_data)->attr)&~(ATTR(attr_verified)|ATTR(attr_rule)))) {
       log_msg(LOG_LEVEL_DEBUG, "free old data (node '%s' is unchanged)", node->path);
       node->changed_attrs=0;
 
+      if(conf->action&DO_INIT && is_raw_line_current(node->old_data, node->new_data)) {
+          log_msg(LOG_LEVEL_DEBUG, "keep raw line of old data (node '%s' is unchanged)", node->path);
+          (node->new_data)->raw=(node->old_data)->raw;
+          (node->old_data)->raw=NULL;
+      }
+
       free_db_line(node->old_data);
       free(node->old_data);
       node->old_data=NULL;
@@ -418,6 +496,18 @@ static void add_file_to_tree(seltree* tree,db_line* file,int db_flags, const dat
       }
       return;
     }
+    /* the raw line is only written for unchanged entries */
+    free((node->old_data)->raw);
+    (node->old_data)->raw=NULL;
+  }
+
+  /* the entry is kept for the report, which is generated after db_close()
+   * has released the mapped database and the dictionaries */
+  if (file->view_attrs) {
+    copy_view_values(file);
+  }
+  if (file->dict_attrs) {
+    copy_dict_values(file);
   }
 
   /* Do verification if file was moved only if we are asked for it.
@@ -487,18 +577,18 @@ static void add_file_to_tree(seltree* tree,db_line* file,int db_flags, const dat
   }
 }
 
-int check_rxtree(char* filename,seltree* tree, rx_rule* *rule, RESTRICTION_TYPE file_type, bool dry_run)
+int check_rxtree_r(char* filename,seltree* tree, rx_rule* *rule, RESTRICTION_TYPE file_type, bool dry_run, seltree_match_ctx *ctx)
 {
   log_msg(LOG_LEVEL_RULE, "\u252c process '%s' (filetype: %c)", filename, get_restriction_char(file_type));
 
   if(conf->limit!=NULL) {
-      int match=pcre2_match(conf->limit_crx, (PCRE2_SPTR) filename, PCRE2_ZERO_TERMINATED, 0, PCRE2_PARTIAL_SOFT, conf->limit_md, NULL);
+      int match=pcre2_match(conf->limit_crx, (PCRE2_SPTR) filename, PCRE2_ZERO_TERMINATED, 0, PCRE2_PARTIAL_SOFT, ctx->md, NULL);
       if (match >= 0) {
           log_msg(LOG_LEVEL_DEBUG, "\u2502 '%s' does match limit '%s'", filename, conf->limit);
       } else if (match == PCRE2_ERROR_PARTIAL) {
           if(file_type&FT_DIR && get_seltree_node(tree,filename)==NULL){
-              seltree* node = new_seltree_node(tree,filename,0,NULL);
-              log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: partial limit match)", node->path, node, filename);
+              log_msg(LOG_LEVEL_DEBUG, "new node for '%s' (reason: partial limit match)", filename);
+              add_pending_node(ctx, tree, filename);
           }
           log_msg(LOG_LEVEL_RULE, "\u2534 skip '%s' (reason: partial limit match, limit: '%s')", filename, conf->limit);
           return PARTIAL_LIMIT_MATCH;
@@ -508,7 +598,7 @@ int check_rxtree(char* filename,seltree* tree, rx_rule* *rule, RESTRICTION_TYPE
       }
   }
 
-  int match = check_seltree(tree, filename, file_type, rule);
+  int match = check_seltree(tree, filename, file_type, rule, ctx);
   if (dry_run) {
       char * str;
       fprintf(stdout, "[%c] %c '%s': ", match?'X':' ', get_restriction_char(file_type), filename);
@@ -529,6 +619,13 @@ int check_rxtree(char* filename,seltree* tree, rx_rule* *rule, RESTRICTION_TYPE
   return match;
 }
 
+int check_rxtree(char* filename,seltree* tree, rx_rule* *rule, RESTRICTION_TYPE file_type, bool dry_run, seltree_match_ctx *ctx)
+{
+  int match = check_rxtree_r(filename, tree, rule, file_type, dry_run, ctx);
+  add_pending_seltree_nodes(ctx);
+  return match;
+}
+
 db_line* get_file_attrs(char* filename,DB_ATTR_TYPE attr, struct stat *fs, bool dry_run)
 {
   db_line* line=NULL;
@@ -601,6 +698,11 @@ db_line* get_file_attrs(char* filename,DB_ATTR_TYPE attr, struct stat *fs, bool
   
   fs2db_line(fs,line);
   
+  if (!conf->fs->native) {
+    /* read via libraries from the real file system only */
+    line->attr&=~(ATTR(attr_acl)|ATTR(attr_selinux)|ATTR(attr_e2fsattrs)|ATTR(attr_capabilities));
+  }
+
   /*
     ACL stuff
   */
@@ -625,8 +727,15 @@ db_line* get_file_attrs(char* filename,DB_ATTR_TYPE attr, struct stat *fs, bool
     capabilities2line(line);
 #endif
 
-  if (line->attr&get_hashes(true) && S_ISREG(fs->st_mode)) {
+  if (line->attr&(get_hashes(true)|ATTR(attr_chunks)|ATTR(attr_fsverity)) && S_ISREG(fs->st_mode)) {
     calc_md(fs,line);
+    if (conf->rolling_rehash && line->attr&(get_hashes(true)|ATTR(attr_chunks))) {
+      /* set by calc_md() if the hashsums of the old entry were reused */
+      if (line->verified == 0) {
+        line->verified = cur_time;
+      }
+      line->attr|=ATTR(attr_verified);
+    }
   } else {
     /*
       We cannot calculate hash for nonfile.
@@ -659,24 +768,129 @@ void write_tree(seltree* node) {
     }
 }
 
+static int compare_db_line_by_filename(const void *l1, const void *l2) {
+    return strcmp(((const db_line*) l1)->filename, ((const db_line*) l2)->filename);
+}
+
+static void keep_old_entry(void *data) {
+    (void) data; /* entries are freed via the tree */
+}
+
+db_line* get_old_entry(char *filename) {
+    db_line key, **entry;
+    key.filename = filename;
+    entry = tfind(&key, &conf->scan.old_entries, compare_db_line_by_filename);
+    return entry?*entry:NULL;
+}
+
+bool carry_forward_old_entry(char *filename, rx_rule *rule, mode_t mode) {
+    db_line *old = get_old_entry(filename);
+    if (old == NULL) {
+        return false;
+    }
+    if (!(old->attr&ATTR(attr_rule))) {
+        conf->scan.num_no_fingerprint++;
+        log_msg(LOG_LEVEL_DEBUG, "read '%s' from disk (reason: old entry has no rule fingerprint)", filename);
+        return false;
+    }
+    if (old->rule != get_rule_fingerprint(rule)) {
+        conf->scan.num_rule_changed++;
+        log_msg(LOG_LEVEL_DEBUG, "read '%s' from disk (reason: rule changed)", filename);
+        return false;
+    }
+    if ((old->perm&S_IFMT) != (mode&S_IFMT)) {
+        log_msg(LOG_LEVEL_DEBUG, "read '%s' from disk (reason: file type changed)", filename);
+        return false;
+    }
+    log_msg(LOG_LEVEL_DEBUG, "carry forward old entry '%s' (reason: rule unchanged)", filename);
+    tsearch(old, &conf->scan.carried_entries, compare_db_line_by_filename);
+    conf->scan.num_carried++;
+    return true;
+}
+
+static void add_old_entry(seltree* tree, db_line* old, int *initdbwarningprinted, bool dry_run, seltree_match_ctx *ctx) {
+    rx_rule *rule;
+    if (conf->scan.carried_entries && tfind(old, &conf->scan.carried_entries, compare_db_line_by_filename)) {
+        add_file_to_tree(tree,old,DB_OLD|DB_NEW, &(conf->database_in));
+        return;
+    }
+    int add=check_rxtree(old->filename,tree, &rule, get_restriction_from_perm(old->perm), dry_run, ctx);
+    if(add > 0) {
+        add_file_to_tree(tree,old,DB_OLD, &(conf->database_in));
+    } else if (conf->limit!=NULL && add < 0) {
+        log_msg(LOG_LEVEL_DEBUG, "old entry '%s' does not match limit", old->filename);
+        add_file_to_tree(tree,old,DB_OLD|DB_NEW, &(conf->database_in));
+    } else if (old->attr&ATTR(attr_rule)) {
+        /* the entry was collected with a rule, so the configuration has changed */
+        char *filename = checked_strdup(old->filename);
+        log_msg(LOG_LEVEL_DEBUG, "old entry '%s' has no matching rule (reason: config changed)", filename);
+        add_file_to_tree(tree,old,DB_OLD, &(conf->database_in));
+        seltree *node = get_seltree_node(tree, filename);
+        if (node && node->old_data) {
+            node->checked|=NODE_CONFIG_CHANGED;
+        }
+        free(filename);
+    }else{
+        if(!*initdbwarningprinted){
+            log_msg(LOG_LEVEL_WARNING, _("%s:%s: old database entry '%s' has no matching rule, run --init or --update (this warning is only shown once)"), get_url_type_string((conf->database_in.url)->type), (conf->database_in.url)->value, old->filename);
+            *initdbwarningprinted=1;
+        }
+        free_db_line(old);
+        free(old);
+    }
+}
+
 void populate_tree(seltree* tree, bool dry_run)
 {
-  /* FIXME this function could really use threads */
   db_line* old=NULL;
   db_line* new=NULL;
   int initdbwarningprinted=0;
   rx_rule *rule;
+  list *preloaded=NULL;
+  bool preloaded_db=false;
+  database *db=&(conf->database_in);
+  db_reader *old_reader=NULL;
+  db_reader *new_reader=NULL;
+  seltree_match_ctx *ctx=new_seltree_match_ctx();
   
   /* With this we avoid unnecessary checking of removed files. */
   if(conf->action&DO_INIT){
     initdbwarningprinted=1;
   }
+
+    /* hash calculation of growing files, rolling re-hash, primary hashsum verification and --update-config need the old entries */
+    if(conf->action&DO_COMPARE && (conf->incremental_growing_files || conf->rolling_rehash
+                || (conf->primary_hashsum && !(conf->action&DO_INIT)) || conf->action&DO_CONFIG_UPDATE)){
+        log_msg(LOG_LEVEL_INFO, "read old entries from database (before reading from disk): %s:%s", get_url_type_string((conf->database_in.url)->type), (conf->database_in.url)->value);
+        preloaded_db = true;
+        old_reader = db_reader_start(&(conf->database_in), false);
+        while((old=db_reader_next(old_reader)) != NULL) {
+            if (get_old_entry(old->filename)) {
+                LOG_DB_FORMAT_LINE(LOG_LEVEL_WARNING, "duplicate database entry found for '%s' (skip line)", old->filename)
+                free_db_line(old);
+                free(old);
+                continue;
+            }
+            tsearch(old, &conf->scan.old_entries, compare_db_line_by_filename);
+            preloaded=list_append(preloaded, old);
+        }
+        old_reader = NULL;
+        if (conf->rolling_rehash) {
+            init_rolling_rehash(preloaded);
+        }
+    }
   
+    /* the old entries are parsed on a separate thread during the disk scan
+     * (or while the entries of database_new are processed) */
+    if(!preloaded_db && ((conf->action&DO_COMPARE)||(conf->action&DO_DIFF))){
+        old_reader = db_reader_start(&(conf->database_in), conf->database_parallel_read);
+    }
+
     if(conf->action&DO_DIFF){
         log_msg(LOG_LEVEL_INFO, "read new entries from database: %s:%s", get_url_type_string((conf->database_new.url)->type), (conf->database_new.url)->value);
-      db_lex_buffer(&(conf->database_new));
-      while((new=db_readline(&(conf->database_new))) != NULL){
-	if(check_rxtree(new->filename,tree, &rule, get_restriction_from_perm(new->perm), dry_run) > 0){
+      new_reader = db_reader_start(&(conf->database_new), conf->database_parallel_read);
+      while((new=db_reader_next(new_reader)) != NULL){
+	if(check_rxtree(new->filename,tree, &rule, get_restriction_from_perm(new->perm), dry_run, ctx) > 0){
 	  add_file_to_tree(tree,new,DB_NEW, &(conf->database_new));
 	} else {
           free_db_line(new);
@@ -684,7 +898,6 @@ void populate_tree(seltree* tree, bool dry_run)
           new=NULL;
 	}
       }
-      db_lex_delete_buffer(&(conf->database_new));
     }
     
     if((conf->action&DO_INIT)||(conf->action&DO_COMPARE)){
@@ -693,29 +906,33 @@ void populate_tree(seltree* tree, bool dry_run)
       log_msg(LOG_LEVEL_INFO, "read new entries from disk (root: '%s', limit: '%s')", conf->root_prefix, conf->limit?conf->limit:"(none)");
       while((new=db_readline_disk(dry_run)) != NULL) {
 	    add_file_to_tree(tree,new,DB_NEW, NULL);
+            /* take the old entries parsed so far, so the reading thread does not wait on a full queue */
+            while(old_reader && (old=db_reader_poll(old_reader)) != NULL) {
+                add_old_entry(tree, old, &initdbwarningprinted, dry_run, ctx);
+            }
       }
+      free_hardlink_hashsums();
     }
-    if((conf->action&DO_COMPARE)||(conf->action&DO_DIFF)){
+    if (preloaded_db) {
+        tdestroy(conf->scan.old_entries, keep_old_entry);
+        conf->scan.old_entries = NULL;
+        while (preloaded) {
+            add_old_entry(tree, preloaded->data, &initdbwarningprinted, dry_run, ctx);
+            preloaded = list_delete_item(preloaded);
+        }
+        if (conf->action&DO_CONFIG_UPDATE) {
+            tdestroy(conf->scan.carried_entries, keep_old_entry);
+            conf->scan.carried_entries = NULL;
+            log_msg(LOG_LEVEL_INFO, "update config: carried forward %lu entries with unchanged rule, read %lu entries with changed rule and %lu entries without rule fingerprint from disk",
+                    conf->scan.num_carried, conf->scan.num_rule_changed, conf->scan.num_no_fingerprint);
+        }
+    } else if(old_reader){
         log_msg(LOG_LEVEL_INFO, "read old entries from database: %s:%s", get_url_type_string((conf->database_in.url)->type), (conf->database_in.url)->value);
-        db_lex_buffer(&(conf->database_in));
-            while((old=db_readline(&(conf->database_in))) != NULL) {
-                int add=check_rxtree(old->filename,tree, &rule, get_restriction_from_perm(old->perm), dry_run);
-                if(add > 0) {
-                    add_file_to_tree(tree,old,DB_OLD, &(conf->database_in));
-                } else if (conf->limit!=NULL && add < 0) {
-                    add_file_to_tree(tree,old,DB_OLD|DB_NEW, &(conf->database_in));
-                }else{
-                    if(!initdbwarningprinted){
-                        log_msg(LOG_LEVEL_WARNING, _("%s:%s: old database entry '%s' has no matching rule, run --init or --update (this warning is only shown once)"), get_url_type_string((conf->database_in.url)->type), (conf->database_in.url)->value, old->filename);
-                        initdbwarningprinted=1;
-                    }
-                    free_db_line(old);
-                    free(old);
-                    old=NULL;
-                }
+            while((old=db_reader_next(old_reader)) != NULL) {
+                add_old_entry(tree, old, &initdbwarningprinted, dry_run, ctx);
             }
-            db_lex_delete_buffer(&(conf->database_in));
     }
+    free_seltree_match_ctx(ctx);
 }
 
 void hsymlnk(db_line* line) {
@@ -731,7 +948,7 @@ void hsymlnk(db_line* line) {
     if(conf->warn_dead_symlinks==1) {
       struct stat fs;
       int sres;
-      sres=stat(line->fullpath,&fs);
+      sres=conf->fs->stat(line->fullpath,&fs);
       if (sres!=0 && sres!=EACCES) {
 	log_msg(LOG_LEVEL_WARNING,"Dead symlink detected at %s",line->fullpath);
       }
@@ -757,7 +974,7 @@ void hsymlnk(db_line* line) {
     */
     memset(line->linkname,0,_POSIX_PATH_MAX+1);
     
-    len=readlink(line->fullpath,line->linkname,_POSIX_PATH_MAX+1);
+    len=conf->fs->readlink(line->fullpath,line->linkname,_POSIX_PATH_MAX+1);
     
     line->linkname=checked_realloc(line->linkname,len+1);
   } else {
@@ -0,0 +1,321 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glob_rule.h"
+#include "util.h"
+
+/*
+ * A glob is compiled to its literal prefix (the text before the first
+ * wildcard, compared with strncmp(3)) and a sequence of operations for the
+ * rest, which is matched by a state machine with one state per operation.
+ */
+
+typedef enum {
+    GLOB_CHAR,
+    GLOB_ANY,
+    GLOB_CLASS,
+    GLOB_STAR,
+    GLOB_GLOBSTAR,
+    GLOB_GLOBSTAR_DIR, /* '**' path component and its '/', zero or more directories */
+} glob_op_type;
+
+typedef struct glob_range {
+    uint32_t from;
+    uint32_t to;
+} glob_range;
+
+typedef struct glob_op {
+    glob_op_type type;
+    uint32_t c;
+    bool negate;
+    int num_ranges;
+    glob_range *ranges;
+} glob_op;
+
+struct glob_rule {
+    char *prefix;
+    size_t prefix_len;
+    int num_ops;
+    glob_op *ops;
+    bool eol;
+};
+
+/* decode one UTF-8 character, invalid sequences are taken byte by byte */
+static uint32_t next_char(const unsigned char **s) {
+    const unsigned char *p = *s;
+    uint32_t c;
+    int n;
+
+    if (p[0] < 0xc0 || p[0] >= 0xf8) {
+        *s = p+1;
+        return p[0];
+    } else if (p[0] < 0xe0) {
+        n = 1;
+        c = p[0]&0x1f;
+    } else if (p[0] < 0xf0) {
+        n = 2;
+        c = p[0]&0x0f;
+    } else {
+        n = 3;
+        c = p[0]&0x07;
+    }
+    for (int i = 1; i <= n; ++i) {
+        if ((p[i]&0xc0) != 0x80) {
+            *s = p+1;
+            return p[0];
+        }
+        c = (c<<6)|(p[i]&0x3f);
+    }
+    *s = p+n+1;
+    return c;
+}
+
+void free_glob(glob_rule *g) {
+    if (g) {
+        for (int i = 0; i < g->num_ops; ++i) {
+            free(g->ops[i].ranges);
+        }
+        free(g->ops);
+        free(g->prefix);
+        free(g);
+    }
+}
+
+glob_rule *compile_glob(const char *glob, const char **error, size_t *erroffset) {
+    const unsigned char *p = (const unsigned char *) glob;
+    size_t len = strlen(glob);
+
+    glob_rule *g = checked_malloc(sizeof(glob_rule));
+    g->prefix = checked_malloc(len+1);
+    g->prefix_len = 0;
+    g->ops = checked_malloc((len+1)*sizeof(glob_op));
+    g->num_ops = 0;
+    g->eol = false;
+
+    while (*p) {
+        const unsigned char *start = p;
+        glob_op op = { GLOB_CHAR, 0, false, 0, NULL };
+        switch (*p) {
+            case '\\':
+                if (p[1] == '\0') {
+                    *error = "\\ at end of glob";
+                    goto fail;
+                }
+                p++;
+                op.c = next_char(&p);
+                break;
+            case '*':
+                op.type = GLOB_STAR;
+                if (*++p == '*') {
+                    op.type = GLOB_GLOBSTAR;
+                    while (*p == '*') {
+                        p++;
+                    }
+                    /* a complete path component '**' also matches no directory at all */
+                    if (*p == '/' && start > (const unsigned char *) glob && start[-1] == '/') {
+                        op.type = GLOB_GLOBSTAR_DIR;
+                        p++;
+                    }
+                }
+                break;
+            case '?':
+                op.type = GLOB_ANY;
+                p++;
+                break;
+            case '[':
+                op.type = GLOB_CLASS;
+                if (*++p == '!' || *p == '^') {
+                    op.negate = true;
+                    p++;
+                }
+                op.ranges = checked_malloc(len*sizeof(glob_range));
+                /* a ']' directly after '[' is part of the set */
+                do {
+                    if (*p == '\0') {
+                        free(op.ranges);
+                        *error = "missing terminating ] for character class";
+                        goto fail;
+                    }
+                    if (*p == '\\' && p[1]) {
+                        p++;
+                    }
+                    uint32_t from = next_char(&p), to = from;
+                    if (*p == '-' && p[1] && p[1] != ']') {
+                        if (*++p == '\\' && p[1]) {
+                            p++;
+                        }
+                        to = next_char(&p);
+                        if (to < from) {
+                            free(op.ranges);
+                            *error = "range out of order in character class";
+                            goto fail;
+                        }
+                    }
+                    op.ranges[op.num_ranges].from = from;
+                    op.ranges[op.num_ranges].to = to;
+                    op.num_ranges++;
+                } while (*p != ']');
+                p++;
+                op.ranges = checked_realloc(op.ranges, op.num_ranges*sizeof(glob_range));
+                break;
+            case '$':
+                if (p[1] == '\0') {
+                    g->eol = true;
+                    p++;
+                    continue;
+                }
+                /* fall through */
+            default:
+                op.c = next_char(&p);
+                break;
+        }
+        if (op.type == GLOB_CHAR && g->num_ops == 0) {
+            const unsigned char *c = *start == '\\'?start+1:start;
+            memcpy(g->prefix+g->prefix_len, c, p-c);
+            g->prefix_len += p-c;
+        } else {
+            g->ops[g->num_ops++] = op;
+        }
+        continue;
+fail:
+        *erroffset = start-(const unsigned char *) glob;
+        free_glob(g);
+        return NULL;
+    }
+    g->prefix[g->prefix_len] = '\0';
+    if (g->prefix[0] != '/') {
+        *error = "glob does not start with /";
+        *erroffset = 0;
+        free_glob(g);
+        return NULL;
+    }
+    return g;
+}
+
+/* wildcards also match the empty string */
+static void add_empty_matches(const glob_rule *g, unsigned char *states) {
+    for (int i = 0; i < g->num_ops; ++i) {
+        if (states[i] && (g->ops[i].type == GLOB_STAR || g->ops[i].type == GLOB_GLOBSTAR
+                    || g->ops[i].type == GLOB_GLOBSTAR_DIR)) {
+            states[i+1] = 1;
+        }
+    }
+}
+
+static bool in_class(const glob_op *op, uint32_t c) {
+    for (int i = 0; i < op->num_ranges; ++i) {
+        if (c >= op->ranges[i].from && c <= op->ranges[i].to) {
+            return !op->negate;
+        }
+    }
+    return op->negate;
+}
+
+/* Return: true (at least one state left) / false */
+static bool step(const glob_rule *g, const unsigned char *cur, unsigned char *next, uint32_t c) {
+    bool active = false;
+
+    memset(next, 0, g->num_ops+1);
+    for (int i = 0; i < g->num_ops; ++i) {
+        if (cur[i]) {
+            const glob_op *op = &g->ops[i];
+            switch (op->type) {
+                case GLOB_CHAR:
+                    next[i+1] |= c == op->c;
+                    break;
+                case GLOB_ANY:
+                    next[i+1] |= c != '/';
+                    break;
+                case GLOB_CLASS:
+                    next[i+1] |= c != '/' && in_class(op, c);
+                    break;
+                case GLOB_STAR:
+                    next[i] |= c != '/';
+                    break;
+                case GLOB_GLOBSTAR:
+                    next[i] = 1;
+                    break;
+                case GLOB_GLOBSTAR_DIR:
+                    next[i+1] |= c == '/';
+                    break;
+            }
+        }
+    }
+    add_empty_matches(g, next);
+    /* staying in '**' path component, it is only left after a '/' */
+    for (int i = 0; i < g->num_ops; ++i) {
+        if (cur[i] && g->ops[i].type == GLOB_GLOBSTAR_DIR) {
+            next[i] = 1;
+        }
+    }
+    for (int i = 0; i <= g->num_ops && !active; ++i) {
+        active = next[i];
+    }
+    return active;
+}
+
+int match_glob(const glob_rule *g, const char *text) {
+    size_t len = strlen(text);
+
+    if (len < g->prefix_len) {
+        return strncmp(text, g->prefix, len)?PCRE2_ERROR_NOMATCH:PCRE2_ERROR_PARTIAL;
+    }
+    if (strncmp(text, g->prefix, g->prefix_len)) {
+        return PCRE2_ERROR_NOMATCH;
+    }
+
+    unsigned char states[2][g->num_ops+1];
+    unsigned char *cur = states[0], *next = states[1], *tmp;
+    memset(cur, 0, g->num_ops+1);
+    cur[0] = 1;
+    add_empty_matches(g, cur);
+
+    const unsigned char *p = (const unsigned char *) text+g->prefix_len;
+    while (*p) {
+        if (*p == '/' && cur[g->num_ops] && !g->eol) {
+            /* glob matches a leading directory */
+            return 0;
+        }
+        if (!step(g, cur, next, next_char(&p))) {
+            return PCRE2_ERROR_NOMATCH;
+        }
+        tmp = cur;
+        cur = next;
+        next = tmp;
+    }
+    return cur[g->num_ops]?0:PCRE2_ERROR_PARTIAL;
+}
+
+char *get_glob_dir(const glob_rule *g) {
+    size_t lastslash = 1;
+
+    for (size_t i = 1; i < g->prefix_len; ++i) {
+        if (g->prefix[i] == '/') {
+            lastslash = i;
+        }
+    }
+    return checked_strndup(g->prefix, lastslash);
+}
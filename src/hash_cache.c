@@ -0,0 +1,313 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "attributes.h"
+#include "hashsum.h"
+#include "db_config.h"
+#include "hash_cache.h"
+#include "log.h"
+#include "util.h"
+
+#ifdef HAVE_MMAP
+
+/*
+ * The hash cache file is a fixed size hash table of entries keyed by
+ * (st_dev, st_ino), mapped into memory. An entry is only used if size,
+ * mtime and ctime (including nanoseconds) still match. Each key may be
+ * stored in one of HASH_CACHE_PROBES consecutive slots, if all of them
+ * are taken the least recently used one is evicted.
+ */
+
+#define HASH_CACHE_MAGIC "AIDEHC01"
+
+typedef struct hash_cache_header {
+    char magic[8];
+    uint64_t num_entries;
+    uint64_t entry_size;
+    uint64_t clock;
+} hash_cache_header;
+
+typedef struct hash_cache_entry {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    int64_t stored; /* time the digests were calculated */
+    uint64_t last_used;
+    uint64_t hashes; /* cached hashsums, 0 for an unused slot */
+    /* followed by the digests of all hashsums in order of hashsums[] */
+} hash_cache_entry;
+
+/* locks of open file descriptions also exclude the scans of other contexts
+ * in the same process */
+#ifdef F_OFD_SETLK
+#define HASH_CACHE_SETLK F_OFD_SETLK
+#else
+#define HASH_CACHE_SETLK F_SETLK
+#endif
+
+struct hash_cache {
+    int fd;
+    void *map;
+    size_t map_size;
+    bool safe_mode;
+    char *path;
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long stores;
+};
+
+#define cache_header(cache) ((hash_cache_header*) (cache)->map)
+
+static size_t get_digests_size(void) {
+    size_t size = 0;
+    for (int i = 0 ; i < num_hashes ; ++i) {
+        size += hashsums[i].length;
+    }
+    return size;
+}
+
+static size_t get_entry_size(void) {
+    size_t size = sizeof(hash_cache_entry) + get_digests_size();
+    return (size + 7) & ~((size_t) 7);
+}
+
+static hash_cache_entry *get_entry(hash_cache *cache, uint64_t n) {
+    return (hash_cache_entry *) ((char *) cache->map + sizeof(hash_cache_header) + n * cache_header(cache)->entry_size);
+}
+
+static byte *get_digest(hash_cache_entry *entry, HASHSUM hash) {
+    byte *digest = (byte *) entry + sizeof(hash_cache_entry);
+    for (HASHSUM i = 0 ; i < hash ; ++i) {
+        digest += hashsums[i].length;
+    }
+    return digest;
+}
+
+static uint64_t get_slot(hash_cache *cache, struct stat *fs) {
+    uint64_t h = ((uint64_t) fs->st_ino) * 0x9E3779B97F4A7C15LLU ^ ((uint64_t) fs->st_dev);
+    return h % cache_header(cache)->num_entries;
+}
+
+static bool is_same_file(hash_cache_entry *entry, struct stat *fs) {
+    return entry->hashes
+        && entry->dev == (uint64_t) fs->st_dev
+        && entry->ino == (uint64_t) fs->st_ino
+        && entry->size == (int64_t) fs->st_size
+        && entry->mtime_sec == (int64_t) fs->st_mtime
+        && entry->mtime_nsec == (int64_t) get_mtime_nsec(fs)
+        && entry->ctime_sec == (int64_t) fs->st_ctime
+        && entry->ctime_nsec == (int64_t) get_ctime_nsec(fs);
+}
+
+static void close_cache(hash_cache *cache) {
+    if (cache->map) {
+        munmap(cache->map, cache->map_size);
+        cache->map = NULL;
+    }
+    if (cache->fd != -1) {
+        close(cache->fd); /* releases the lock */
+        cache->fd = -1;
+    }
+    free(cache->path);
+    free(cache);
+}
+
+hash_cache *hash_cache_open(const char *path, unsigned long num_entries, bool safe_mode) {
+    struct flock fl;
+    struct stat fs;
+    hash_cache_header header;
+
+    hash_cache *cache = checked_malloc(sizeof(hash_cache));
+    cache->map = NULL;
+    cache->path = NULL;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->stores = 0;
+    cache->fd = open(path, O_RDWR|O_CREAT, 0600);
+    if (cache->fd == -1) {
+        log_msg(LOG_LEVEL_WARNING, "hash cache: open() failed for '%s': %s (continue without hash cache)", path, strerror(errno));
+        free(cache);
+        return NULL;
+    }
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 0;
+    fl.l_pid = 0;
+    if (fcntl(cache->fd, HASH_CACHE_SETLK, &fl) == -1) {
+        log_msg(LOG_LEVEL_WARNING, "hash cache: cannot get lock for '%s': %s (continue without hash cache)", path, strerror(errno));
+        close_cache(cache);
+        return NULL;
+    }
+
+    cache->map_size = sizeof(hash_cache_header) + num_entries * get_entry_size();
+
+    if (fstat(cache->fd, &fs) == -1) {
+        log_msg(LOG_LEVEL_WARNING, "hash cache: fstat() failed for '%s': %s (continue without hash cache)", path, strerror(errno));
+        close_cache(cache);
+        return NULL;
+    }
+    if ((size_t) fs.st_size != cache->map_size
+            || pread(cache->fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)
+            || memcmp(header.magic, HASH_CACHE_MAGIC, sizeof(header.magic))
+            || header.num_entries != num_entries
+            || header.entry_size != get_entry_size()) {
+        log_msg(LOG_LEVEL_INFO, "hash cache: (re)initialise '%s' with %lu entries", path, num_entries);
+        if (ftruncate(cache->fd, 0) == -1 || ftruncate(cache->fd, cache->map_size) == -1) {
+            log_msg(LOG_LEVEL_WARNING, "hash cache: ftruncate() failed for '%s': %s (continue without hash cache)", path, strerror(errno));
+            close_cache(cache);
+            return NULL;
+        }
+        memcpy(header.magic, HASH_CACHE_MAGIC, sizeof(header.magic));
+        header.num_entries = num_entries;
+        header.entry_size = get_entry_size();
+        header.clock = 0;
+        if (pwrite(cache->fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+            log_msg(LOG_LEVEL_WARNING, "hash cache: write() failed for '%s': %s (continue without hash cache)", path, strerror(errno));
+            close_cache(cache);
+            return NULL;
+        }
+    }
+
+    cache->map = mmap(NULL, cache->map_size, PROT_READ|PROT_WRITE, MAP_SHARED, cache->fd, 0);
+    if (cache->map == MAP_FAILED) {
+        cache->map = NULL;
+        log_msg(LOG_LEVEL_WARNING, "hash cache: mmap() failed for '%s': %s (continue without hash cache)", path, strerror(errno));
+        close_cache(cache);
+        return NULL;
+    }
+    cache->safe_mode = safe_mode;
+    cache->path = checked_strdup(path);
+    log_msg(LOG_LEVEL_DEBUG, "hash cache: opened '%s' (entries: %lu, safe mode: %s)", path, num_entries, btoa(safe_mode));
+    return cache;
+}
+
+bool hash_cache_lookup(hash_cache *cache, struct stat *fs, db_line *line) {
+    if (cache == NULL || line->attr&ATTR(attr_chunks)) {
+        return false;
+    }
+    DB_ATTR_TYPE requested = line->attr&get_hashes(false);
+    uint64_t slot = get_slot(cache, fs);
+    for (int i = 0 ; i < HASH_CACHE_PROBES ; ++i) {
+        hash_cache_entry *entry = get_entry(cache, (slot + i) % cache_header(cache)->num_entries);
+        if (is_same_file(entry, fs)) {
+            if ((requested&entry->hashes) != requested) {
+                log_msg(LOG_LEVEL_DEBUG, " hash cache: entry for '%s' lacks requested hashsums", line->filename);
+                break;
+            }
+            if (cache->safe_mode && entry->ctime_sec + HASH_CACHE_TIMESTAMP_GRANULARITY >= entry->stored) {
+                log_msg(LOG_LEVEL_DEBUG, " hash cache: untrusted entry for '%s' (ctime too close to time of calculation)", line->filename);
+                break;
+            }
+            for (int j = 0 ; j < num_hashes ; ++j) {
+                DB_ATTR_TYPE attr = ATTR(hashsums[j].attribute);
+                if (requested&attr) {
+                    line->hashsums[j] = checked_malloc(hashsums[j].length);
+                    memcpy(line->hashsums[j], get_digest(entry, j), hashsums[j].length);
+                } else if (line->attr&attr) {
+                    /* unsupported hashsum */
+                    line->attr&=~attr;
+                }
+            }
+            entry->last_used = ++cache_header(cache)->clock;
+            cache->hits++;
+            log_msg(LOG_LEVEL_DEBUG, " hash cache: use cached hashsums for '%s'", line->filename);
+            return true;
+        }
+    }
+    cache->misses++;
+    return false;
+}
+
+void hash_cache_store(hash_cache *cache, struct stat *fs, db_line *line) {
+    if (cache == NULL) {
+        return;
+    }
+    DB_ATTR_TYPE hashes = 0LLU;
+    for (int i = 0 ; i < num_hashes ; ++i) {
+        if (line->attr&ATTR(hashsums[i].attribute) && line->hashsums[i]) {
+            hashes |= ATTR(hashsums[i].attribute);
+        }
+    }
+    if (!hashes) {
+        return;
+    }
+
+    uint64_t slot = get_slot(cache, fs);
+    hash_cache_entry *entry = NULL;
+    for (int i = 0 ; i < HASH_CACHE_PROBES ; ++i) {
+        hash_cache_entry *candidate = get_entry(cache, (slot + i) % cache_header(cache)->num_entries);
+        if (is_same_file(candidate, fs)) {
+            entry = candidate;
+            /* keep digests of hashsums not calculated this time */
+            hashes |= entry->hashes;
+            break;
+        }
+        if (entry == NULL || (entry->hashes && (!candidate->hashes || candidate->last_used < entry->last_used))) {
+            entry = candidate;
+        }
+    }
+
+    entry->dev = fs->st_dev;
+    entry->ino = fs->st_ino;
+    entry->size = fs->st_size;
+    entry->mtime_sec = fs->st_mtime;
+    entry->mtime_nsec = get_mtime_nsec(fs);
+    entry->ctime_sec = fs->st_ctime;
+    entry->ctime_nsec = get_ctime_nsec(fs);
+    entry->stored = time(NULL);
+    entry->last_used = ++cache_header(cache)->clock;
+    entry->hashes = hashes;
+    for (int i = 0 ; i < num_hashes ; ++i) {
+        if (line->attr&ATTR(hashsums[i].attribute) && line->hashsums[i]) {
+            memcpy(get_digest(entry, i), line->hashsums[i], hashsums[i].length);
+        }
+    }
+    cache->stores++;
+}
+
+void hash_cache_close(hash_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    log_msg(LOG_LEVEL_INFO, "hash cache: %lu hit(s), %lu miss(es), %lu update(s) ('%s')", cache->hits, cache->misses, cache->stores, cache->path);
+    if (msync(cache->map, cache->map_size, MS_SYNC) == -1) {
+        log_msg(LOG_LEVEL_WARNING, "hash cache: msync() failed for '%s': %s", cache->path, strerror(errno));
+    }
+    close_cache(cache);
+}
+
+#endif /* HAVE_MMAP */
@@ -86,6 +86,24 @@ int algorithms[] = { /* order must match hashsums array */
 };
 #endif
 
+#ifdef WITH_AF_ALG
+const char *af_alg_names[] = { /* order must match hashsums array */
+  "md5",
+  "sha1",
+  "sha256",
+  "sha512",
+  "rmd160",
+  NULL, /* tgr192 uses a different byte order */
+  NULL, /* crc32 uses a different seed and byte order */
+  NULL, /* crc32b is not available */
+  NULL, /* haval is not available */
+  "wp512",
+  NULL, /* gostr3411_94 is not available */
+  "streebog256",
+  "streebog512",
+};
+#endif
+
 DB_ATTR_TYPE get_hashes(bool include_unsupported) {
     DB_ATTR_TYPE attr = 0LLU;
     for (int i = 0; i < num_hashes; ++i) {
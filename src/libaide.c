@@ -0,0 +1,675 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 1999-2006, 2010-2013, 2015-2017, 2019-2022 Rami Lehti,
+ *               Pablo Virolainen, Mike Markley, Richard van den Berg,
+ *               Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "attributes.h"
+#include "hashsum.h"
+#include "rx_rule.h"
+#include "url.h"
+#include "commandconf.h"
+#include "report.h"
+#include "db_config.h"
+#include "db_disk.h"
+#include "db.h"
+#include "do_md.h"
+#include "errorcodes.h"
+#include "fs.h"
+#include "gen_list.h"
+#include "hash_cache.h"
+#include "libaide.h"
+#include "log.h"
+#include "seltree.h"
+#include "symboltable.h"
+#include "util.h"
+/*for locale support*/
+#include "locale-aide.h"
+/*for locale support*/
+__thread db_config* conf;
+
+#ifndef MAXHOSTNAMELEN
+#define MAXHOSTNAMELEN 256
+#endif
+
+#ifdef WITH_GCRYPT
+#include <gcrypt.h>
+#define NEED_LIBGCRYPT_VERSION "1.8.0"
+#endif
+
+static bool init_crypto_lib() {
+/* libmhash does not need to be initialized */
+#ifdef WITH_GCRYPT
+  if(!gcry_check_version(NEED_LIBGCRYPT_VERSION)) {
+      log_msg(LOG_LEVEL_ERROR, "libgcrypt is too old (need %s, have %s)", NEED_LIBGCRYPT_VERSION, gcry_check_version (NULL));
+      return false;
+  }
+  gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
+  gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+#endif
+  return true;
+}
+
+static void setdefaults_before_config()
+{
+  DB_ATTR_TYPE X;
+
+  conf=(db_config*)checked_malloc(sizeof(db_config));
+  conf->defsyms=NULL;
+
+  /* Setting some defaults */
+
+  log_msg(LOG_LEVEL_INFO, "initialise rule tree");
+  conf->bulk_build = false;
+  conf->uncompiled_rules = NULL;
+  conf->num_uncompiled_rules = 0;
+  conf->tree=init_tree();
+  conf->disk_walker=NULL;
+  conf->fs=&disk_fs_ops;
+  conf->database_add_metadata=1;
+  conf->database_parallel_read=false;
+  conf->database_dictionary=false;
+  conf->database_prefix_compression=false;
+  conf->database_columnar=false;
+  conf->database_mmap=false;
+  conf->chunk_size=DEFAULT_CHUNK_SIZE;
+  conf->incremental_growing_files=false;
+  conf->rolling_rehash=0;
+  conf->primary_hashsum=0LLU;
+  conf->database_in_checksum=NULL;
+  conf->rule_fingerprints=false;
+  conf->rule_cache=NULL;
+
+  conf->hash_cache=NULL;
+  conf->hash_cache_entries=DEFAULT_HASH_CACHE_ENTRIES;
+  conf->hash_cache_safe_mode=true;
+#ifdef WITH_AF_ALG
+  conf->kernel_crypto=false;
+#endif
+  conf->report_detailed_init=0;
+  conf->report_base16=0;
+  conf->report_quiet=0;
+  conf->report_append=false;
+  conf->report_ignore_added_attrs = 0;
+  conf->report_ignore_removed_attrs = 0;
+  conf->report_ignore_changed_attrs = 0;
+  conf->report_force_attrs = 0;
+#ifdef WITH_E2FSATTRS
+  conf->report_ignore_e2fsattrs = 0UL;
+#endif
+
+  conf->check_path=NULL;
+  conf->check_file_type = FT_REG;
+  conf->check_path_batch = false;
+  conf->check_path_delimiter = '\n';
+
+  conf->report_urls=NULL;
+  conf->report_level=REPORT_LEVEL_CHANGED_ATTRIBUTES;
+
+  conf->config_file=
+#ifdef CONFIG_FILE
+          CONFIG_FILE
+#else
+      NULL
+#endif
+      ;
+  conf->config_version=NULL;
+  conf->config_check_warn_unrestricted_rules = false;
+  
+#ifdef WITH_ACL
+  conf->no_acl_on_symlinks=0; /* zero means don't do ACLs on symlinks */
+#endif
+  conf->db_out_attrs = ATTR(attr_filename)|ATTR(attr_attr)|ATTR(attr_perm)|ATTR(attr_inode);
+
+  conf->symlinks_found=0;
+
+  conf->database_in.url = NULL;
+  conf->database_in.filename=NULL;
+  conf->database_in.linenumber=0;
+  conf->database_in.linebuf=NULL;
+  conf->database_in.fp=NULL;
+#ifdef WITH_ZLIB
+  conf->database_in.gzp = NULL;
+#endif
+  conf->database_in.lineno = 0;
+  conf->database_in.fields = NULL;
+  conf->database_in.num_fields = 0;
+  conf->database_in.attr = 0;
+  conf->database_in.scanner = NULL;
+  conf->database_in.buffer_state = NULL;
+  conf->database_in.mdc = NULL;
+  conf->database_in.mdt = NULL;
+  conf->database_in.db_line = NULL;
+  conf->database_in.raw_lines = false;
+  conf->database_in.dict = NULL;
+  conf->database_in.dict_out = NULL;
+  conf->database_in.path = NULL;
+  conf->database_in.path_len = 0;
+  conf->database_in.path_size = 0;
+  conf->database_in.block = NULL;
+  conf->database_in.read_attrs = 0;
+  conf->database_in.columns = NULL;
+  conf->database_in.num_columns = 0;
+  conf->database_in.block_rows = 0;
+  conf->database_in.map = NULL;
+  conf->database_in.map_size = 0;
+  conf->database_in.map_loaded = false;
+  conf->database_in.view_fields = 0;
+  conf->database_in.capturing = false;
+  conf->database_in.capture_buf = NULL;
+  conf->database_in.capture_len = 0;
+  conf->database_in.capture_size = 0;
+  memset(&conf->database_in.write_stats, 0, sizeof(db_write_stats));
+
+  conf->database_out.url = NULL;
+  conf->database_out.filename=NULL;
+  conf->database_out.linenumber=0;
+  conf->database_out.linebuf=NULL;
+  conf->database_out.fp=NULL;
+#ifdef WITH_ZLIB
+  conf->database_out.gzp = NULL;
+#endif
+  conf->database_out.lineno = 0;
+  conf->database_out.fields = NULL;
+  conf->database_out.num_fields = 0;
+  conf->database_out.attr = 0;
+  conf->database_out.scanner = NULL;
+  conf->database_out.buffer_state = NULL;
+  conf->database_out.mdc = NULL;
+  conf->database_out.mdt = NULL;
+  conf->database_out.db_line = NULL;
+  conf->database_out.raw_lines = false;
+  conf->database_out.dict = NULL;
+  conf->database_out.dict_out = NULL;
+  conf->database_out.path = NULL;
+  conf->database_out.path_len = 0;
+  conf->database_out.path_size = 0;
+  conf->database_out.block = NULL;
+  conf->database_out.read_attrs = 0;
+  conf->database_out.columns = NULL;
+  conf->database_out.num_columns = 0;
+  conf->database_out.block_rows = 0;
+  conf->database_out.map = NULL;
+  conf->database_out.map_size = 0;
+  conf->database_out.map_loaded = false;
+  conf->database_out.view_fields = 0;
+  conf->database_out.capturing = false;
+  conf->database_out.capture_buf = NULL;
+  conf->database_out.capture_len = 0;
+  conf->database_out.capture_size = 0;
+  memset(&conf->database_out.write_stats, 0, sizeof(db_write_stats));
+
+  conf->database_new.url = NULL;
+  conf->database_new.filename=NULL;
+  conf->database_new.linenumber=0;
+  conf->database_new.linebuf=NULL;
+  conf->database_new.fp=NULL;
+#ifdef WITH_ZLIB
+  conf->database_new.gzp = NULL;
+#endif
+  conf->database_new.lineno = 0;
+  conf->database_new.fields = NULL;
+  conf->database_new.num_fields = 0;
+  conf->database_new.attr = 0;
+  conf->database_new.scanner = NULL;
+  conf->database_new.buffer_state = NULL;
+  conf->database_new.mdc = NULL;
+  conf->database_new.mdt = NULL;
+  conf->database_new.db_line = NULL;
+  conf->database_new.raw_lines = false;
+  conf->database_new.dict = NULL;
+  conf->database_new.dict_out = NULL;
+  conf->database_new.path = NULL;
+  conf->database_new.path_len = 0;
+  conf->database_new.path_size = 0;
+  conf->database_new.block = NULL;
+  conf->database_new.read_attrs = 0;
+  conf->database_new.columns = NULL;
+  conf->database_new.num_columns = 0;
+  conf->database_new.block_rows = 0;
+  conf->database_new.map = NULL;
+  conf->database_new.map_size = 0;
+  conf->database_new.map_loaded = false;
+  conf->database_new.view_fields = 0;
+  conf->database_new.capturing = false;
+  conf->database_new.capture_buf = NULL;
+  conf->database_new.capture_len = 0;
+  conf->database_new.capture_size = 0;
+  memset(&conf->database_new.write_stats, 0, sizeof(db_write_stats));
+
+  conf->db_attrs = get_hashes(false);
+  
+#ifdef WITH_ZLIB
+  conf->gzip_dbout=0;
+#endif
+
+  conf->action=0;
+  conf->catch_mmap=0;
+  memset(&conf->hash_stats, 0, sizeof(hash_stats));
+  memset(&conf->rule_stats, 0, sizeof(rule_stats));
+  memset(&conf->scan, 0, sizeof(scan_state));
+
+  conf->warn_dead_symlinks=0;
+
+  conf->report_grouped=1;
+
+  conf->report_summarize_changes=1;
+
+  conf->root_prefix=NULL;
+  conf->root_prefix_length=0;
+
+  conf->limit=NULL;
+  conf->limit_crx=NULL;
+
+  conf->groupsyms=NULL;
+
+  conf->start_time=time(NULL);
+
+  log_msg(LOG_LEVEL_INFO, "define default group definitions");
+
+  for (ATTRIBUTE i = 0 ; i < num_attrs ; ++i) {
+      if (attributes[i].config_name) {
+          do_groupdef(attributes[i].config_name, attributes[i].attr);
+      }
+  }
+
+  X=0LLU;
+#ifdef WITH_ACL
+  X|=ATTR(attr_acl);
+#endif
+#ifdef WITH_SELINUX
+  X|=ATTR(attr_selinux);
+#endif
+#ifdef WITH_XATTR
+  X|=ATTR(attr_xattrs);
+#endif
+#ifdef WITH_E2FSATTRS
+  X|=ATTR(attr_e2fsattrs);
+#endif
+#ifdef WITH_CAPABILITIES
+  X|=ATTR(attr_capabilities);
+#endif
+
+  DB_ATTR_TYPE common_attrs = ATTR(attr_perm)|ATTR(attr_ftype)|ATTR(attr_inode)|ATTR(attr_linkcount)|ATTR(attr_uid)|ATTR(attr_gid);
+
+  DB_ATTR_TYPE GROUP_R_HASHES=0LLU;
+#ifdef WITH_MHASH
+  GROUP_R_HASHES=ATTR(attr_md5);
+#endif
+#ifdef WITH_GCRYPT
+  if (gcry_fips_mode_active()) {
+    char* str;
+    log_msg(LOG_LEVEL_NOTICE, "libgcrypt is running in FIPS mode, the following hash(es) are not available: %s", str = diff_attributes(0, ATTR(attr_md5)));
+    free(str);
+  } else {
+    GROUP_R_HASHES = ATTR(attr_md5);
+  }
+#endif
+
+  do_groupdef("R",common_attrs|ATTR(attr_size)|ATTR(attr_linkname)|ATTR(attr_mtime)|ATTR(attr_ctime)|GROUP_R_HASHES|X);
+  do_groupdef("L",common_attrs|ATTR(attr_linkname)|X);
+  do_groupdef(">",common_attrs|ATTR(attr_sizeg)|ATTR(attr_linkname)|X);
+  do_groupdef("H",get_hashes(false));
+  do_groupdef("X",X);
+  do_groupdef("E",0);
+
+}
+
+static void setdefaults_after_config()
+{
+  int linenumber=1;
+
+#ifdef DEFAULT_DB
+  if(conf->database_in.url==NULL){
+    do_dbdef(DB_TYPE_IN, DEFAULT_DB, linenumber++, "(default)",  NULL);
+  }
+#endif
+#ifdef DEFAULT_DB_OUT
+  if(conf->database_out.url==NULL){
+    do_dbdef(DB_TYPE_OUT, DEFAULT_DB_OUT, linenumber++, "(default)",  NULL);
+  }
+#endif
+
+  if(conf->root_prefix==NULL){
+    do_rootprefix(checked_strdup(""), linenumber++, "(default)",  NULL);
+  }
+
+  if(conf->report_urls==NULL){
+    do_repurldef("stdout" , linenumber++, "(default)",  NULL);
+  }
+
+  if(conf->action==0){
+    conf->action=DO_COMPARE;
+  }
+
+  if (is_log_level_unset()) {
+          set_log_level(LOG_LEVEL_WARNING);
+  };
+}
+
+/* the configuration parser (flex/bison) is not reentrant */
+static pthread_mutex_t config_parser_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t crypto_lib_once = PTHREAD_ONCE_INIT;
+static bool crypto_lib_initialised = false;
+
+static void init_crypto_lib_once(void) {
+  crypto_lib_initialised = init_crypto_lib();
+}
+
+/* 'conf' of the calling thread is the configuration of the context */
+static void bind_context(aide_context *ctx) {
+  conf = ctx->conf;
+}
+
+aide_context *aide_new_context(void) {
+  pthread_once(&crypto_lib_once, init_crypto_lib_once);
+  if (!crypto_lib_initialised) {
+    return NULL;
+  }
+  aide_context *ctx = checked_malloc(sizeof(aide_context));
+  setdefaults_before_config();
+  ctx->conf = conf;
+  return ctx;
+}
+
+int aide_parse_config(aide_context *ctx, char *before, char *config_file, char *after) {
+  bind_context(ctx);
+
+  /* get hostname */
+  conf->hostname = checked_malloc(sizeof(char) * MAXHOSTNAMELEN + 1);
+  if (gethostname(conf->hostname,MAXHOSTNAMELEN) == -1) {
+      log_msg(LOG_LEVEL_WARNING,"gethostname failed: %s", strerror(errno));
+      free(conf->hostname);
+      conf->hostname = NULL;
+  } else {
+      log_msg(LOG_LEVEL_DEBUG, "hostname: '%s'", conf->hostname);
+  }
+
+  log_msg(LOG_LEVEL_INFO, "parse configuration");
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_mutex_lock(&config_parser_mutex);
+  int parse_result = parse_config(before, config_file, after);
+  pthread_mutex_unlock(&config_parser_mutex);
+  if (parse_result==RETFAIL){
+    return INVALID_CONFIGURELINE_ERROR;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  conf->rule_stats.load_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  setdefaults_after_config();
+
+  log_msg(LOG_LEVEL_CONFIG, "report_urls:");
+  log_report_urls(LOG_LEVEL_CONFIG);
+
+  log_msg(LOG_LEVEL_RULE, "rule tree:");
+  log_tree(LOG_LEVEL_RULE, conf->tree, 0);
+
+  return RETOK;
+}
+
+int aide_scan(aide_context *ctx) {
+  bind_context(ctx);
+  memset(&conf->hash_stats, 0, sizeof(hash_stats));
+
+  /* Let's do some sanity checks for the config */
+  if (conf->action&(DO_DIFF|DO_COMPARE) && !(conf->database_in.url)) {
+    log_msg(LOG_LEVEL_ERROR,_("missing 'database_in', config option is required"));
+    return INVALID_ARGUMENT_ERROR;
+  }
+  if (conf->action&DO_INIT && !(conf->database_out.url)) {
+    log_msg(LOG_LEVEL_ERROR,_("missing 'database_out', config option is required"));
+    return INVALID_ARGUMENT_ERROR;
+  }
+  if(conf->database_in.url && conf->database_out.url && cmpurl(conf->database_in.url,conf->database_out.url)==RETOK){
+      log_msg(LOG_LEVEL_NOTICE, "input and output database URLs are the same: '%s'", (conf->database_in.url)->value);
+    if((conf->action&DO_INIT)&&(conf->action&DO_COMPARE)){
+      log_msg(LOG_LEVEL_ERROR,_("input and output database urls cannot be the same "
+	    "when doing database update"));
+      return INVALID_ARGUMENT_ERROR;
+    }
+    if(conf->action&DO_DIFF){
+      log_msg(LOG_LEVEL_ERROR,_("both input databases cannot be the same "
+		"when doing database compare"));
+      return INVALID_ARGUMENT_ERROR;
+    }
+  };
+  if((conf->action&DO_DIFF)&&(!(conf->database_new.url)||!(conf->database_in.url))){
+    log_msg(LOG_LEVEL_ERROR,_("must have both input databases defined for "
+	      "database compare"));
+    return INVALID_ARGUMENT_ERROR;
+  }
+
+  /* ensure size attribute is added to db_out_attrs if sizeg attribute is set */
+  if (conf->db_out_attrs & ATTR(attr_sizeg)) {
+        conf->db_out_attrs |=ATTR(attr_size);
+  }
+
+  /* rolling re-hash records the time of the last hashsum calculation */
+  if (conf->rolling_rehash) {
+        conf->db_out_attrs |=ATTR(attr_verified);
+  }
+
+  /* --update-config needs the fingerprints in the next run */
+  if (conf->rule_fingerprints || conf->action&DO_CONFIG_UPDATE) {
+        conf->db_out_attrs |=ATTR(attr_rule);
+  }
+
+  if (conf->action&DO_INIT && conf->action&DO_DRY_RUN) {
+      if(db_disk_init()==RETFAIL) {
+          return IO_ERROR;
+      }
+      log_msg(LOG_LEVEL_INFO, "populate tree (dry-run)");
+      populate_tree(conf->tree, true);
+      log_rule_stats(LOG_LEVEL_INFO);
+      return RETOK;
+  }
+
+  if (!(conf->action&DO_DRY_RUN)) {
+
+  if (!init_report_urls()) {
+      return INVALID_CONFIGURELINE_ERROR;
+  }
+
+  if (conf->action&(DO_INIT|DO_COMPARE) && conf->root_prefix_length > 0) {
+      DIR *dir;
+      if((dir = opendir(conf->root_prefix)) != NULL) {
+          closedir(dir);
+      } else {
+          log_msg(LOG_LEVEL_ERROR,"opendir() for root_prefix %s failed: %s", conf->root_prefix, strerror(errno));
+          return INVALID_CONFIGURELINE_ERROR;
+      }
+  }
+    if(conf->action&DO_INIT){
+      if(db_init(&(conf->database_out), false,
+#ifdef WITH_ZLIB
+        conf->gzip_dbout
+#else
+        false
+#endif
+       ) == RETFAIL) {
+	return IO_ERROR;
+      }
+      if(db_writespec(conf)==RETFAIL){
+	log_msg(LOG_LEVEL_ERROR,_("Error while writing database. Exiting.."));
+	return IO_ERROR;
+      }
+    }
+    if((conf->action&DO_INIT)||(conf->action&DO_COMPARE)){
+      if(db_disk_init()==RETFAIL)
+	return IO_ERROR;
+    }
+    if((conf->action&DO_COMPARE)||(conf->action&DO_DIFF)){
+      if(db_init(&(conf->database_in), true, false)==RETFAIL)
+	return IO_ERROR;
+    }
+    if(conf->action&DO_DIFF){
+      if(db_init(&(conf->database_new), true, false)==RETFAIL)
+	return IO_ERROR;
+    }
+      
+#ifdef HAVE_MMAP
+    if (conf->hash_cache && conf->action&(DO_INIT|DO_COMPARE)) {
+        conf->scan.hash_cache = hash_cache_open(conf->hash_cache, conf->hash_cache_entries, conf->hash_cache_safe_mode);
+    }
+#endif
+
+    log_msg(LOG_LEVEL_INFO, "populate tree");
+    populate_tree(conf->tree, false);
+
+#ifdef HAVE_MMAP
+    hash_cache_close(conf->scan.hash_cache);
+    conf->scan.hash_cache = NULL;
+#endif
+#ifdef WITH_PRELINK
+    close_prelink_helper();
+#endif
+    log_hash_stats(LOG_LEVEL_INFO);
+    log_rule_stats(LOG_LEVEL_INFO);
+
+    if(conf->action&DO_INIT) {
+        log_msg(LOG_LEVEL_INFO, "write new entries to database: %s:%s", get_url_type_string((conf->database_out.url)->type), (conf->database_out.url)->value);
+        write_tree(conf->tree);
+    }
+
+    db_close();
+  }
+  return RETOK;
+}
+
+static void free_symbols(list *symbols, bool values) {
+  while (symbols) {
+    symba *s = symbols->data;
+    free(s->name);
+    if (values) {
+      free(s->value);
+    }
+    free(s);
+    symbols = list_delete_item(symbols);
+  }
+}
+
+static void free_tree_entries(seltree *node) {
+  if (node->new_data != node->old_data) {
+    free_db_line(node->new_data);
+    free(node->new_data);
+  }
+  free_db_line(node->old_data);
+  free(node->old_data);
+  for (list *l = node->childs ; l ; l = l->next) {
+    free_tree_entries(l->data);
+  }
+}
+
+void aide_free_context(aide_context *ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  bind_context(ctx);
+
+  db_disk_free();
+  free_tree_entries(conf->tree);
+  free_tree(conf->tree);
+  while (conf->uncompiled_rules) {
+    conf->uncompiled_rules = list_delete_item(conf->uncompiled_rules);
+  }
+
+  db_free(&conf->database_in);
+  db_free(&conf->database_out);
+  db_free(&conf->database_new);
+  free_report_urls();
+
+#ifdef HAVE_MMAP
+  hash_cache_close(conf->scan.hash_cache);
+#endif
+#ifdef WITH_PRELINK
+  close_prelink_helper();
+#endif
+  free_hardlink_hashsums();
+  free(conf->scan.zero_buffer);
+  free(conf->scan.rehash_threshold);
+
+  free_symbols(conf->defsyms, true);
+  free_symbols(conf->groupsyms, false);
+
+  free(conf->hostname);
+  free(conf->check_path);
+  free(conf->config_version);
+  free(conf->database_in_checksum);
+  free(conf->rule_cache);
+  free(conf->hash_cache);
+  free(conf->root_prefix);
+  free(conf->limit);
+  pcre2_code_free(conf->limit_crx);
+
+  free(conf);
+  conf = NULL;
+  free(ctx);
+}
+
+static void foreach_result(seltree *node, aide_result_callback callback, void *data) {
+  aide_result result = { 0, node->old_data, node->new_data, 0LLU, (node->checked&NODE_CONFIG_CHANGED) != 0 };
+
+  if ((node->checked&(DB_OLD|DB_NEW)) == DB_NEW) {
+    if (conf->action&DO_INIT || !(node->checked&(NODE_ALLOW_NEW|NODE_MOVED_IN))) {
+      result.status = NODE_ADDED;
+    }
+  } else if ((node->checked&(DB_OLD|DB_NEW)) == DB_OLD) {
+    if (!(node->checked&(NODE_ALLOW_RM|NODE_MOVED_OUT))) {
+      result.status = NODE_REMOVED;
+    }
+  } else if (node->checked&DB_OLD && node->old_data && node->new_data
+          && !(node->checked&(NODE_MOVED_IN|NODE_MOVED_OUT)) && node->changed_attrs) {
+    result.status = NODE_CHANGED;
+    result.changed_attrs = node->changed_attrs;
+  }
+  if (result.status) {
+    callback(&result, data);
+  }
+  for (list *l = node->childs ; l ; l = l->next) {
+    foreach_result(l->data, callback, data);
+  }
+}
+
+void aide_foreach_result(aide_context *ctx, aide_result_callback callback, void *data) {
+  bind_context(ctx);
+  foreach_result(conf->tree, callback, data);
+}
+
+int aide_report(aide_context *ctx) {
+  bind_context(ctx);
+  return gen_report(conf->tree);
+}
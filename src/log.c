@@ -24,6 +24,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "log.h"
 #include "util.h"
@@ -38,6 +39,10 @@ typedef struct log_cache {
 
 log_cache *cached_lines = NULL;
 int ncachedlines = 0;
+static int cached_lines_size = 0;
+
+/* log_msg() is called from the reader and hashing threads, too */
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 struct log_level {
     LOG_LEVEL log_level;
@@ -60,7 +65,10 @@ static struct log_level log_level_array[] = {
 static void cache_line(LOG_LEVEL level, const char* format, va_list ap) {
     int n;
 
-    cached_lines = checked_realloc(cached_lines, (ncachedlines+1) * sizeof(log_cache)); /* freed in log_cached_lines() */
+    if (ncachedlines == cached_lines_size) {
+        cached_lines_size = cached_lines_size?2*cached_lines_size:64;
+        cached_lines = checked_realloc(cached_lines, cached_lines_size * sizeof(log_cache)); /* freed in log_cached_lines() */
+    }
 
     cached_lines[ncachedlines].level = level;
     cached_lines[ncachedlines].message = NULL;
@@ -85,12 +93,15 @@ static void log_cached_lines(void) {
         free(cached_lines[i].message);
     }
     ncachedlines = 0;
+    cached_lines_size = 0;
     free(cached_lines);
+    cached_lines = NULL;
 }
 
 static void vlog_msg(LOG_LEVEL level,const char* format, va_list ap) {
     FILE* url = stderr;
 
+    pthread_mutex_lock(&log_mutex);
     if (level == LOG_LEVEL_ERROR || level <= log_level) {
         fprintf(url, "%s: ", log_level_array[level-1].log_string );
         vfprintf(url, format, ap);
@@ -98,6 +109,7 @@ static void vlog_msg(LOG_LEVEL level,const char* format, va_list ap) {
     } else if (log_level == LOG_LEVEL_UNSET) {
         cache_line(level, format, ap);
     }
+    pthread_mutex_unlock(&log_mutex);
 }
 
 bool is_log_level_unset() {
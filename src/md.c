@@ -20,6 +20,7 @@
  */
 
 #include "config.h"
+#include "aide.h"
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -39,6 +40,78 @@
 #include <gcrypt.h>
 #endif
 
+#ifdef WITH_AF_ALG
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/if_alg.h>
+
+#ifndef AF_ALG
+#define AF_ALG 38
+#endif
+
+/* bytes moved through the pipe per splice(2) call (default pipe capacity) */
+#define SPLICE_BLOCK_SIZE 65536
+
+/*
+  Bound AF_ALG sockets per hashsum, set up on first use
+  -2: not yet tried, -1: not supported by the kernel
+  The set up is guarded by alg_tfm_mutex, as the chunk digests may be
+  calculated on several threads (see calc_chunks_parallel()).
+ */
+static int alg_tfm[num_hashes] = { [0 ... num_hashes-1] = -2 };
+static pthread_mutex_t alg_tfm_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int get_alg_tfm(HASHSUM i) {
+    pthread_mutex_lock(&alg_tfm_mutex);
+    if (alg_tfm[i] == -2) {
+        alg_tfm[i] = -1;
+        if (af_alg_names[i]) {
+            struct sockaddr_alg sa = { .salg_family = AF_ALG, .salg_type = "hash" };
+            strncpy((char *) sa.salg_name, af_alg_names[i], sizeof(sa.salg_name)-1);
+            int fd = socket(AF_ALG, SOCK_SEQPACKET|SOCK_CLOEXEC, 0);
+            if (fd == -1) {
+                log_msg(LOG_LEVEL_DEBUG, "AF_ALG: socket() failed: %s (use %s for '%s')", strerror(errno), "library", attributes[hashsums[i].attribute].db_name);
+            } else if (bind(fd, (struct sockaddr *) &sa, sizeof(sa)) == -1) {
+                log_msg(LOG_LEVEL_DEBUG, "AF_ALG: bind() failed for '%s': %s (use %s for '%s')", af_alg_names[i], strerror(errno), "library", attributes[hashsums[i].attribute].db_name);
+                close(fd);
+            } else {
+                log_msg(LOG_LEVEL_DEBUG, "AF_ALG: use kernel crypto API (%s) for '%s'", af_alg_names[i], attributes[hashsums[i].attribute].db_name);
+                alg_tfm[i] = fd;
+            }
+        }
+    }
+    int tfm = alg_tfm[i];
+    pthread_mutex_unlock(&alg_tfm_mutex);
+    return tfm;
+}
+
+static int send_all(int fd, void* data, ssize_t size) {
+    while (size > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(send(fd, data, size, MSG_MORE));
+        if (n < 0) {
+            return RETFAIL;
+        }
+        data = (char *) data + n;
+        size -= n;
+    }
+    return RETOK;
+}
+
+static int splice_all(int from, int to, size_t size) {
+    while (size > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(splice(from, NULL, to, NULL, size, SPLICE_F_MORE));
+        if (n <= 0) {
+            return RETFAIL;
+        }
+        size -= n;
+    }
+    return RETOK;
+}
+#endif
+
 /*
   Initialise md_container according its todo_attr field
  */
@@ -55,10 +128,29 @@ int init_md(struct md_container* md, const char *filename) {
     We don't have calculator for this yet :)
   */
   md->calc_attr=0;
+  /* hashsums left to the library */
+  DB_ATTR_TYPE todo_attr = md->todo_attr;
+#ifdef WITH_AF_ALG
+   md->kernel_attr=0;
+   for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
+       DB_ATTR_TYPE h = ATTR(hashsums[i].attribute);
+       md->alg_fd[i] = -1;
+       if (conf->kernel_crypto && h&todo_attr&get_hashes(false) && get_alg_tfm(i) >= 0) {
+           md->alg_fd[i] = accept4(alg_tfm[i], NULL, 0, SOCK_CLOEXEC);
+           if (md->alg_fd[i] >= 0) {
+               md->kernel_attr|=h;
+               md->calc_attr|=h;
+               todo_attr&=~h;
+           } else {
+               log_msg(LOG_LEVEL_DEBUG, "%s: AF_ALG accept() (%s) failed for '%s': %s", filename, attributes[hashsums[i].attribute].db_name, filename, strerror(errno));
+           }
+       }
+   }
+#endif
 #ifdef WITH_MHASH
    for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
        DB_ATTR_TYPE h = ATTR(hashsums[i].attribute);
-       if (h&md->todo_attr) {
+       if (h&todo_attr) {
            md->mhash_mdh[i]=mhash_init(algorithms[i]);
            if (md->mhash_mdh[i]!=MHASH_FAILED) {
                md->calc_attr|=h;
@@ -79,7 +171,7 @@ int init_md(struct md_container* md, const char *filename) {
 
    for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
         DB_ATTR_TYPE h = ATTR(hashsums[i].attribute);
-            if (h&md->todo_attr) {
+            if (h&todo_attr) {
                 if(gcry_md_enable(md->mdh,algorithms[i])==GPG_ERR_NO_ERROR){
                     md->calc_attr|=h;
                 } else {
@@ -118,10 +210,93 @@ int update_md(struct md_container* md,void* data,ssize_t size) {
 #endif /* WITH_MHASH */
 #ifdef WITH_GCRYPT
 	gcry_md_write(md->mdh, data, size);
+#endif
+#ifdef WITH_AF_ALG
+  for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
+      if(md->alg_fd[i] >= 0 && send_all(md->alg_fd[i], data, size) != RETOK) {
+          log_msg(LOG_LEVEL_WARNING, "AF_ALG: send() (%s) failed: %s", attributes[hashsums[i].attribute].db_name, strerror(errno));
+          return RETFAIL;
+      }
+  }
 #endif
   return RETOK;
 }
 
+#ifdef WITH_AF_ALG
+/*
+  Feed the data of fd to the kernel without copying it to user space.
+  Only usable if all hashsums of the md containers are calculated by the
+  kernel (containers without any hashsum are skipped).
+  The file data is spliced into a pipe and tee'd to one pipe per
+  additional AF_ALG socket, each pipe is then spliced into its socket.
+  At most len bytes are read (len < 0: up to EOF). If offset is not NULL,
+  the data is read from *offset (which is advanced) and the file position
+  of fd is not changed.
+  size is set to the number of bytes read from fd.
+ */
+
+int splice_md(struct md_container* mds[], int num_mds, int fd, off_t* offset, off_t len, off_t* size) {
+  int sockets[num_mds*num_hashes];
+  int pipes[num_mds*num_hashes][2];
+  int n_sockets = 0;
+  int n_pipes = 0;
+  int ret = RETOK;
+
+  *size = 0;
+  for (int m = 0 ; m < num_mds ; ++m) {
+      if (mds[m]->kernel_attr != mds[m]->calc_attr) {
+          return RETFAIL;
+      }
+      for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
+          if (mds[m]->alg_fd[i] >= 0) {
+              sockets[n_sockets++] = mds[m]->alg_fd[i];
+          }
+      }
+  }
+  if (n_sockets == 0) {
+      return RETFAIL;
+  }
+  for (int p = 0 ; p < n_sockets ; ++p) {
+      if (pipe2(pipes[p], O_CLOEXEC) == -1) {
+          ret = RETFAIL;
+          break;
+      }
+      n_pipes++;
+  }
+  while (ret == RETOK && (len < 0 || *size < len)) {
+      size_t block = len < 0 || len - *size > SPLICE_BLOCK_SIZE ? SPLICE_BLOCK_SIZE : (size_t) (len - *size);
+      loff_t off = offset ? *offset : 0;
+      ssize_t n = TEMP_FAILURE_RETRY(splice(fd, offset ? &off : NULL, pipes[0][1], NULL, block, SPLICE_F_MORE));
+      if (n <= 0) {
+          ret = n ? RETFAIL : RETOK;
+          break;
+      }
+      if (offset) {
+          *offset = off;
+      }
+      for (int p = 1 ; p < n_sockets && ret == RETOK ; ++p) {
+          /* duplicate the pipe buffer references, no data is copied */
+          ssize_t t = TEMP_FAILURE_RETRY(tee(pipes[0][0], pipes[p][1], n, 0));
+          if (t != n || splice_all(pipes[p][0], sockets[p], n) != RETOK) {
+              ret = RETFAIL;
+          }
+      }
+      if (ret == RETOK && splice_all(pipes[0][0], sockets[0], n) != RETOK) {
+          ret = RETFAIL;
+      }
+      *size += n;
+  }
+  if (ret != RETOK) {
+      log_msg(LOG_LEVEL_DEBUG, "AF_ALG: splice() failed: %s", strerror(errno));
+  }
+  for (int p = 0 ; p < n_pipes ; ++p) {
+      close(pipes[p][0]);
+      close(pipes[p][1]);
+  }
+  return ret;
+}
+#endif
+
 /*
   close.. Does some magic.
   After this calling update_db is not a good idea.
@@ -145,12 +320,16 @@ int close_md(struct md_container* md) {
   gcry_md_final(md->mdh); 
 
   for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
-      if (md->calc_attr&ATTR(hashsums[i].attribute)) {
+      if (md->calc_attr&ATTR(hashsums[i].attribute)
+#ifdef WITH_AF_ALG
+              && !(md->kernel_attr&ATTR(hashsums[i].attribute))
+#endif
+         ) {
           memcpy(md->hashsums[i],gcry_md_read(md->mdh, algorithms[i]), hashsums[i].length);
       }
   }
 
-  gcry_md_reset(md->mdh);
+  gcry_md_close(md->mdh);
 #endif  
 
 #ifdef WITH_MHASH
@@ -160,7 +339,24 @@ int close_md(struct md_container* md) {
       }
   }
 #endif
+#ifdef WITH_AF_ALG
+  int ret = RETOK;
+  for (HASHSUM i = 0 ; i < num_hashes ; ++i) {
+      if(md->alg_fd[i] >= 0) {
+          /* read(2) finishes the hash operation */
+          if (TEMP_FAILURE_RETRY(read(md->alg_fd[i], md->hashsums[i], hashsums[i].length)) != hashsums[i].length) {
+              log_msg(LOG_LEVEL_WARNING, "AF_ALG: read() (%s) failed: %s", attributes[hashsums[i].attribute].db_name, strerror(errno));
+              md->calc_attr&=~ATTR(hashsums[i].attribute);
+              ret = RETFAIL;
+          }
+          close(md->alg_fd[i]);
+          md->alg_fd[i] = -1;
+      }
+  }
+  return ret;
+#else
   return RETOK;
+#endif
 }
 
 /*
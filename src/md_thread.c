@@ -0,0 +1,152 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "aide.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "md.h"
+#include "md_thread.h"
+#include "util.h"
+
+struct md_thread {
+    struct md_container *mdc;
+    pthread_t thread;
+
+    char *blocks; /* MD_THREAD_NUM_BLOCKS blocks of MD_THREAD_BLOCK_SIZE bytes */
+    size_t lengths[MD_THREAD_NUM_BLOCKS];
+
+    /* protected by mutex */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned long head; /* number of hashed blocks */
+    unsigned long tail; /* number of filled blocks */
+    bool done;
+
+    /* owned by the producer */
+    size_t fill; /* bytes in the current block (tail) */
+    unsigned long long num_bytes;
+};
+
+static char *get_block(md_thread *t, unsigned long n) {
+    return t->blocks + (n % MD_THREAD_NUM_BLOCKS) * MD_THREAD_BLOCK_SIZE;
+}
+
+static void *hash_blocks(void *arg) {
+    md_thread *t = arg;
+
+    pthread_mutex_lock(&t->mutex);
+    while (true) {
+        while (t->head == t->tail && !t->done) {
+            pthread_cond_wait(&t->cond, &t->mutex);
+        }
+        if (t->head == t->tail) {
+            break;
+        }
+        unsigned long n = t->head;
+        pthread_mutex_unlock(&t->mutex);
+
+        /* the producer does not touch a filled block until it is hashed */
+        update_md(t->mdc, get_block(t, n), t->lengths[n % MD_THREAD_NUM_BLOCKS]);
+
+        pthread_mutex_lock(&t->mutex);
+        t->head++;
+        pthread_cond_broadcast(&t->cond);
+    }
+    pthread_mutex_unlock(&t->mutex);
+    return NULL;
+}
+
+md_thread *md_thread_start(struct md_container *mdc) {
+    md_thread *t = checked_malloc(sizeof(md_thread));
+    t->mdc = mdc;
+    t->blocks = checked_malloc(MD_THREAD_NUM_BLOCKS * MD_THREAD_BLOCK_SIZE);
+    t->head = 0;
+    t->tail = 0;
+    t->done = false;
+    t->fill = 0;
+    t->num_bytes = 0;
+    pthread_mutex_init(&t->mutex, NULL);
+    pthread_cond_init(&t->cond, NULL);
+
+    int err = pthread_create(&t->thread, NULL, hash_blocks, t);
+    if (err) {
+        log_msg(LOG_LEVEL_WARNING, "md thread: pthread_create() failed: %s (hash on the calling thread)", strerror(err));
+        pthread_cond_destroy(&t->cond);
+        pthread_mutex_destroy(&t->mutex);
+        free(t->blocks);
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+static void push_block(md_thread *t) {
+    pthread_mutex_lock(&t->mutex);
+    t->lengths[t->tail % MD_THREAD_NUM_BLOCKS] = t->fill;
+    t->tail++;
+    pthread_cond_broadcast(&t->cond);
+    /* wait for a free block */
+    while (t->tail - t->head == MD_THREAD_NUM_BLOCKS) {
+        pthread_cond_wait(&t->cond, &t->mutex);
+    }
+    pthread_mutex_unlock(&t->mutex);
+    t->fill = 0;
+}
+
+void md_thread_update(md_thread *t, const void *data, size_t size) {
+    const char *p = data;
+    t->num_bytes += size;
+    while (size) {
+        size_t n = MD_THREAD_BLOCK_SIZE - t->fill;
+        if (n > size) {
+            n = size;
+        }
+        memcpy(get_block(t, t->tail) + t->fill, p, n);
+        t->fill += n;
+        p += n;
+        size -= n;
+        if (t->fill == MD_THREAD_BLOCK_SIZE) {
+            push_block(t);
+        }
+    }
+}
+
+void md_thread_finish(md_thread *t) {
+    if (t->fill) {
+        push_block(t);
+    }
+    pthread_mutex_lock(&t->mutex);
+    t->done = true;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->mutex);
+    pthread_join(t->thread, NULL);
+    log_msg(LOG_LEVEL_DEBUG, "md thread: hashed %llu bytes", t->num_bytes);
+    pthread_cond_destroy(&t->cond);
+    pthread_mutex_destroy(&t->mutex);
+    free(t->blocks);
+    free(t);
+}
@@ -67,11 +67,6 @@ const int width_details = 80;
 const char time_format[] = "%Y-%m-%d %H:%M:%S %z";
 const int time_string_len = 26;
 
-#ifdef WITH_AUDIT
-long nadd, nrem, nchg = 0;
-#endif
-int added_entries_reported, removed_entries_reported, changed_entries_reported = 0;
-
 const char* report_top_format = "\n\n---------------------------------------------------\n%s:\n---------------------------------------------------\n";
 
 const ATTRIBUTE report_attrs_order[] = {
@@ -109,7 +104,7 @@ int report_attrs_order_length = sizeof(report_attrs_order)/sizeof(ATTRIBUTE);
 
 static DB_ATTR_TYPE get_attrs(ATTRIBUTE attr) {
     switch(attr) {
-        case attr_allhashsums: return get_hashes(true);
+        case attr_allhashsums: return get_hashes(true)|ATTR(attr_chunks)|ATTR(attr_fsverity);
         case attr_size: return ATTR(attr_size)|ATTR(attr_sizeg);
         default: return ATTR(attr);
     }
@@ -243,6 +238,23 @@ static int acl2array(acl_type* acl, char* **values) {
 }
 #endif
 
+static int chunks2array(chunks_type* chunks, char* **values) {
+    *values = checked_malloc(1 * sizeof(char*));
+    if (chunks==NULL) {
+        (*values)[0] = checked_strdup("num=0");
+    } else {
+        int length = snprintf(NULL, 0, "num=%zu, size=%lld", chunks->num, chunks->chunk_size) + 1;
+        (*values)[0] = checked_malloc(length * sizeof(char));
+        snprintf((*values)[0], length, "num=%zu, size=%lld", chunks->num, chunks->chunk_size);
+    }
+    return 1;
+}
+
+static bool is_chunk_equal(chunks_type* o, chunks_type* n, size_t i) {
+    int len = hashsums[CHUNK_HASHSUM].length;
+    return i < o->num && i < n->num && memcmp(&o->digests[i*len], &n->digests[i*len], len) == 0;
+}
+
 static char* get_file_type_string(mode_t mode) {
     switch (mode & S_IFMT) {
         case S_IFREG: return _("File");
@@ -469,6 +481,21 @@ bool init_report_urls() {
     }
     return true;
 }
+
+void free_report_urls() {
+    while (conf->report_urls) {
+        report_t* r = conf->report_urls->data;
+        if (r->fd && r->fd != stdout && r->fd != stderr) {
+            fclose(r->fd);
+        }
+        free(r->url->value);
+        free(r->url);
+        free(r->linebuf);
+        free(r);
+        conf->report_urls = list_delete_item(conf->report_urls);
+    }
+}
+
 static char* byte_to_base16(byte* src, size_t ssize) {
     char* str = checked_malloc((2*ssize+1) * sizeof (char));
     size_t i;
@@ -478,6 +505,29 @@ static char* byte_to_base16(byte* src, size_t ssize) {
     return str;
 }
 
+static const char* get_fsverity_algorithm_string(int algorithm) {
+    switch (algorithm) {
+        case 1: return "sha256"; /* FS_VERITY_HASH_ALG_SHA256 */
+        case 2: return "sha512"; /* FS_VERITY_HASH_ALG_SHA512 */
+        default: return "unknown";
+    }
+}
+
+static int fsverity2array(fsverity_type* fsverity, bool base16, char* **values) {
+    *values = checked_malloc(1 * sizeof(char*));
+    if (fsverity==NULL) {
+        (*values)[0] = checked_strdup("none");
+    } else {
+        char *digest = base16?byte_to_base16(fsverity->digest, fsverity->length):encode_base64(fsverity->digest, fsverity->length);
+        const char *algorithm = get_fsverity_algorithm_string(fsverity->algorithm);
+        int length = snprintf(NULL, 0, "%s:%s", algorithm, digest) + 1;
+        (*values)[0] = checked_malloc(length * sizeof(char));
+        snprintf((*values)[0], length, "%s:%s", algorithm, digest);
+        free(digest);
+    }
+    return 1;
+}
+
 static int get_attribute_values(DB_ATTR_TYPE attr, db_line* line,
         char* **values, report_t* r) {
 
@@ -494,8 +544,9 @@ snprintf(*values[0], l, "%s",s);
 
 #define easy_time(a,b) \
 } else if (a&attr) { \
+    struct tm tm; \
     *values[0] = checked_malloc(time_string_len * sizeof (char));  \
-    strftime(*values[0], time_string_len, time_format, localtime(&(line->b)));
+    strftime(*values[0], time_string_len, time_format, localtime_r(&(line->b), &tm));
 
     if (line==NULL || !(line->attr&attr)) {
         *values = NULL;
@@ -508,6 +559,10 @@ snprintf(*values[0], l, "%s",s);
     } else if (ATTR(attr_xattrs)&attr) {
         return xattrs2array(line->xattrs, values);
 #endif
+    } else if (ATTR(attr_chunks)&attr) {
+        return chunks2array(line->chunks, values);
+    } else if (ATTR(attr_fsverity)&attr) {
+        return fsverity2array(line->fsverity, r->base16, values);
     } else {
         int l;
         *values = checked_malloc(1 * sizeof (char*));
@@ -628,6 +683,9 @@ if ((conf->action&(DO_COMPARE|DO_DIFF) || (conf->action&DO_INIT && r->detailed_i
         } else if (node->checked&NODE_CHANGED) {
             report_printf(r,_("\nchanged: %s"),(node->new_data)->filename);
         }
+    }
+    if (node->checked&NODE_CONFIG_CHANGED) {
+        report_printf(r,_(" (config changed)"));
     }
             }
         } else {
@@ -674,6 +732,38 @@ static void print_attribute(REPORT_LEVEL report_level, db_line* oline, db_line*
 }
 
 
+/* print the byte ranges of the chunks which differ between old and new entry */
+static void print_changed_chunk_ranges(report_t *r, db_line* oline, db_line* nline) {
+    chunks_type *o = oline->chunks, *n = nline->chunks;
+    if (o == NULL || n == NULL || o->chunk_size != n->chunk_size) {
+        return;
+    }
+    size_t num = o->num > n->num ? o->num : n->num;
+    /* the last range ends at the end of the larger file (if the sizes are known) */
+    long long file_size = -1;
+    if (oline->attr&(ATTR(attr_size)|ATTR(attr_sizeg)) && nline->attr&(ATTR(attr_size)|ATTR(attr_sizeg))) {
+        file_size = oline->size > nline->size ? oline->size : nline->size;
+    }
+    size_t i = 0, start;
+    bool first = true;
+    while (i < num) {
+        if (is_chunk_equal(o, n, i)) {
+            ++i;
+            continue;
+        }
+        start = i;
+        while (i < num && !is_chunk_equal(o, n, i)) {
+            ++i;
+        }
+        long long end = (long long) i * o->chunk_size - 1;
+        if (file_size > 0 && end > file_size - 1) {
+            end = file_size - 1;
+        }
+        report_printf(r, " %-*s%c bytes %lld-%lld\n", MAX_WIDTH_DETAILS_STRING, first?"Changed":"", first?':':' ', (long long) start * o->chunk_size, end);
+        first = false;
+    }
+}
+
 static void print_dbline_attributes(REPORT_LEVEL report_level, db_line* oline, db_line* nline, DB_ATTR_TYPE attrs, bool force) {
     DB_ATTR_TYPE report_attrs, added_attrs, removed_attrs, changed_attrs, forced_attrs;
     list* l = NULL;
@@ -711,6 +801,11 @@ static void print_dbline_attributes(REPORT_LEVEL report_level, db_line* oline, d
                 for (int i = 0 ; i < num_hashes ; ++i) {
                     print_attribute(report_level, oline, nline, ATTR(hashsums[i].attribute), r, attributes[hashsums[i].attribute].details_string, report_attrs, added_attrs, removed_attrs);
                 }
+                print_attribute(report_level, oline, nline, ATTR(attr_chunks), r, attributes[attr_chunks].details_string, report_attrs, added_attrs, removed_attrs);
+                if (oline && nline && ATTR(attr_chunks)&changed_attrs && r->level >= report_level) {
+                    print_changed_chunk_ranges(r, oline, nline);
+                }
+                print_attribute(report_level, oline, nline, ATTR(attr_fsverity), r, attributes[attr_fsverity].details_string, report_attrs, added_attrs, removed_attrs);
                 break;
             case attr_size:
                 print_attribute(report_level, oline, nline, ATTR(attr_size), r, attributes[attr_size].details_string, report_attrs, added_attrs, removed_attrs);
@@ -751,7 +846,7 @@ static void terse_report(seltree* node) {
             /* unless it was moved in */
             if ( (conf->action&DO_INIT && r->detailed_init) || (conf->action&(DO_COMPARE|DO_DIFF) && !((node->checked&NODE_ALLOW_NEW)||(node->checked&NODE_MOVED_IN))) ) {
 #ifdef WITH_AUDIT
-                nadd++;
+                conf->scan.nadd++;
 #endif
                 r->nadd++;
                 node->checked|=NODE_ADDED;
@@ -761,7 +856,7 @@ static void terse_report(seltree* node) {
             /* unless it was moved out */
             if (!((node->checked&NODE_ALLOW_RM)||(node->checked&NODE_MOVED_OUT))) {
 #ifdef WITH_AUDIT
-                nrem++;
+                conf->scan.nrem++;
 #endif
                 r->nrem++;
                 node->checked|=NODE_REMOVED;
@@ -770,7 +865,7 @@ static void terse_report(seltree* node) {
             /* File is in both db's and the data is still there. (CHANGED) */
             if (!(node->checked&(NODE_MOVED_IN|NODE_MOVED_OUT))){
                 if (r->level >= REPORT_LEVEL_LIST_ENTRIES
-                  && (node->old_data->attr&~(r->ignore_removed_attrs))^(node->new_data->attr&~(r->ignore_added_attrs)) ) {
+                  && ((node->old_data->attr&~(r->ignore_removed_attrs))^(node->new_data->attr&~(r->ignore_added_attrs)))&~ATTR(attr_rule) ) {
                     char *str = NULL;
                     report_printf(r, "Entry %s in databases has different attributes: %s\n",
                             node->old_data->filename,str= diff_attributes(node->old_data->attr&~(r->ignore_removed_attrs),node->new_data->attr&~(r->ignore_added_attrs)));
@@ -786,17 +881,17 @@ static void terse_report(seltree* node) {
                     node->checked|=NODE_CHANGED;
                 }
 #ifdef WITH_AUDIT
-                nchg++;
+                conf->scan.nchg++;
 #endif
             }else if (!((node->checked&NODE_ALLOW_NEW)||(node->checked&NODE_MOVED_IN))) {
 #ifdef WITH_AUDIT
-                nadd++;
+                conf->scan.nadd++;
 #endif
                 r->nadd++;
                 node->checked|=NODE_ADDED;
             }else if (!((node->checked&NODE_ALLOW_RM)||(node->checked&NODE_MOVED_OUT))) {
 #ifdef WITH_AUDIT
-                nrem++;
+                conf->scan.nrem++;
 #endif
                 r->nrem++;
                 node->checked|=NODE_REMOVED;
@@ -804,9 +899,9 @@ static void terse_report(seltree* node) {
         }
     }
 
-        added_entries_reported |= r->nadd != 0;
-        removed_entries_reported |= r->nrem != 0;
-        changed_entries_reported |= r->nchg != 0;
+        conf->scan.added_entries_reported |= r->nadd != 0;
+        conf->scan.removed_entries_reported |= r->nrem != 0;
+        conf->scan.changed_entries_reported |= r->nchg != 0;
     }
     for (n=node->childs;n;n=n->next) {
         terse_report((seltree*)n->data);
@@ -847,9 +942,10 @@ static void print_report_summary_line(REPORT_LEVEL report_level) {
 
 static void print_report_header() {
     char *time;
+    struct tm tm;
 
     time = checked_malloc(time_string_len * sizeof (char));
-    strftime(time, time_string_len, time_format, localtime(&(conf->start_time)));
+    strftime(time, time_string_len, time_format, localtime_r(&(conf->start_time), &tm));
     report(REPORT_LEVEL_SUMMARY,_("Start timestamp: %s (AIDE " AIDEVERSION ")\n"), time);
     free(time); time=NULL;
 
@@ -950,8 +1046,9 @@ static void print_report_footer()
 {
   char *time = checked_malloc(time_string_len * sizeof (char));
   int run_time = (int) difftime(conf->end_time, conf->start_time);
+  struct tm tm;
 
-  strftime(time, time_string_len, time_format, localtime(&(conf->end_time)));
+  strftime(time, time_string_len, time_format, localtime_r(&(conf->end_time), &tm));
   report(REPORT_LEVEL_SUMMARY,_("\n\nEnd timestamp: %s (run time: %dm %ds)\n"), time, run_time/60, run_time%60);
   free(time); time=NULL;
 }
@@ -960,13 +1057,13 @@ static void print_report_footer()
   /* Something changed, send audit anomaly message */
 void send_audit_report()
 {
-  if(nadd!=0||nrem!=0||nchg!=0){
+  if(conf->scan.nadd!=0||conf->scan.nrem!=0||conf->scan.nchg!=0){
     int fd=audit_open();
     if (fd>=0){
        char msg[64];
 
        snprintf(msg, sizeof(msg), "added=%ld removed=%ld changed=%ld", 
-                nadd, nrem, nchg);
+                conf->scan.nadd, conf->scan.nrem, conf->scan.nchg);
 
        if (audit_log_user_message(fd, AUDIT_ANOM_RBAC_INTEGRITY_FAIL,
                                   msg, NULL, NULL, NULL, 0)<=0)
@@ -1031,7 +1128,7 @@ int gen_report(seltree* node) {
     conf->end_time=time(NULL);
     print_report_footer();
 
-    return conf->action&(DO_COMPARE|DO_DIFF) ? (added_entries_reported)*1+(removed_entries_reported!=0)*2+(changed_entries_reported!=0)*4 : 0;
+    return conf->action&(DO_COMPARE|DO_DIFF) ? (conf->scan.added_entries_reported!=0)*1+(conf->scan.removed_entries_reported!=0)*2+(conf->scan.changed_entries_reported!=0)*4 : 0;
 }
 
 // vi: ts=8 sw=8
@@ -0,0 +1,170 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "db_config.h"
+#include "hashsum.h"
+#include "log.h"
+#include "md.h"
+#include "rule_cache.h"
+#include "util.h"
+
+#define RULE_CACHE_MAGIC "AIDERC02"
+#define RULE_CACHE_DIGEST_LENGTH 32
+
+typedef struct rule_cache_header {
+    char magic[8];
+    uint64_t fingerprint;
+    uint64_t num_codes;
+    uint64_t size; /* size of the serialized codes following the header */
+    uint8_t digest[RULE_CACHE_DIGEST_LENGTH]; /* SHA-256 of the serialized codes */
+} rule_cache_header;
+
+/* the serialized codes are passed to pcre2_serialize_decode(), which does not
+ * validate them, so corrupt or foreign codes must never reach it */
+static bool get_digest(const uint8_t *bytes, uint64_t size, uint8_t *digest) {
+    struct md_container mdc;
+    mdc.todo_attr = ATTR(attr_sha256);
+    if (init_md(&mdc, "rule cache") != RETOK || !(mdc.calc_attr&ATTR(attr_sha256))) {
+        return false;
+    }
+    update_md(&mdc, (void *) bytes, size);
+    close_md(&mdc);
+    memcpy(digest, mdc.hashsums[hash_sha256], RULE_CACHE_DIGEST_LENGTH);
+    return true;
+}
+
+/* the cache must be as trusted as the configuration */
+static bool is_trusted(const char *path, struct stat *fs) {
+    if (fs->st_uid != geteuid() && fs->st_uid != 0) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: '%s' is owned by another user (compile rules)", path);
+        return false;
+    }
+    if (fs->st_mode&(S_IWGRP|S_IWOTH)) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: '%s' is writable by group or others (compile rules)", path);
+        return false;
+    }
+    return true;
+}
+
+bool rule_cache_read(const char *path, uint64_t fingerprint, pcre2_code **codes, int32_t n) {
+    rule_cache_header header;
+    struct stat fs;
+    uint8_t *bytes = NULL;
+    uint8_t digest[RULE_CACHE_DIGEST_LENGTH];
+    bool retval = false;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        log_msg(errno == ENOENT?LOG_LEVEL_DEBUG:LOG_LEVEL_WARNING, "rule cache: fopen() failed for '%s': %s (compile rules)", path, strerror(errno));
+        return false;
+    }
+    if (fstat(fileno(fp), &fs) == -1) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: fstat() failed for '%s': %s (compile rules)", path, strerror(errno));
+    } else if (!is_trusted(path, &fs)) {
+        /* warning already logged */
+    } else if (fread(&header, sizeof(header), 1, fp) != 1
+            || memcmp(header.magic, RULE_CACHE_MAGIC, sizeof(header.magic))) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: '%s' is not a rule cache (compile rules)", path);
+    } else if (header.fingerprint != fingerprint || header.num_codes != (uint64_t) n) {
+        log_msg(LOG_LEVEL_INFO, "rule cache: '%s' is stale (compile rules)", path);
+    } else if ((uint64_t) fs.st_size != sizeof(header) + header.size) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: '%s' is truncated (compile rules)", path);
+    } else {
+        bytes = checked_malloc(header.size);
+        if (fread(bytes, 1, header.size, fp) != header.size) {
+            log_msg(LOG_LEVEL_WARNING, "rule cache: fread() failed for '%s' (compile rules)", path);
+        } else if (!get_digest(bytes, header.size, digest) || memcmp(digest, header.digest, sizeof(digest))) {
+            log_msg(LOG_LEVEL_WARNING, "rule cache: checksum mismatch for '%s' (compile rules)", path);
+        } else if (pcre2_serialize_get_number_of_codes(bytes) != n) {
+            log_msg(LOG_LEVEL_WARNING, "rule cache: '%s' has been created by another PCRE2 version or architecture (compile rules)", path);
+        } else {
+            int32_t decoded = pcre2_serialize_decode(codes, n, bytes, NULL);
+            if (decoded != n) {
+                PCRE2_UCHAR pcre2_error[128];
+                pcre2_get_error_message(decoded, pcre2_error, 128);
+                log_msg(LOG_LEVEL_WARNING, "rule cache: failed to decode '%s': %s (compile rules)", path, pcre2_error);
+            } else {
+                log_msg(LOG_LEVEL_INFO, "rule cache: read %d compiled rule(s) from '%s'", n, path);
+                retval = true;
+            }
+        }
+        free(bytes);
+    }
+    fclose(fp);
+    return retval;
+}
+
+void rule_cache_write(const char *path, uint64_t fingerprint, pcre2_code **codes, int32_t n) {
+    rule_cache_header header;
+    uint8_t *bytes = NULL;
+    PCRE2_SIZE size;
+
+    int32_t encoded = pcre2_serialize_encode((const pcre2_code **) codes, n, &bytes, &size, NULL);
+    if (encoded != n) {
+        PCRE2_UCHAR pcre2_error[128];
+        pcre2_get_error_message(encoded, pcre2_error, 128);
+        log_msg(LOG_LEVEL_WARNING, "rule cache: failed to serialize rules: %s", pcre2_error);
+        return;
+    }
+
+    memcpy(header.magic, RULE_CACHE_MAGIC, sizeof(header.magic));
+    header.fingerprint = fingerprint;
+    header.num_codes = n;
+    header.size = size;
+    if (!get_digest(bytes, size, header.digest)) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: failed to calculate checksum of serialized rules");
+        pcre2_serialize_free(bytes);
+        return;
+    }
+
+    /* write to a temporary file first, concurrent runs only see complete caches */
+    int len = strlen(path) + 32;
+    char *tmp = checked_malloc(len);
+    snprintf(tmp, len, "%s.%ld", path, (long) getpid());
+    int fd = open(tmp, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+    FILE *fp = fd == -1?NULL:fdopen(fd, "w");
+    if (fp == NULL) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: failed to open '%s': %s", tmp, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+    } else if (fwrite(&header, sizeof(header), 1, fp) != 1 || fwrite(bytes, 1, size, fp) != size) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: write() failed for '%s': %s", tmp, strerror(errno));
+        fclose(fp);
+        unlink(tmp);
+    } else if (fclose(fp) == EOF || rename(tmp, path) == -1) {
+        log_msg(LOG_LEVEL_WARNING, "rule cache: failed to replace '%s': %s", path, strerror(errno));
+        unlink(tmp);
+    } else {
+        log_msg(LOG_LEVEL_INFO, "rule cache: wrote %d compiled rule(s) to '%s'", n, path);
+    }
+    free(tmp);
+    pcre2_serialize_free(bytes);
+}
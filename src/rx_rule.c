@@ -19,6 +19,7 @@
  */
 
 #include <config.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/stat.h>
 
@@ -140,3 +141,16 @@ char* get_rule_type_char(AIDE_RULE_TYPE rule_type) {
     }
     return NULL;
 }
+
+long long get_rule_fingerprint(rx_rule *rule) {
+    /* FNV-1a hash of attributes and restriction */
+    uint64_t h = 0xcbf29ce484222325LLU;
+    for (size_t i = 0; i < sizeof(DB_ATTR_TYPE); ++i) {
+        h = (h ^ ((rule->attr >> (8*i))&0xff)) * 0x100000001b3LLU;
+    }
+    for (size_t i = 0; i < sizeof(RESTRICTION_TYPE); ++i) {
+        h = (h ^ ((rule->restriction >> (8*i))&0xff)) * 0x100000001b3LLU;
+    }
+    /* stored as (signed) number in the database */
+    return h&0x7fffffffffffffffLLU;
+}
@@ -19,12 +19,19 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include "config.h"
+#include <pthread.h>
+#include <search.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "aide.h"
 #include "attributes.h"
+#include "glob_rule.h"
 #include "list.h"
 #include "log.h"
+#include "rule_cache.h"
 #include "rx_rule.h"
 #include "seltree.h"
 #include "seltree_struct.h"
@@ -85,7 +92,8 @@ static char* strrxtok(char* rx)
   p=checked_strdup(rx);
   p[0]='/';
 
-  for(i=1;i<strlen(p);i++){
+  size_t len=strlen(p);
+  for(i=1;i<len;i++){
     switch(p[i])
       {
       case '/':
@@ -97,12 +105,11 @@ static char* strrxtok(char* rx)
       case '?':
       case '*':
       case '[':
-	i=strlen(p);
+	i=len;
 	break;
       case '\\':
-        for (int j = i; p[j]; j++) {
-            p[j] = p[j+1];
-        }
+        memmove(&p[i], &p[i+1], len-i);
+        len--;
 	break;
       default:
 	break;
@@ -119,8 +126,9 @@ static char* strlastslash(char*str)
   char* p=NULL;
   size_t lastslash=1;
   size_t i=0;
+  size_t len=strlen(str);
 
-  for(i=1;i<strlen(str);i++){
+  for(i=1;i<len;i++){
     if(str[i]=='/'){
       lastslash=i;
     }
@@ -179,31 +187,96 @@ int compare_node_by_path(const void *n1, const void *n2)
 seltree* get_seltree_node(seltree* tree,char* path)
 {
   seltree* node=NULL;
-  list* r=NULL;
+  seltree key;
   char* tmp=NULL;
+  char* r=NULL;
+  int depth, i=0;
 
   if(tree==NULL){
     return NULL;
   }
 
-  if(strncmp(path,tree->path,strlen(path)+1)==0){
+  if(strcmp(path,tree->path)==0){
     return tree;
   }
-  else{
-    tmp=strgetndirname(path,treedepth(tree)+1);
-    for(r=tree->childs;r;r=r->next){
-      if(strncmp(((seltree*)r->data)->path,tmp,strlen(tmp)+1)==0){
-	node=get_seltree_node((seltree*)r->data,path);
-	if(node!=NULL){
-	  /* Don't leak memory */
-	  free(tmp);
-	  return node;
-	}
-      }
+
+  /* descend one path component per level (see strgetndirname()) */
+  tmp=checked_strdup(path);
+  depth=treedepth(tree);
+  for(node=tree,r=tmp;node;){
+    depth++;
+    for(;;r++){
+      if(*r=='/')
+        i++;
+      if(*r=='\0' || i==depth)
+        break;
+    }
+    bool last=(*r=='\0');
+    *r='\0';
+    key.path=tmp;
+    seltree **child=tfind(&key,&node->child_index,compare_node_by_path);
+    node=child?*child:NULL;
+    if(last){
+      break;
+    }
+    *r++='/';
+  }
+  free(tmp);
+  return node;
+}
+
+void add_seltree_child(seltree *parent, seltree *node)
+{
+  if (conf->bulk_build) {
+    parent->childs=list_append(parent->childs,(void*)node);
+  } else {
+    parent->childs=list_sorted_insert(parent->childs,(void*)node, compare_node_by_path);
+  }
+  tsearch(node,&parent->child_index,compare_node_by_path);
+}
+
+void begin_bulk_build(void)
+{
+  conf->bulk_build = true;
+}
+
+static int compare_node_ptr_by_path(const void *n1, const void *n2)
+{
+  return compare_node_by_path(*(seltree* const*)n1, *(seltree* const*)n2);
+}
+
+static void sort_childs(seltree *node)
+{
+  size_t n=0, i=0;
+  list *r=NULL;
+
+  for(r=node->childs;r;r=r->next){
+    n++;
+  }
+  if (n > 1) {
+    seltree **childs=checked_malloc(n*sizeof(seltree*));
+    for(r=node->childs;r;r=r->next){
+      childs[i++]=r->data;
+    }
+    qsort(childs, n, sizeof(seltree*), compare_node_ptr_by_path);
+    for(r=node->childs,i=0;r;r=r->next){
+      r->data=childs[i++];
+    }
+    free(childs);
+  }
+  for(r=node->childs;r;r=r->next){
+    sort_childs(r->data);
+  }
+}
+
+void end_bulk_build(seltree *tree)
+{
+  if (conf->bulk_build) {
+    conf->bulk_build = false;
+    if (tree) {
+      sort_childs(tree);
     }
-    free(tmp);
   }
-  return NULL;
 }
 
 
@@ -219,6 +292,7 @@ seltree* new_seltree_node(
 
   node=(seltree*)checked_malloc(sizeof(seltree));
   node->childs=NULL;
+  node->child_index=NULL;
   node->path=checked_strdup(path);
   node->sel_rx_lst=NULL;
   node->neg_rx_lst=NULL;
@@ -247,7 +321,7 @@ seltree* new_seltree_node(
       }
     }
     free(tmprxtok);
-    parent->childs=list_sorted_insert(parent->childs,(void*)node, compare_node_by_path);
+    add_seltree_child(parent, node);
     node->parent=parent;
   }else {
     node->parent=NULL;
@@ -256,13 +330,129 @@ seltree* new_seltree_node(
   return node;
 }
 
+typedef struct pending_node {
+    seltree *node;
+    char *path;
+} pending_node;
+
+seltree_match_ctx *new_seltree_match_ctx(void) {
+    seltree_match_ctx *ctx = checked_malloc(sizeof(seltree_match_ctx));
+    ctx->md = pcre2_match_data_create(1, NULL);
+    if (ctx->md == NULL) {
+        log_msg(LOG_LEVEL_ERROR, "pcre2_match_data_create: failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    ctx->pending_nodes = NULL;
+    return ctx;
+}
+
+void free_seltree_match_ctx(seltree_match_ctx *ctx) {
+    if (ctx) {
+        add_pending_seltree_nodes(ctx);
+        pcre2_match_data_free(ctx->md);
+        free(ctx);
+    }
+}
+
+/*
+ * Queue a new node for path below node, the tree itself is not changed
+ * until add_pending_seltree_nodes() is called
+ */
+void add_pending_node(seltree_match_ctx *ctx, seltree *node, char *path) {
+    pending_node *p = checked_malloc(sizeof(pending_node));
+    p->node = node;
+    p->path = checked_strdup(path);
+    ctx->pending_nodes = list_append(ctx->pending_nodes, p);
+    log_msg(LOG_LEVEL_DEBUG, "queue new node '%s' below '%s' (%p)", path, node->path, node);
+}
+
+void add_pending_seltree_nodes(seltree_match_ctx *ctx) {
+    while (ctx->pending_nodes) {
+        pending_node *p = ctx->pending_nodes->data;
+        ctx->pending_nodes = list_delete_item(ctx->pending_nodes);
+        if (get_seltree_node(p->node, p->path) == NULL) {
+            seltree *new_node = new_seltree_node(p->node, p->path, 0, NULL);
+            log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: queued by rule evaluation)", new_node->path, new_node, p->path);
+        }
+        free(p->path);
+        free(p);
+    }
+}
+
+static void free_rx_rules(list *rules) {
+    while (rules) {
+        rx_rule *r = rules->data;
+        free(r->rx);
+        pcre2_code_free(r->crx);
+        free_glob(r->glob);
+        free(r->literal);
+        free(r->config_line);
+        pthread_mutex_destroy(&r->jit_mutex);
+        free(r);
+        rules = list_delete_item(rules);
+    }
+}
+
+static void keep_node(void *node) {
+    (void) node; /* nodes are freed via the child lists */
+}
+
+void free_tree(seltree *node) {
+    if (node == NULL) {
+        return;
+    }
+    while (node->childs) {
+        free_tree(node->childs->data);
+        node->childs = list_delete_item(node->childs);
+    }
+    tdestroy(node->child_index, keep_node);
+    free_rx_rules(node->sel_rx_lst);
+    free_rx_rules(node->neg_rx_lst);
+    free_rx_rules(node->equ_rx_lst);
+    free(node->path);
+    free(node);
+}
+
 seltree *init_tree() {
     seltree* node = new_seltree_node(NULL,"/",0,NULL);
     log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: root node)", node->path, node, "/");
     return node;
 }
 
-rx_rule * add_rx_to_tree(char * rx, RESTRICTION_TYPE restriction, int rule_type, seltree *tree, int linenumber, char* filename, char* linebuf) {
+/*
+ * get_literal()
+ * return the unescaped text of a rule without regex syntax or NULL
+ * a trailing '$' is allowed, non-ASCII rules are left to PCRE2
+ */
+static char* get_literal(char* rx, bool *eol)
+{
+    size_t len = strlen(rx), n = 0;
+    char *p = checked_malloc(len+1);
+
+    *eol = false;
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = rx[i];
+        if (c == '\\') {
+            c = rx[++i];
+            /* backslash followed by a letter or digit is a regex escape */
+            if (c == '\0' || c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+                free(p);
+                return NULL;
+            }
+        } else if (c == '$' && i == len-1) {
+            *eol = true;
+            break;
+        } else if (c >= 0x80 || strchr("^$.[]|()?*+{}", c)) {
+            free(p);
+            return NULL;
+        }
+        p[n++] = c;
+    }
+    p[n] = '\0';
+    return p;
+}
+
+rx_rule * add_rx_to_tree(char * rx, bool glob, RESTRICTION_TYPE restriction, int rule_type, seltree *tree, int linenumber, char* filename, char* linebuf) {
     rx_rule* r = NULL;
     seltree *curnode = NULL;
     char *rxtok = NULL;
@@ -280,66 +470,238 @@ rx_rule * add_rx_to_tree(char * rx, RESTRICTION_TYPE restriction, int rule_type,
     int pcre2_errorcode;
     PCRE2_SIZE pcre2_erroffset;
 
-    if((r->crx=pcre2_compile((PCRE2_SPTR) r->rx, PCRE2_ZERO_TERMINATED, PCRE2_UTF|PCRE2_ANCHORED, &pcre2_errorcode, &pcre2_erroffset, NULL)) == NULL) {
+    r->crx = NULL;
+    r->glob = NULL;
+    r->jit_state = RULE_JIT_PENDING;
+    pthread_mutex_init(&r->jit_mutex, NULL);
+    r->literal = NULL;
+    if (glob) {
+        const char *glob_error;
+        size_t glob_erroffset;
+        if ((r->glob = compile_glob(r->rx, &glob_error, &glob_erroffset)) == NULL) {
+            log_msg(LOG_LEVEL_ERROR, "%s:%d:%zu: error in rule '%s': %s (line: '%s')", filename, linenumber, glob_erroffset, rx, glob_error, linebuf);
+            pthread_mutex_destroy(&r->jit_mutex);
+            free(r);
+            return NULL;
+        }
+        conf->rule_stats.glob++;
+    } else if ((r->literal = get_literal(r->rx, &r->literal_eol)) != NULL) {
+        r->literal_len = strlen(r->literal);
+        conf->rule_stats.literal++;
+        log_msg(LOG_LEVEL_DEBUG, "use string comparison for literal regex '%s'", r->rx);
+    } else if (conf->bulk_build) {
+        /* compiled by compile_rules() */
+    } else if((r->crx=pcre2_compile((PCRE2_SPTR) r->rx, PCRE2_ZERO_TERMINATED, PCRE2_UTF|PCRE2_ANCHORED, &pcre2_errorcode, &pcre2_erroffset, NULL)) == NULL) {
         PCRE2_UCHAR pcre2_error[128];
         pcre2_get_error_message(pcre2_errorcode, pcre2_error, 128);
         log_msg(LOG_LEVEL_ERROR, "%s:%d:%i: error in rule '%s': %s (line: '%s')", filename, linenumber, pcre2_erroffset, rx, pcre2_error, linebuf);
+        pthread_mutex_destroy(&r->jit_mutex);
         free(r);
         return NULL;
     } else {
-        r->md = pcre2_match_data_create_from_pattern(r->crx, NULL);
-        if (r->md == NULL) {
-            log_msg(LOG_LEVEL_ERROR, "pcre2_match_data_create_from_pattern: failed to allocate memory");
-            exit(EXIT_FAILURE);
-        }
-        int pcre2_jit = pcre2_jit_compile(r->crx, PCRE2_JIT_PARTIAL_SOFT);
-        if (pcre2_jit < 0) {
-            PCRE2_UCHAR pcre2_error[128];
-            pcre2_get_error_message(pcre2_jit, pcre2_error, 128);
-            log_msg(LOG_LEVEL_NOTICE, "JIT compilation for regex '%s' failed: %s (fall back to interpreted matching)", r->rx, pcre2_error);
-        } else {
-            log_msg(LOG_LEVEL_DEBUG, "JIT compilation for reges '%s' successful", r->rx);
+        conf->rule_stats.compiled++;
+    }
+
+    rxtok=r->glob?get_glob_dir(r->glob):strrxtok(r->rx);
+
+    for(size_t i=1;rxtok[i];++i){
+        if (rxtok[i] == '/' && rxtok[i-1] == '/') {
+            log_msg(LOG_LEVEL_ERROR, "%s:%d:1: error in rule '%s': invalid double slash (line: '%s')", filename, linenumber, rx, linebuf);
+            free(rxtok);
+            free(r->literal);
+            pcre2_code_free(r->crx);
+            free_glob(r->glob);
+            pthread_mutex_destroy(&r->jit_mutex);
+            free(r);
+            return NULL;
         }
+    }
 
-        rxtok=strrxtok(r->rx);
-        curnode=get_seltree_node(tree,rxtok);
+    if (r->literal == NULL && r->crx == NULL && r->glob == NULL) {
+        conf->uncompiled_rules = list_append(conf->uncompiled_rules, r);
+        conf->num_uncompiled_rules++;
+    }
 
-        for(size_t i=1;i < strlen(rxtok); ++i){
-            if (rxtok[i] == '/' && rxtok[i-1] == '/') {
-                log_msg(LOG_LEVEL_ERROR, "%s:%d:1: error in rule '%s': invalid double slash (line: '%s')", filename, linenumber, rx, linebuf);
-                free(r);
-                return NULL;
-            }
+    curnode=get_seltree_node(tree,rxtok);
+    if(curnode == NULL){
+        curnode=new_seltree_node(tree,rxtok,1,r);
+        log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: new rule '%s')", curnode->path, curnode, rxtok, r->rx);
+    }
+    r->node = curnode;
+    switch (rule_type){
+        case AIDE_NEGATIVE_RULE:{
+            curnode->neg_rx_lst=list_append(curnode->neg_rx_lst,(void*)r);
+            break;
         }
-
-        if(curnode == NULL){
-            curnode=new_seltree_node(tree,rxtok,1,r);
-            log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: new rule '%s')", curnode->path, curnode, rxtok, r->rx);
+        case AIDE_EQUAL_RULE:{
+            curnode->equ_rx_lst=list_append(curnode->equ_rx_lst,(void*)r);
+            break;
+        }
+        case AIDE_SELECTIVE_RULE:{
+            curnode->sel_rx_lst=list_append(curnode->sel_rx_lst,(void*)r);
+            break;
         }
-        r->node = curnode;
-        switch (rule_type){
-            case AIDE_NEGATIVE_RULE:{
-                curnode->neg_rx_lst=list_append(curnode->neg_rx_lst,(void*)r);
+    }
+    free(rxtok);
+    return r;
+}
+
+bool compile_rules(const char *cache)
+{
+    bool retval = true;
+    int32_t n = conf->num_uncompiled_rules, i = 0;
+    list *l = NULL;
+
+    if (n == 0) {
+        return true;
+    }
+
+    /* FNV-1a hash of all regexes */
+    uint64_t fingerprint = 0xcbf29ce484222325LLU;
+    for (l = conf->uncompiled_rules; l; l = l->next) {
+        const char *c = ((rx_rule*)l->data)->rx;
+        do {
+            fingerprint = (fingerprint ^ (unsigned char) *c) * 0x100000001b3LLU;
+        } while (*c++);
+    }
+
+    pcre2_code **codes = checked_malloc(n*sizeof(pcre2_code*));
+    if (cache && rule_cache_read(cache, fingerprint, codes, n)) {
+        conf->rule_stats.cached += n;
+    } else {
+        for (l = conf->uncompiled_rules; l; l = l->next, ++i) {
+            rx_rule *r = l->data;
+            int pcre2_errorcode;
+            PCRE2_SIZE pcre2_erroffset;
+            if ((codes[i] = pcre2_compile((PCRE2_SPTR) r->rx, PCRE2_ZERO_TERMINATED, PCRE2_UTF|PCRE2_ANCHORED, &pcre2_errorcode, &pcre2_erroffset, NULL)) == NULL) {
+                PCRE2_UCHAR pcre2_error[128];
+                pcre2_get_error_message(pcre2_errorcode, pcre2_error, 128);
+                log_msg(LOG_LEVEL_ERROR, "%s:%d:%i: error in rule '%s': %s (line: '%s')", r->config_filename, r->config_linenumber, pcre2_erroffset, r->rx, pcre2_error, r->config_line);
+                retval = false;
                 break;
             }
-            case AIDE_EQUAL_RULE:{
-                curnode->equ_rx_lst=list_append(curnode->equ_rx_lst,(void*)r);
-                break;
+        }
+        if (retval) {
+            conf->rule_stats.compiled += n;
+            if (cache) {
+                rule_cache_write(cache, fingerprint, codes, n);
             }
-            case AIDE_SELECTIVE_RULE:{
-                curnode->sel_rx_lst=list_append(curnode->sel_rx_lst,(void*)r);
-                break;
+        } else {
+            while (i--) {
+                pcre2_code_free(codes[i]);
             }
         }
-        free(rxtok);
     }
-    return r;
+    for (i = 0; conf->uncompiled_rules; ++i) {
+        if (retval) {
+            ((rx_rule*)conf->uncompiled_rules->data)->crx = codes[i];
+        }
+        conf->uncompiled_rules = list_delete_item(conf->uncompiled_rules);
+    }
+    conf->num_uncompiled_rules = 0;
+    free(codes);
+    return retval;
+}
+
+void log_rule_stats(LOG_LEVEL log_level) {
+  log_msg(log_level, "rules: loaded configuration in %.3f second(s) (literal rules: %lu, glob rules: %lu, compiled regexes: %lu, regexes from rule cache: %lu), JIT-compiled %lu regex(es) on first evaluation",
+          conf->rule_stats.load_time, conf->rule_stats.literal, conf->rule_stats.glob, conf->rule_stats.compiled,
+          conf->rule_stats.cached, conf->rule_stats.jit);
+}
+
+static bool is_valid_utf8(const char *s)
+{
+    const unsigned char *p = (const unsigned char *) s;
+    while (*p) {
+        unsigned int c;
+        int n;
+        if (*p < 0x80) {
+            p++;
+            continue;
+        } else if (*p >= 0xc2 && *p <= 0xdf) {
+            n = 1;
+            c = *p&0x1f;
+        } else if ((*p&0xf0) == 0xe0) {
+            n = 2;
+            c = *p&0x0f;
+        } else if (*p >= 0xf0 && *p <= 0xf4) {
+            n = 3;
+            c = *p&0x07;
+        } else {
+            return false;
+        }
+        for (int i = 1; i <= n; ++i) {
+            if ((p[i]&0xc0) != 0x80) {
+                return false;
+            }
+            c = (c<<6)|(p[i]&0x3f);
+        }
+        if ((n == 2 && (c < 0x800 || (c >= 0xd800 && c <= 0xdfff))) || (n == 3 && (c < 0x10000 || c > 0x10ffff))) {
+            return false;
+        }
+        p += n+1;
+    }
+    return true;
+}
+
+/*
+ * match_literal()
+ * string comparison with the results of pcre2_match() for the anchored,
+ * partial (soft) matching of the literal rule (a subject that is not valid
+ * UTF-8 never matches)
+ */
+static int match_literal(rx_rule *rx, char *text)
+{
+    size_t len = strlen(text);
+    int retval;
+
+    if (len < rx->literal_len) {
+        retval = strncmp(text, rx->literal, len)?PCRE2_ERROR_NOMATCH:PCRE2_ERROR_PARTIAL;
+    } else if (strncmp(text, rx->literal, rx->literal_len)) {
+        retval = PCRE2_ERROR_NOMATCH;
+    } else if (!rx->literal_eol || len == rx->literal_len || (len == rx->literal_len+1 && text[len-1] == '\n')) {
+        /* '$' also matches before a trailing newline */
+        retval = 0;
+    } else {
+        retval = PCRE2_ERROR_NOMATCH;
+    }
+    if (retval != PCRE2_ERROR_NOMATCH && !is_valid_utf8(text)) {
+        retval = PCRE2_ERROR_NOMATCH;
+    }
+    return retval;
+}
+
+/*
+ * jit_compile_rule()
+ * JIT-compile the regex of a rule on its first evaluation, callers
+ * evaluating the rule meanwhile wait for the compilation to finish as
+ * pcre2_jit_compile() needs exclusive access to the compiled code
+ */
+static void jit_compile_rule(rx_rule *rx)
+{
+    if (__atomic_load_n(&rx->jit_state, __ATOMIC_ACQUIRE) == RULE_JIT_DONE) {
+        return;
+    }
+    pthread_mutex_lock(&rx->jit_mutex);
+    if (rx->jit_state == RULE_JIT_PENDING) {
+        int pcre2_jit = pcre2_jit_compile(rx->crx, PCRE2_JIT_PARTIAL_SOFT);
+        if (pcre2_jit < 0) {
+            PCRE2_UCHAR pcre2_error[128];
+            pcre2_get_error_message(pcre2_jit, pcre2_error, 128);
+            log_msg(LOG_LEVEL_NOTICE, "JIT compilation for regex '%s' failed: %s (fall back to interpreted matching)", rx->rx, pcre2_error);
+        } else {
+            log_msg(LOG_LEVEL_DEBUG, "JIT compilation for regex '%s' successful", rx->rx);
+            __atomic_fetch_add(&conf->rule_stats.jit, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&rx->jit_state, RULE_JIT_DONE, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&rx->jit_mutex);
 }
 
 #define LOG_MATCH(log_level, border, format, ...) \
     log_msg(log_level, "%s %*c'%s' " #format " of %s (%s:%d: '%s')", border, depth+2, ' ', text, __VA_ARGS__, get_rule_type_long_string(rule_type), rx->config_filename, rx->config_linenumber, rx->config_line);
 
-static int check_list_for_match(list* rxrlist,char* text, rx_rule* *rule, RESTRICTION_TYPE file_type, int rule_type, int depth, bool unrestricted_only)
+static int check_list_for_match(list* rxrlist,char* text, rx_rule* *rule, RESTRICTION_TYPE file_type, int rule_type, int depth, bool unrestricted_only, seltree_match_ctx *ctx)
 {
   list* r=NULL;
   int retval=NO_RULE_MATCH;
@@ -350,7 +712,14 @@ static int check_list_for_match(list* rxrlist,char* text, rx_rule* *rule, RESTRI
 
       if (!(unrestricted_only && rx->restriction)) {
 
-      pcre_retval = pcre2_match(rx->crx, (PCRE2_SPTR) text, PCRE2_ZERO_TERMINATED, 0, PCRE2_PARTIAL_SOFT, rx->md, NULL);
+      if (rx->glob) {
+          pcre_retval = match_glob(rx->glob, text);
+      } else if (rx->crx) {
+          jit_compile_rule(rx);
+          pcre_retval = pcre2_match(rx->crx, (PCRE2_SPTR) text, PCRE2_ZERO_TERMINATED, 0, PCRE2_PARTIAL_SOFT, ctx->md, NULL);
+      } else {
+          pcre_retval = match_literal(rx, text);
+      }
       if (pcre_retval >= 0) {
           if (!rx->restriction || file_type&rx->restriction) {
                   *rule = rx;
@@ -394,7 +763,7 @@ static int check_list_for_match(list* rxrlist,char* text, rx_rule* *rule, RESTRI
  *16,  this is a recursed call
  *32,  top-level call
  */
-static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file_type, int retval, rx_rule* *rule, int depth)
+static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file_type, int retval, rx_rule* *rule, int depth, seltree_match_ctx *ctx)
 {
 
   if(node==NULL){
@@ -410,7 +779,7 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
 
       if (node->equ_rx_lst) {
           log_msg(LOG_LEVEL_RULE, "\u2502 %*cnode: '%s': check equal list", depth, ' ', node->path);
-          switch (check_list_for_match(node->equ_rx_lst, text, rule, file_type, AIDE_EQUAL_RULE, depth, false)) {
+          switch (check_list_for_match(node->equ_rx_lst, text, rule, file_type, AIDE_EQUAL_RULE, depth, false, ctx)) {
               case RESTRICTED_RULE_MATCH:
               case RULE_MATCH: {
                           log_msg(LOG_LEVEL_RULE, "\u2502 %*cequal match for '%s' (node: '%s')", depth, ' ', text, node->path);
@@ -419,8 +788,8 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
                       }
               case PARTIAL_RULE_MATCH: {
                            if(file_type&FT_DIR && get_seltree_node(node,text)==NULL) {
-                               seltree *new_node = new_seltree_node(node,text,0,NULL);
-                               log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: partial equal match for directory)", new_node->path, new_node, text);
+                               log_msg(LOG_LEVEL_DEBUG, "\u2502 %*cnew node for '%s' (reason: partial equal match for directory)", depth, ' ', text);
+                               add_pending_node(ctx, node, text);
                            }
                            break;
                        }
@@ -438,7 +807,7 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
   if(!(retval&(4|8))){
       if (node->sel_rx_lst) {
           log_msg(LOG_LEVEL_RULE, "\u2502 %*cnode: '%s': check selective list", depth, ' ', node->path);
-          switch (check_list_for_match(node->sel_rx_lst, text, rule, file_type, AIDE_SELECTIVE_RULE, depth, false)) {
+          switch (check_list_for_match(node->sel_rx_lst, text, rule, file_type, AIDE_SELECTIVE_RULE, depth, false, ctx)) {
               case RESTRICTED_RULE_MATCH:
               case RULE_MATCH: {
                           log_msg(LOG_LEVEL_RULE, "\u2502 %*cselective match for '%s' (node: '%s')", depth, ' ', text, node->path);
@@ -447,8 +816,8 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
                       }
               case PARTIAL_RULE_MATCH: {
                            if(file_type&FT_DIR && get_seltree_node(node,text)==NULL) {
-                               seltree *new_node = new_seltree_node(node,text,0,NULL);
-                               log_msg(LOG_LEVEL_DEBUG, "added new node '%s', (%p) for '%s' (reason: partial selective match for directory)", new_node->path, new_node, text);
+                               log_msg(LOG_LEVEL_DEBUG, "\u2502 %*cnew node for '%s' (reason: partial selective match for directory)", depth, ' ', text);
+                               add_pending_node(ctx, node, text);
                            }
                            break;
                        }
@@ -461,7 +830,7 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
   }
 
   /* Now let's check the ancestors */
-  retval=check_node_for_match(node->parent, text, file_type, retval&~32, rule, depth+2);
+  retval=check_node_for_match(node->parent, text, file_type, retval&~32, rule, depth+2, ctx);
 
   /* Negative regexps are the strongest so they are checked last */
   /* If this file is to be added */
@@ -479,7 +848,7 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
               }
               if (strcmp(parentname,node->path) > 0) {
                   log_msg(LOG_LEVEL_RULE, "\u2502 %*ccheck parent directory '%s' (unrestricted rules only)", depth+2, ' ', parentname);
-                  if (check_list_for_match(node->neg_rx_lst, parentname, rule, FT_DIR, AIDE_NEGATIVE_RULE, depth+4, true) == RULE_MATCH) {
+                  if (check_list_for_match(node->neg_rx_lst, parentname, rule, FT_DIR, AIDE_NEGATIVE_RULE, depth+4, true, ctx) == RULE_MATCH) {
                       log_msg(LOG_LEVEL_RULE, "\u2502 %*cnegative match for parent directory '%s'", depth, ' ', parentname);
                       retval=0;;
                       break;
@@ -490,11 +859,11 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
 
           if (retval) {
           log_msg(LOG_LEVEL_RULE, "\u2502 %*ccheck file '%s'", depth+2, ' ', text);
-          switch (check_list_for_match(node->neg_rx_lst, text, rule, file_type, AIDE_NEGATIVE_RULE, depth+2, false)) {
+          switch (check_list_for_match(node->neg_rx_lst, text, rule, file_type, AIDE_NEGATIVE_RULE, depth+2, false, ctx)) {
               case RESTRICTED_RULE_MATCH: {
                   if(file_type&FT_DIR && get_seltree_node(node,text)==NULL) {
-                      seltree *new_node = new_seltree_node(node,text,0,NULL);
-                      log_msg(LOG_LEVEL_DEBUG, "added new node '%s' (%p) for '%s' (reason: restricted negative match for directory)", new_node->path, new_node, text);
+                      log_msg(LOG_LEVEL_DEBUG, "\u2502 %*cnew node for '%s' (reason: restricted negative match for directory)", depth, ' ', text);
+                      add_pending_node(ctx, node, text);
                   }
 
               }
@@ -517,7 +886,7 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
 
   } else {
     log_msg(LOG_LEVEL_DEBUG, "\u2502 %*cskip node '%s' (reason: no regex rules)", depth, ' ', node->path);
-    retval = check_node_for_match(node->parent, text, file_type, (retval|16)&~32, rule, depth);
+    retval = check_node_for_match(node->parent, text, file_type, (retval|16)&~32, rule, depth, ctx);
   }
 
   /* Now we discard the info whether a match was made or not *
@@ -528,7 +897,7 @@ static int check_node_for_match(seltree *node, char *text, RESTRICTION_TYPE file
   return retval;
 }
 
-int check_seltree(seltree *tree, char *filename, RESTRICTION_TYPE file_type, rx_rule* *rule) {
+int check_seltree(seltree *tree, char *filename, RESTRICTION_TYPE file_type, rx_rule* *rule, seltree_match_ctx *ctx) {
   log_msg(LOG_LEVEL_RULE, "\u2502 check '%s'", filename);
   char * tmp=NULL;
   char * parentname=NULL;
@@ -558,7 +927,7 @@ int check_seltree(seltree *tree, char *filename, RESTRICTION_TYPE file_type, rx_
 
   free(parentname);
 
-  retval = check_node_for_match(pnode, filename, file_type, retval|32 ,rule, 0);
+  retval = check_node_for_match(pnode, filename, file_type, retval|32 ,rule, 0, ctx);
 
   if (retval) {
     char *str;
@@ -566,8 +935,8 @@ int check_seltree(seltree *tree, char *filename, RESTRICTION_TYPE file_type, rx_
     free(str);
 
     if(get_seltree_node(tree,filename)==NULL) {
-        seltree *new_node = new_seltree_node(tree,filename,0,NULL);
-        log_msg(LOG_LEVEL_DEBUG, "added new node '%s', (%p) for '%s' (reason: full match)", new_node->path, new_node, filename);
+        log_msg(LOG_LEVEL_DEBUG, "new node for '%s' (reason: full match)", filename);
+        add_pending_node(ctx, tree, filename);
     }
   } else {
     log_msg(LOG_LEVEL_RULE, "\u2534 do NOT add '%s' to the tree", filename);
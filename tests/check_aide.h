@@ -21,3 +21,8 @@
 #include <check.h>
 
 Suite *make_attributes_suite(void);
+Suite *make_util_suite(void);
+Suite *make_glob_rule_suite(void);
+Suite *make_seltree_suite(void);
+Suite *make_db_path_suite(void);
+Suite *make_base64_suite(void);
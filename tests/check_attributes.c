@@ -69,6 +69,10 @@ static diff_attributes_t diff_attributes_tests[] = {
     { 0, ATTR(attr_ftype), "ftype" },
     { 0, ATTR(attr_e2fsattrs), "e2fsattrs" },
     { 0, ATTR(attr_capabilities), "caps" },
+    { 0, ATTR(attr_chunks), "chunks" },
+    { 0, ATTR(attr_fsverity), "fsverity" },
+    /* { 0, ATTR(attr_verified), "verified" }, */
+    /* { 0, ATTR(attr_rule), "rule" }, */
 
     { 0, ATTR(attr_linkname)|ATTR(attr_perm), "l+p" },
     { 0, ATTR(attr_ctime)|ATTR(attr_ftype), "c+ftype" },
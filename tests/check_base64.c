@@ -0,0 +1,108 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base64.h"
+
+typedef struct {
+    const char *src;
+    const char *expected;
+    size_t expected_len;
+} decode_base64_t;
+
+static decode_base64_t decode_base64_tests[] = {
+    { "QQ==", "A", 1 },
+    { "QUI=", "AB", 2 },
+    { "QUJD", "ABC", 3 },
+    { "QUJDRA==", "ABCD", 4 },
+    { "AAEC", "\x00\x01\x02", 3 },
+    { "/+8=", "\xff\xef", 2 },
+};
+
+static int num_decode_base64_tests = sizeof decode_base64_tests / sizeof(decode_base64_t);
+
+/* the encoded value is followed by a separator which must not be touched
+ * (e.g. in a mapped database) */
+START_TEST (test_decode_base64_in_place) {
+    decode_base64_t *t = &decode_base64_tests[_i];
+    size_t ssize = strlen(t->src);
+    char *buf = malloc(ssize + 2);
+    memcpy(buf, t->src, ssize);
+    buf[ssize] = ' ';
+    buf[ssize + 1] = 'x';
+
+    size_t len = 0;
+    byte *decoded = decode_base64_in_place(buf, ssize, &len);
+    ck_assert_msg(decoded == (byte *) buf, "decode_base64_in_place: '%s': not decoded in place", t->src);
+    ck_assert_msg(len == t->expected_len, "decode_base64_in_place: '%s': length %zu != %zu", t->src, len, t->expected_len);
+    ck_assert_msg(memcmp(decoded, t->expected, len) == 0, "decode_base64_in_place: '%s': wrong decoded value", t->src);
+    ck_assert_msg(buf[ssize] == ' ' && buf[ssize + 1] == 'x', "decode_base64_in_place: '%s': separator overwritten", t->src);
+    free(buf);
+}
+END_TEST
+
+START_TEST (test_decode_base64_in_place_round_trip) {
+    byte data[64];
+    for (size_t i = 0 ; i < sizeof(data) ; ++i) {
+        data[i] = (byte) (i * 37 + 11);
+    }
+    for (size_t n = 1 ; n <= sizeof(data) ; ++n) {
+        char *encoded = encode_base64(data, n);
+        size_t len = 0;
+        byte *decoded = decode_base64_in_place(encoded, strlen(encoded), &len);
+        ck_assert_msg(decoded != NULL && len == n && memcmp(decoded, data, n) == 0, "decode_base64_in_place: round trip of %zu bytes failed", n);
+        free(encoded);
+    }
+}
+END_TEST
+
+static const char *invalid_base64[] = {
+    "QQ",
+    "QUJ",
+    "QU*D",
+    "QUJD\n",
+};
+
+static int num_invalid_base64 = sizeof invalid_base64 / sizeof(char*);
+
+START_TEST (test_decode_base64_in_place_invalid) {
+    char *buf = strdup(invalid_base64[_i]);
+    ck_assert_msg(decode_base64_in_place(buf, strlen(buf), NULL) == NULL, "decode_base64_in_place: invalid '%s' decoded", invalid_base64[_i]);
+    free(buf);
+}
+END_TEST
+
+Suite *make_base64_suite(void) {
+
+    Suite *s = suite_create ("base64");
+
+    TCase *tc_decode_base64_in_place = tcase_create ("decode_base64_in_place");
+
+    tcase_add_loop_test (tc_decode_base64_in_place, test_decode_base64_in_place, 0, num_decode_base64_tests);
+    tcase_add_test (tc_decode_base64_in_place, test_decode_base64_in_place_round_trip);
+    tcase_add_loop_test (tc_decode_base64_in_place, test_decode_base64_in_place_invalid, 0, num_invalid_base64);
+
+    suite_add_tcase (s, tc_decode_base64_in_place);
+
+    return s;
+}
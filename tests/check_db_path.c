@@ -0,0 +1,160 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_config.h"
+#include "db_path.h"
+
+#define LONG_DIR_LENGTH 5000
+
+typedef struct {
+    const char *path;
+    size_t expected_prefix;
+} front_coded_path_t;
+
+/* sorted paths as written by write_tree(), a prefix of at most
+ * DB_PATH_MIN_PREFIX bytes resets the front coding */
+static front_coded_path_t front_coded_paths[] = {
+    { "/", 0 },
+    { "/bin", 0 },
+    { "/etc", 0 },
+    { "/etc/passwd", 4 },
+    { "/etc/passwd-", 11 },
+    { "/etc/ssh", 5 },
+    { "/etc/ssh/sshd_config", 8 },
+    { "/etc/ssh/sshd_config.d", 20 },
+    { "/etc/ssh/sshd_config.d/%20a", 22 },
+    { "/usr", 0 },
+    { "/usr/bin/a", 4 },
+    { "/usr/bin/b", 9 },
+    { "/var", 0 },
+};
+
+static int num_front_coded_paths = sizeof front_coded_paths / sizeof(front_coded_path_t);
+
+static char *encode(size_t n, const char *path) {
+    size_t len = snprintf(NULL, 0, "%lu:%s", (unsigned long) n, path + n) + 1;
+    char *text = malloc(len);
+    snprintf(text, len, "%lu:%s", (unsigned long) n, path + n);
+    return text;
+}
+
+START_TEST (test_front_coded_paths) {
+    database out = { 0 };
+    database in = { 0 };
+
+    for (int i = 0 ; i < num_front_coded_paths ; ++i) {
+        const char *path = front_coded_paths[i].path;
+        size_t n = db_front_code_path(&out, path, strlen(path));
+        ck_assert_msg(n == front_coded_paths[i].expected_prefix, "db_front_code_path: '%s': prefix %lu != %lu", path, (unsigned long) n, (unsigned long) front_coded_paths[i].expected_prefix);
+
+        char *text = n ? encode(n, path) : strdup(path);
+        char *read = db_read_path(&in, text, false);
+        ck_assert_msg(read != NULL && strcmp(read, path) == 0, "db_read_path: '%s': path returned '%s' != '%s'", text, read, path);
+        ck_assert_msg(n || read == text, "db_read_path: '%s': path not used in place", text);
+        if (read != text) {
+            free(read);
+        }
+        free(text);
+    }
+    free(out.path);
+    free(in.path);
+}
+END_TEST
+
+START_TEST (test_front_coded_long_prefix) {
+    database out = { 0 };
+    database in = { 0 };
+    char *dir = malloc(LONG_DIR_LENGTH + 1);
+    memset(dir, 'a', LONG_DIR_LENGTH);
+    dir[0] = '/';
+    dir[LONG_DIR_LENGTH] = '\0';
+
+    /* the path buffers grow with the paths */
+    for (int i = 0 ; i < 3 ; ++i) {
+        char *path = malloc(LONG_DIR_LENGTH + 3);
+        snprintf(path, LONG_DIR_LENGTH + 3, "%s/%c", dir, 'a' + i);
+        size_t n = db_front_code_path(&out, path, strlen(path));
+        size_t expected = i ? LONG_DIR_LENGTH + 1 : 0;
+        ck_assert_msg(n == expected, "db_front_code_path: prefix %lu != %lu", (unsigned long) n, (unsigned long) expected);
+
+        char *text = n ? encode(n, path) : strdup(path);
+        char *read = db_read_path(&in, text, true);
+        ck_assert_msg(strcmp(read, path) == 0, "db_read_path: path %d of length %lu not rebuilt", i, (unsigned long) strlen(path));
+        free(read);
+        free(text);
+        free(path);
+    }
+
+    /* a path written in full (e.g. a copied raw line) resets the coding */
+    db_set_prev_path(&out, "/b", 2);
+    ck_assert_msg(db_front_code_path(&out, dir, LONG_DIR_LENGTH) == 0, "db_front_code_path: prefix after reset");
+    char *read = db_read_path(&in, dir, true);
+    ck_assert_msg(strcmp(read, dir) == 0 && in.path_len == LONG_DIR_LENGTH, "db_read_path: path after reset");
+    free(read);
+
+    free(dir);
+    free(out.path);
+    free(in.path);
+}
+END_TEST
+
+static const char *invalid_paths[] = {
+    "",
+    "etc",
+    "0:/etc",
+    "7:",
+    "4",
+    "4/etc",
+    "-4:etc",
+};
+
+static int num_invalid_paths = sizeof invalid_paths / sizeof(char*);
+
+START_TEST (test_invalid_front_coded_paths) {
+    database in = { 0 };
+    char *read = db_read_path(&in, "/etc", true);
+    free(read);
+
+    char *text = strdup(invalid_paths[_i]);
+    read = db_read_path(&in, text, true);
+    ck_assert_msg(read == NULL, "db_read_path: '%s': invalid path returned '%s'", text, read);
+    free(text);
+    free(in.path);
+}
+END_TEST
+
+Suite *make_db_path_suite(void) {
+
+    Suite *s = suite_create ("db_path");
+
+    TCase *tc_front_coding = tcase_create ("front_coding");
+
+    tcase_add_test (tc_front_coding, test_front_coded_paths);
+    tcase_add_test (tc_front_coding, test_front_coded_long_prefix);
+    tcase_add_loop_test (tc_front_coding, test_invalid_front_coded_paths, 0, num_invalid_paths);
+
+    suite_add_tcase (s, tc_front_coding);
+
+    return s;
+}
@@ -0,0 +1,159 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glob_rule.h"
+
+typedef struct {
+    const char *glob;
+    const char *path;
+    int expected;
+} match_glob_t;
+
+#define MATCH 0
+#define PARTIAL PCRE2_ERROR_PARTIAL
+#define NOMATCH PCRE2_ERROR_NOMATCH
+
+static match_glob_t match_glob_tests[] = {
+    { "/etc", "/etc", MATCH },
+    { "/etc", "/etc/passwd", MATCH },
+    { "/etc", "/etcetera", NOMATCH },
+    { "/etc/passwd", "/etc", PARTIAL },
+    { "/etc$", "/etc/passwd", NOMATCH },
+
+    { "/etc/*.conf", "/etc/a.conf", MATCH },
+    { "/etc/*.conf", "/etc/.conf", MATCH },
+    { "/etc/*.conf", "/etc/a/b.conf", NOMATCH },
+    { "/etc/*.conf$", "/etc/a.conf.d", PARTIAL },
+    { "/etc/*.conf$", "/etc/a.conf/d", NOMATCH },
+    { "/etc/?.conf", "/etc/a.conf", MATCH },
+    { "/etc/?.conf", "/etc/ab.conf", NOMATCH },
+    { "/etc/[a-c].conf", "/etc/b.conf", MATCH },
+    { "/etc/[!a-c].conf", "/etc/b.conf", NOMATCH },
+    { "/etc/[^a-c].conf", "/etc/d.conf", MATCH },
+    { "/etc/\\*", "/etc/*", MATCH },
+    { "/etc/\\*", "/etc/a", NOMATCH },
+
+    { "/etc/**.conf$", "/etc/a/b/c.conf", MATCH },
+    { "/etc/**.conf$", "/etc/c.conf", MATCH },
+    { "/etc/**", "/etc", PARTIAL },
+
+    /* '**' as path component also matches zero directories */
+    { "/a/**/b$", "/a/b", MATCH },
+    { "/a/**/b$", "/a/x/b", MATCH },
+    { "/a/**/b$", "/a/x/y/b", MATCH },
+    { "/a/**/b$", "/a/xb", PARTIAL },
+    { "/a/**/b$", "/a/x/yb", PARTIAL },
+    { "/a/**/b", "/a/b/c", MATCH },
+    { "/a/**/b$", "/ab", NOMATCH },
+    { "/a/**/b$", "/a", PARTIAL },
+    { "/a/x**/b$", "/a/xb", PARTIAL },
+    { "/a/x**/b$", "/a/x/b", MATCH },
+    { "/**/b$", "/b", MATCH },
+    { "/**/b$", "/a/b", MATCH },
+};
+
+static int num_match_glob_tests = sizeof match_glob_tests / sizeof(match_glob_t);
+
+START_TEST (test_match_glob) {
+    const char *error = NULL;
+    size_t erroffset;
+    glob_rule *g = compile_glob(match_glob_tests[_i].glob, &error, &erroffset);
+    ck_assert_msg(g != NULL, "compile_glob: '%s': %s", match_glob_tests[_i].glob, error);
+    int result = match_glob(g, match_glob_tests[_i].path);
+    ck_assert_msg(result == match_glob_tests[_i].expected, "match_glob: '%s' '%s': result %d != %d", match_glob_tests[_i].glob, match_glob_tests[_i].path, result, match_glob_tests[_i].expected);
+    free_glob(g);
+}
+END_TEST
+
+typedef struct {
+    const char *glob;
+    const char *expected_string;
+} get_glob_dir_t;
+
+/* the same directories as for the equivalent regular expressions */
+static get_glob_dir_t get_glob_dir_tests[] = {
+    { "/etc", "/" },
+    { "/etc/", "/etc" },
+    { "/etc/passwd", "/etc" },
+    { "/etc/*.conf", "/etc" },
+    { "/etc/ssh*/*", "/etc" },
+    { "/a/b/**", "/a/b" },
+    { "/**", "/" },
+};
+
+static int num_get_glob_dir_tests = sizeof get_glob_dir_tests / sizeof(get_glob_dir_t);
+
+START_TEST (test_get_glob_dir) {
+    const char *error = NULL;
+    size_t erroffset;
+    glob_rule *g = compile_glob(get_glob_dir_tests[_i].glob, &error, &erroffset);
+    ck_assert_msg(g != NULL, "compile_glob: '%s': %s", get_glob_dir_tests[_i].glob, error);
+    char *str = get_glob_dir(g);
+    ck_assert_msg(strcmp(get_glob_dir_tests[_i].expected_string, str) == 0, "get_glob_dir: '%s': string returned '%s' != '%s'", get_glob_dir_tests[_i].glob, str, get_glob_dir_tests[_i].expected_string);
+    free(str);
+    free_glob(g);
+}
+END_TEST
+
+typedef struct {
+    const char *glob;
+    size_t erroffset;
+} compile_glob_error_t;
+
+static compile_glob_error_t compile_glob_error_tests[] = {
+    { "etc", 0 },
+    { "/etc/\\", 5 },
+    { "/etc/[a-", 5 },
+    { "/etc/[c-a]", 5 },
+};
+
+static int num_compile_glob_error_tests = sizeof compile_glob_error_tests / sizeof(compile_glob_error_t);
+
+START_TEST (test_compile_glob_error) {
+    const char *error = NULL;
+    size_t erroffset = 0;
+    glob_rule *g = compile_glob(compile_glob_error_tests[_i].glob, &error, &erroffset);
+    ck_assert_msg(g == NULL && error != NULL, "compile_glob: '%s': invalid glob accepted", compile_glob_error_tests[_i].glob);
+    ck_assert_msg(erroffset == compile_glob_error_tests[_i].erroffset, "compile_glob: '%s': error offset %zu != %zu", compile_glob_error_tests[_i].glob, erroffset, compile_glob_error_tests[_i].erroffset);
+}
+END_TEST
+
+Suite *make_glob_rule_suite(void) {
+
+    Suite *s = suite_create ("glob_rule");
+
+    TCase *tc_match_glob = tcase_create ("match_glob");
+    TCase *tc_get_glob_dir = tcase_create ("get_glob_dir");
+    TCase *tc_compile_glob_error = tcase_create ("compile_glob_error");
+
+    tcase_add_loop_test (tc_match_glob, test_match_glob, 0, num_match_glob_tests);
+    tcase_add_loop_test (tc_get_glob_dir, test_get_glob_dir, 0, num_get_glob_dir_tests);
+    tcase_add_loop_test (tc_compile_glob_error, test_compile_glob_error, 0, num_compile_glob_error_tests);
+
+    suite_add_tcase (s, tc_match_glob);
+    suite_add_tcase (s, tc_get_glob_dir);
+    suite_add_tcase (s, tc_compile_glob_error);
+
+    return s;
+}
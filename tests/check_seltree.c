@@ -0,0 +1,199 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_config.h"
+#include "rx_rule.h"
+#include "seltree.h"
+#include "util.h"
+
+__thread db_config *conf;
+
+typedef struct {
+    const char *rx;
+    bool glob;
+    RESTRICTION_TYPE restriction;
+    AIDE_RULE_TYPE rule_type;
+} seltree_rule_t;
+
+static seltree_rule_t seltree_rules[] = {
+    { "/etc", false, FT_NULL, AIDE_SELECTIVE_RULE },
+    { "/etc/ssh/.*_key", false, FT_NULL, AIDE_NEGATIVE_RULE },
+    { "/etc/mtab$", false, FT_NULL, AIDE_NEGATIVE_RULE },
+    { "/var/log/[^/]*\\.log$", false, FT_REG, AIDE_EQUAL_RULE },
+    { "/var/log", false, FT_DIR, AIDE_EQUAL_RULE },
+    { "/usr/(s)?bin/", false, FT_NULL, AIDE_SELECTIVE_RULE },
+    { "/home", false, FT_NULL, AIDE_SELECTIVE_RULE },
+    { "/home/*/.cache", true, FT_NULL, AIDE_NEGATIVE_RULE },
+    { "/opt/**.conf$", true, FT_REG, AIDE_SELECTIVE_RULE },
+    { "/tmp", false, FT_DIR, AIDE_EQUAL_RULE },
+};
+
+static int num_seltree_rules = sizeof seltree_rules / sizeof(seltree_rule_t);
+
+typedef struct {
+    const char *path;
+    RESTRICTION_TYPE file_type;
+} seltree_path_t;
+
+static seltree_path_t seltree_paths[] = {
+    { "/", FT_DIR },
+    { "/etc", FT_DIR },
+    { "/etc/passwd", FT_REG },
+    { "/etc/ssh", FT_DIR },
+    { "/etc/ssh/ssh_host_rsa_key", FT_REG },
+    { "/etc/ssh/sshd_config", FT_REG },
+    { "/etc/mtab", FT_LNK },
+    { "/var", FT_DIR },
+    { "/var/log", FT_DIR },
+    { "/var/log/syslog.log", FT_REG },
+    { "/var/log/syslog.log", FT_LNK },
+    { "/var/log/old/syslog.log", FT_REG },
+    { "/usr/bin/ls", FT_REG },
+    { "/usr/sbin/init", FT_REG },
+    { "/usr/lib/libc.so", FT_REG },
+    { "/home/user", FT_DIR },
+    { "/home/user/.cache", FT_DIR },
+    { "/home/user/.cache/x", FT_REG },
+    { "/home/user/.bashrc", FT_REG },
+    { "/opt/a/b/c.conf", FT_REG },
+    { "/opt/a/b/c.conf", FT_DIR },
+    { "/opt/c.conf.d/x", FT_REG },
+    { "/tmp", FT_DIR },
+    { "/tmp/x", FT_REG },
+    { "/srv/\xc3\xa4", FT_REG },
+};
+
+static int num_seltree_paths = sizeof seltree_paths / sizeof(seltree_path_t);
+
+/* the decision for a path: result and line of the matching rule */
+typedef struct {
+    int match;
+    int rule;
+} seltree_decision_t;
+
+#define NUM_THREADS 4
+#define NUM_ROUNDS 50
+
+static seltree *build_tree(void) {
+    seltree *tree = init_tree();
+    begin_bulk_build();
+    for (int i = 0 ; i < num_seltree_rules ; ++i) {
+        rx_rule *r = add_rx_to_tree(checked_strdup(seltree_rules[i].rx), seltree_rules[i].glob, seltree_rules[i].restriction, seltree_rules[i].rule_type, tree, i, "check_seltree", (char *) seltree_rules[i].rx);
+        ck_assert_msg(r != NULL, "add_rx_to_tree: '%s' failed", seltree_rules[i].rx);
+        r->config_linenumber = i;
+    }
+    end_bulk_build(tree);
+    ck_assert_msg(compile_rules(NULL), "compile_rules failed");
+    return tree;
+}
+
+static seltree_decision_t get_decision(seltree *tree, int i, seltree_match_ctx *ctx) {
+    rx_rule *rule = NULL;
+    char *path = checked_strdup(seltree_paths[i].path);
+    seltree_decision_t d;
+    d.match = check_seltree(tree, path, seltree_paths[i].file_type, &rule, ctx);
+    d.rule = rule ? rule->config_linenumber : -1;
+    free(path);
+    return d;
+}
+
+typedef struct {
+    db_config *conf;
+    seltree *tree;
+    seltree_decision_t *decisions;
+} seltree_thread_t;
+
+static void *evaluate_paths(void *arg) {
+    seltree_thread_t *t = arg;
+    conf = t->conf;
+    seltree_match_ctx *ctx = new_seltree_match_ctx();
+    for (int round = 0 ; round < NUM_ROUNDS ; ++round) {
+        for (int i = 0 ; i < num_seltree_paths ; ++i) {
+            seltree_decision_t d = get_decision(t->tree, i, ctx);
+            if (round == 0) {
+                t->decisions[i] = d;
+            } else if (d.match != t->decisions[i].match || d.rule != t->decisions[i].rule) {
+                t->decisions[i].match = -100;
+            }
+        }
+    }
+    /* the queued nodes are added after all threads are joined */
+    return ctx;
+}
+
+START_TEST (test_threaded_check_seltree) {
+    conf = checked_calloc(1, sizeof(db_config));
+
+    /* sequential: one context, new nodes are added after each evaluation */
+    seltree *tree = build_tree();
+    seltree_decision_t sequential[num_seltree_paths];
+    seltree_match_ctx *ctx = new_seltree_match_ctx();
+    for (int i = 0 ; i < num_seltree_paths ; ++i) {
+        sequential[i] = get_decision(tree, i, ctx);
+        add_pending_seltree_nodes(ctx);
+    }
+    free_seltree_match_ctx(ctx);
+
+    /* threaded: one context per thread, the tree is not changed */
+    seltree *threaded_tree = build_tree();
+    pthread_t threads[NUM_THREADS];
+    seltree_thread_t args[NUM_THREADS];
+    seltree_match_ctx *ctxs[NUM_THREADS];
+    for (int t = 0 ; t < NUM_THREADS ; ++t) {
+        args[t].conf = conf;
+        args[t].tree = threaded_tree;
+        args[t].decisions = checked_malloc(num_seltree_paths * sizeof(seltree_decision_t));
+        ck_assert_int_eq(pthread_create(&threads[t], NULL, evaluate_paths, &args[t]), 0);
+    }
+    for (int t = 0 ; t < NUM_THREADS ; ++t) {
+        pthread_join(threads[t], (void **) &ctxs[t]);
+    }
+    for (int t = 0 ; t < NUM_THREADS ; ++t) {
+        free_seltree_match_ctx(ctxs[t]);
+        for (int i = 0 ; i < num_seltree_paths ; ++i) {
+            ck_assert_msg(args[t].decisions[i].match == sequential[i].match && args[t].decisions[i].rule == sequential[i].rule,
+                    "check_seltree: '%s' (thread %d): threaded %d (rule %d) != sequential %d (rule %d)", seltree_paths[i].path, t,
+                    args[t].decisions[i].match, args[t].decisions[i].rule, sequential[i].match, sequential[i].rule);
+        }
+        free(args[t].decisions);
+    }
+    free_tree(tree);
+    free_tree(threaded_tree);
+    free(conf);
+}
+END_TEST
+
+Suite *make_seltree_suite(void) {
+
+    Suite *s = suite_create ("seltree");
+
+    TCase *tc_threaded_check_seltree = tcase_create ("threaded_check_seltree");
+
+    tcase_add_test (tc_threaded_check_seltree, test_threaded_check_seltree);
+
+    suite_add_tcase (s, tc_threaded_check_seltree);
+
+    return s;
+}
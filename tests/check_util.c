@@ -0,0 +1,68 @@
+/*
+ * AIDE (Advanced Intrusion Detection Environment)
+ *
+ * Copyright (C) 2022 Hannes von Haugwitz
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+typedef struct {
+    const char *s;
+    const char *expected_string;
+} encode_string_t;
+
+/* encoded paths (e.g. of the batch mode of --path-check) never contain
+ * the separators tab, newline and NUL */
+static encode_string_t encode_string_tests[] = {
+    { "", "" },
+    { "/etc/passwd", "/etc/passwd" },
+    { "/tmp/a b", "/tmp/a%20b" },
+    { "/tmp/a\tb", "/tmp/a%09b" },
+    { "/tmp/a\nb", "/tmp/a%0Ab" },
+    { "/tmp/100%", "/tmp/100%25" },
+    { "/tmp/%09", "/tmp/%2509" },
+    { "/tmp/\xc3\xa4", "/tmp/%C3%A4" },
+};
+
+static int num_encode_string_tests = sizeof encode_string_tests / sizeof(encode_string_t);
+
+START_TEST (test_encode_string) {
+    char *str = encode_string(encode_string_tests[_i].s);
+    ck_assert_msg(strcmp(encode_string_tests[_i].expected_string, str) == 0, "encode_string: '%s': string returned '%s' != '%s'", encode_string_tests[_i].s, str, encode_string_tests[_i].expected_string);
+    ck_assert_msg(strpbrk(str, "\t\n") == NULL, "encode_string: '%s': string returned '%s' contains a separator", encode_string_tests[_i].s, str);
+    decode_string(str);
+    ck_assert_msg(strcmp(encode_string_tests[_i].s, str) == 0, "decode_string: string returned '%s' != '%s'", str, encode_string_tests[_i].s);
+    free(str);
+}
+END_TEST
+
+Suite *make_util_suite(void) {
+
+    Suite *s = suite_create ("util");
+
+    TCase *tc_encode_string = tcase_create ("encode_string");
+
+    tcase_add_loop_test (tc_encode_string, test_encode_string, 0, num_encode_string_tests);
+
+    suite_add_tcase (s, tc_encode_string);
+
+    return s;
+}